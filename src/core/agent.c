@@ -1,8 +1,20 @@
 #include "agent.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+/* ----------------------------------------------------
+   Type response table
+---------------------------------------------------- */
+
+const AgentTypeResponse AGENT_TYPE_RESPONSE[AGENT_TYPE_COUNT] = {
+    /* anchor  price  anchor_tgt  gain  noise */
+    {  0.0,    1.0,   0.0,        1.2,  0.0 },  /* retail: overreact */
+    {  0.5,    0.7,   0.3,        0.4,  0.0 },  /* institution: dampened, anchored */
+    {  0.0,    1.0,   0.0,        0.0,  1.0 }   /* noise: random response */
+};
+
 /* ----------------------------------------------------
    Internal utilities (private to agent.c)
 ---------------------------------------------------- */
@@ -95,9 +107,8 @@ double agent_compute_demand(const Agent *a,
     double signal = a->belief - market_price;
 
     /* Institutions anchor to fundamentals */
-    if (a->type == AGENT_INSTITUTION) {
-        signal += 0.5 * (a->fundamental_anchor - market_price);
-    }
+    signal += AGENT_TYPE_RESPONSE[a->type].anchor_weight
+            * (a->fundamental_anchor - market_price);
 
     /* 2. Inventory risk penalty */
     double inventory_cost = a->risk_aversion * position_penalty(a->position);
@@ -159,12 +170,10 @@ void agent_update_belief(Agent *a,
                  + shock_component
     */
 
-    double target = observed_price;
-
     /* Institutions filter noise more aggressively */
-    if (a->type == AGENT_INSTITUTION) {
-        target = 0.7 * observed_price + 0.3 * a->fundamental_anchor;
-    }
+    const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[a->type];
+    double target = r->price_weight * observed_price
+                  + r->anchor_target * a->fundamental_anchor;
 
     a->belief += a->belief_update_rate * (target - a->belief);
     a->belief += 0.1 * global_shock;
@@ -183,14 +192,13 @@ void agent_apply_shock(Agent *a, double shock_strength)
      - Noise: random
     */
 
-    if (a->type == AGENT_RETAIL) {
-        a->belief += 1.2 * shock_strength;
-    }
-    else if (a->type == AGENT_INSTITUTION) {
-        a->belief += 0.4 * shock_strength;
+    const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[a->type];
+
+    if (r->shock_noise != 0.0) {
+        a->belief += shock_strength * normal_random(&a->rng_state);
     }
     else {
-        a->belief += shock_strength * normal_random(&a->rng_state);
+        a->belief += r->shock_gain * shock_strength;
     }
 }
 
@@ -200,13 +208,27 @@ void agent_apply_shock(Agent *a, double shock_strength)
 
 char *agent_to_json(const Agent *a)
 {
-    char *buf = malloc(512);
+    /* Full state: enough to reconstruct the agent in a debugger dump */
+    char *buf = malloc(1024);
     if (!buf) return NULL;
 
-    snprintf(buf, 512,
-        "{ \"id\": %u, \"type\": %d, \"belief\": %.4f, "
-        "\"position\": %d, \"cash\": %.4f }",
-        a->id, a->type, a->belief, a->position, a->cash
+    snprintf(buf, 1024,
+        "{ \"id\": %u, \"name\": \"%s\", \"type\": %d, \"belief\": %.10g, "
+        "\"position\": %d, \"cash\": %.10g, "
+        "\"aggressiveness\": %.6g, \"trade_size_scale\": %.6g, "
+        "\"risk_aversion\": %.6g, \"liquidity_tolerance\": %.6g, "
+        "\"belief_update_rate\": %.6g, \"network_influence\": %.6g, "
+        "\"noise_std\": %.6g, \"fundamental_anchor\": %.10g, "
+        "\"neighbor_count\": %zu, \"passive_only\": %s, "
+        "\"rng_state\": \"%016llx\" }",
+        a->id, a->name, a->type, a->belief,
+        a->position, a->cash,
+        a->aggressiveness, a->trade_size_scale,
+        a->risk_aversion, a->liquidity_tolerance,
+        a->belief_update_rate, a->network_influence,
+        a->noise_std, a->fundamental_anchor,
+        a->neighbor_count, a->passive_only ? "true" : "false",
+        (unsigned long long)a->rng_state
     );
 
     return buf;
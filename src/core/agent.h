@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <math.h>
 
 /* -------------------- Types & Constants -------------------- */
 
@@ -37,6 +38,23 @@ typedef enum {
     AGENT_NOISE = 2        /* liquidity/noise provider */
 } AgentType;
 
+#define AGENT_TYPE_COUNT 3
+
+/*
+ * Type-specific response coefficients. Kept in one table so the AoS
+ * functions below and the columnar kernels (kernels.h) share a single
+ * definition and the kernels can look them up instead of branching.
+ */
+typedef struct AgentTypeResponse {
+    double anchor_weight;   /* demand: weight on (fundamental_anchor - price) */
+    double price_weight;    /* belief target: weight on observed price */
+    double anchor_target;   /* belief target: weight on fundamental_anchor */
+    double shock_gain;      /* deterministic belief response to news */
+    double shock_noise;     /* 1 => response is shock * N(0,1) instead */
+} AgentTypeResponse;
+
+extern const AgentTypeResponse AGENT_TYPE_RESPONSE[AGENT_TYPE_COUNT];
+
 /* Agent identifier type */
 typedef uint32_t AgentId;
 
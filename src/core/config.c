@@ -0,0 +1,654 @@
+#include "config.h"
+#include "json.h"
+#include "rewire.h"
+#include "community.h"
+#include "news.h"
+#include "information_flow.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ----------------------------------------------------
+   Defaults (the built-in experiment)
+---------------------------------------------------- */
+
+void config_defaults(SimConfig *cfg)
+{
+    memset(cfg, 0, sizeof(SimConfig));
+
+    strcpy(cfg->experiment_name, "default");
+
+    cfg->has_seed = false;
+    cfg->random_seed = 0;
+    cfg->time_steps = 3000;
+
+    cfg->market = (MarketConfig){
+        .initial_price = 100.0,
+        .liquidity = 1200.0,
+        .impact_coefficient = 1.0,
+        .volatility_decay = 0.94,
+        .max_price_change = 5.0
+    };
+
+    cfg->population.num_agents = 400;
+    cfg->population.type_share[0] = 0.6;  /* retail */
+    cfg->population.type_share[1] = 0.3;  /* institution */
+    cfg->population.type_share[2] = 0.1;  /* noise */
+
+    cfg->network = (NetworkConfig){
+        .kind = NETWORK_NONE,
+        .degree = 4,
+        .rewire_prob = 0.1,
+        .order = GRAPH_ORDER_NONE,
+        .compress = false,
+        .symmetrize = true,
+        .dedup = true,
+        .rewire = {
+            .rule = REWIRE_NONE,
+            .every = 10,
+            .rate = 0.01,
+            .candidates = 2,
+            .slack = 0.25
+        },
+        .hub_sample = {
+            .above = 0,
+            .size = 256,
+            .every = 20
+        },
+        .herding = HERDING_NEIGHBORS,
+        .community = {
+            .passes = 20,
+            .global_weight = 0.2
+        }
+    };
+
+    cfg->agents[0] = (AgentTypeConfig){
+        PARAM_CONST(1.0), PARAM_CONST(0.2), PARAM_CONST(0.7),
+        PARAM_CONST(0.6), PARAM_CONST(0.05), PARAM_CONST(0.02)
+    };
+    cfg->agents[1] = (AgentTypeConfig){
+        PARAM_CONST(0.5), PARAM_CONST(0.8), PARAM_CONST(0.1),
+        PARAM_CONST(0.2), PARAM_CONST(0.05), PARAM_CONST(0.02)
+    };
+    cfg->agents[2] = (AgentTypeConfig){
+        PARAM_CONST(0.2), PARAM_CONST(0.1), PARAM_CONST(0.0),
+        PARAM_CONST(1.0), PARAM_CONST(0.05), PARAM_CONST(0.02)
+    };
+
+    cfg->news = (NewsConfig){
+        .calm_arrival_prob = 0.01,
+        .stress_arrival_prob = 0.05,
+        .calm_scale = 2.0,
+        .stress_scale = 8.0,
+        .regime_switch_to_stress = 0.002,
+        .regime_switch_to_calm = 0.01
+    };
+
+    cfg->information_flow = (InformationFlowConfig){
+        .spread = NEWS_SPREAD_BROADCAST,
+        .base_attention = 0.6,
+        .max_propagation_steps = 3,
+        .temporal_decay = 0.8,
+        .hop_latency = 0
+    };
+
+    cfg->statistics = (StatisticsConfig){
+        .jump_threshold = 0.08,
+        .ewma_decay = 0.94
+    };
+
+    strcpy(cfg->output.path, "prices.csv");
+    cfg->output.full_resolution = true;
+    cfg->output.pyramid = true;
+    cfg->output.n_stages = 0;
+    cfg->output.trajectories = (TrajectoryConfig){
+        .per_type = 16,
+        .largest = 8,
+        .interval = 1
+    };
+    cfg->output.dispersion.bin_width = 0.01;
+    cfg->output.changepoint = (ChangepointConfig){
+        .cusum_drift = 0.5,
+        .cusum_threshold = 8.0,
+        .cusum_decay = 0.99,
+        .bocpd_hazard = 0.004,
+        .bocpd_max_run = 256,
+        .bocpd_threshold = 0.5,
+        .bocpd_window = 10
+    };
+}
+
+/* ----------------------------------------------------
+   Typed field readers
+---------------------------------------------------- */
+
+/*
+ Each reader leaves the default untouched when the key is absent and
+ fails only when the key is present with the wrong type.
+*/
+
+static int read_number(const JsonValue *root, const char *path, double *out)
+{
+    const JsonValue *v = json_path(root, path);
+    if (!v) return 0;
+
+    if (v->type != JSON_NUMBER) {
+        fprintf(stderr, "config: '%s' must be a number\n", path);
+        return -1;
+    }
+    *out = v->number;
+    return 0;
+}
+
+static int read_int(const JsonValue *root, const char *path, int *out)
+{
+    double d = *out;
+    if (read_number(root, path, &d) != 0) return -1;
+    if (d != floor(d) || d < (double)INT_MIN || d > (double)INT_MAX) {
+        fprintf(stderr, "config: '%s' must be an integer\n", path);
+        return -1;
+    }
+    *out = (int)d;
+    return 0;
+}
+
+static int read_u64(const JsonValue *root, const char *path, uint64_t *out)
+{
+    double d = (double)*out;
+    if (read_number(root, path, &d) != 0) return -1;
+    if (d < 0.0) {
+        fprintf(stderr, "config: '%s' must be non-negative\n", path);
+        return -1;
+    }
+    /* Doubles hold every integer up to 2^53 exactly */
+    if (d != floor(d) || d > 9007199254740992.0) {
+        fprintf(stderr, "config: '%s' must be an integer\n", path);
+        return -1;
+    }
+    *out = (uint64_t)d;
+    return 0;
+}
+
+static int read_bool(const JsonValue *root, const char *path, bool *out)
+{
+    const JsonValue *v = json_path(root, path);
+    if (!v) return 0;
+
+    if (v->type != JSON_BOOL) {
+        fprintf(stderr, "config: '%s' must be true or false\n", path);
+        return -1;
+    }
+    *out = v->boolean;
+    return 0;
+}
+
+static int read_string(const JsonValue *root, const char *path, char *out, size_t cap)
+{
+    const JsonValue *v = json_path(root, path);
+    if (!v) return 0;
+
+    if (v->type != JSON_STRING || strlen(v->string) >= cap) {
+        fprintf(stderr, "config: '%s' must be a string shorter than %zu\n", path, cap);
+        return -1;
+    }
+    strcpy(out, v->string);
+    return 0;
+}
+
+/* A number (constant) or a distribution object, see ParamDist */
+static int read_param(const JsonValue *root, const char *path, ParamDist *out)
+{
+    const JsonValue *v = json_path(root, path);
+    if (!v) return 0;
+
+    if (v->type == JSON_NUMBER) {
+        *out = PARAM_CONST(v->number);
+        return 0;
+    }
+
+    char kind[16] = "";
+    if (v->type != JSON_OBJECT || read_string(v, "dist", kind, sizeof(kind)) != 0) {
+        fprintf(stderr, "config: '%s' must be a number or a distribution object\n", path);
+        return -1;
+    }
+
+    ParamDist d = PARAM_CONST(0.0);
+    int rc = 0;
+
+    rc |= read_number(v, "min", &d.lo);
+    rc |= read_number(v, "max", &d.hi);
+
+    if (strcmp(kind, "normal") == 0) {
+        d.kind = DIST_NORMAL;
+        rc |= read_number(v, "mean", &d.a);
+        rc |= read_number(v, "std", &d.b);
+    } else if (strcmp(kind, "lognormal") == 0) {
+        d.kind = DIST_LOGNORMAL;
+        rc |= read_number(v, "mu", &d.a);
+        rc |= read_number(v, "sigma", &d.b);
+    } else if (strcmp(kind, "uniform") == 0) {
+        d.kind = DIST_UNIFORM;
+        d.a = d.lo;
+        d.b = d.hi;
+        if (!isfinite(d.a) || !isfinite(d.b) || d.b < d.a) rc = -1;
+    } else if (strcmp(kind, "beta") == 0) {
+        d.kind = DIST_BETA;
+        d.a = d.b = 1.0;
+        rc |= read_number(v, "alpha", &d.a);
+        rc |= read_number(v, "beta", &d.b);
+        if (!isfinite(d.lo)) d.lo = 0.0;
+        if (!isfinite(d.hi)) d.hi = 1.0;
+        if (d.a <= 0.0 || d.b <= 0.0) rc = -1;
+    } else {
+        fprintf(stderr, "config: '%s' has unknown distribution '%s'\n", path, kind);
+        return -1;
+    }
+
+    bool bad_spread = (d.kind == DIST_NORMAL || d.kind == DIST_LOGNORMAL) && d.b < 0.0;
+    if (rc != 0 || bad_spread) {
+        fprintf(stderr, "config: '%s' has invalid distribution parameters\n", path);
+        return -1;
+    }
+
+    *out = d;
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Sections
+---------------------------------------------------- */
+
+static int read_agent_type(const JsonValue *root, const char *name, AgentTypeConfig *a)
+{
+    char path[96];
+    int rc = 0;
+
+#define AGENT_FIELD(field) \
+    snprintf(path, sizeof(path), "agents.%s." #field, name); \
+    rc |= read_param(root, path, &a->field)
+
+    AGENT_FIELD(aggressiveness);
+    AGENT_FIELD(risk_aversion);
+    AGENT_FIELD(network_influence);
+    AGENT_FIELD(noise_std);
+    AGENT_FIELD(belief_update_rate);
+    AGENT_FIELD(liquidity_tolerance);
+
+#undef AGENT_FIELD
+
+    return rc;
+}
+
+static int read_output(const JsonValue *root, OutputConfig *out)
+{
+    int rc = 0;
+
+    rc |= read_string(root, "simulation.log_output", out->path, sizeof(out->path));
+    rc |= read_bool(root, "output.full_resolution", &out->full_resolution);
+    rc |= read_bool(root, "output.pyramid", &out->pyramid);
+    rc |= read_string(root, "output.tape", out->tape, sizeof(out->tape));
+
+    TrajectoryConfig *tr = &out->trajectories;
+    uint64_t per_type = tr->per_type, largest = tr->largest;
+    rc |= read_string(root, "output.trajectories.path", tr->path, sizeof(tr->path));
+    rc |= read_u64(root, "output.trajectories.per_type", &per_type);
+    rc |= read_u64(root, "output.trajectories.largest", &largest);
+    rc |= read_u64(root, "output.trajectories.interval", &tr->interval);
+    if (per_type > UINT32_MAX / 4 || largest > UINT32_MAX / 4 || tr->interval == 0) {
+        fprintf(stderr, "config: 'output.trajectories' needs interval >= 1 and sane sample sizes\n");
+        return -1;
+    }
+    tr->per_type = (uint32_t)per_type;
+    tr->largest = (uint32_t)largest;
+
+    DispersionConfig *dc = &out->dispersion;
+    rc |= read_string(root, "output.dispersion.path", dc->path, sizeof(dc->path));
+    rc |= read_number(root, "output.dispersion.bin_width", &dc->bin_width);
+    if (!(dc->bin_width > 0.0)) {
+        fprintf(stderr, "config: 'output.dispersion.bin_width' must be positive\n");
+        return -1;
+    }
+
+    ChangepointConfig *cp = &out->changepoint;
+    uint64_t max_run = cp->bocpd_max_run, window = cp->bocpd_window;
+    rc |= read_string(root, "output.changepoint.path", cp->path, sizeof(cp->path));
+    rc |= read_number(root, "output.changepoint.cusum.drift", &cp->cusum_drift);
+    rc |= read_number(root, "output.changepoint.cusum.threshold", &cp->cusum_threshold);
+    rc |= read_number(root, "output.changepoint.cusum.decay", &cp->cusum_decay);
+    rc |= read_number(root, "output.changepoint.bocpd.hazard", &cp->bocpd_hazard);
+    rc |= read_u64(root, "output.changepoint.bocpd.max_run", &max_run);
+    rc |= read_number(root, "output.changepoint.bocpd.threshold", &cp->bocpd_threshold);
+    rc |= read_u64(root, "output.changepoint.bocpd.window", &window);
+    if (!(cp->cusum_drift >= 0.0) || !(cp->cusum_threshold > 0.0) ||
+        !(cp->cusum_decay > 0.0 && cp->cusum_decay < 1.0)) {
+        fprintf(stderr, "config: 'output.changepoint.cusum' needs drift >= 0, threshold > 0 "
+                        "and 0 < decay < 1\n");
+        return -1;
+    }
+    if (!(cp->bocpd_hazard > 0.0 && cp->bocpd_hazard < 1.0) ||
+        !(cp->bocpd_threshold > 0.0 && cp->bocpd_threshold <= 1.0) ||
+        window == 0 || window >= max_run || max_run > 65536) {
+        fprintf(stderr, "config: 'output.changepoint.bocpd' needs 0 < hazard < 1, "
+                        "0 < threshold <= 1 and 1 <= window < max_run <= 65536\n");
+        return -1;
+    }
+    cp->bocpd_max_run = (uint32_t)max_run;
+    cp->bocpd_window = (uint32_t)window;
+
+    const JsonValue *stages = json_path(root, "output.stages");
+    if (!stages) return rc;
+
+    if (stages->type != JSON_ARRAY || stages->count > OUTPUT_MAX_STAGES) {
+        fprintf(stderr, "config: 'output.stages' must be an array of at most %d stages\n",
+                OUTPUT_MAX_STAGES);
+        return -1;
+    }
+
+    for (size_t i = 0; i < stages->count; i++) {
+        const JsonValue *s = &stages->items[i];
+        OutputStageConfig *sc = &out->stages[i];
+        char type[32] = "";
+
+        sc->interval = 1;
+        rc |= read_string(s, "type", type, sizeof(type));
+        rc |= read_u64(s, "interval", &sc->interval);
+        rc |= read_string(s, "path", sc->path, sizeof(sc->path));
+
+        if (stage_type_from_string(type, &sc->type) != 0) {
+            fprintf(stderr, "config: output stage %zu has unknown type '%s'\n", i, type);
+            return -1;
+        }
+        if (sc->path[0] == '\0') {
+            fprintf(stderr, "config: output stage %zu needs a 'path'\n", i);
+            return -1;
+        }
+    }
+    out->n_stages = (int)stages->count;
+
+    return rc;
+}
+
+/* Arrival process fields, under news_process or one of its targets */
+static int read_news(const JsonValue *obj, NewsConfig *news)
+{
+    int rc = 0;
+
+    rc |= read_number(obj, "calm_arrival_prob", &news->calm_arrival_prob);
+    rc |= read_number(obj, "stress_arrival_prob", &news->stress_arrival_prob);
+    rc |= read_number(obj, "calm_scale", &news->calm_scale);
+    rc |= read_number(obj, "stress_scale", &news->stress_scale);
+    rc |= read_number(obj, "regime_switch_to_stress", &news->regime_switch_to_stress);
+    rc |= read_number(obj, "regime_switch_to_calm", &news->regime_switch_to_calm);
+
+    return rc;
+}
+
+static int read_news_targets(const JsonValue *root, SimConfig *cfg)
+{
+    int rc = 0;
+
+    const JsonValue *targets = json_path(root, "news_process.targets");
+    if (!targets) return 0;
+
+    if (targets->type != JSON_ARRAY || targets->count > NEWS_MAX_TARGETS) {
+        fprintf(stderr, "config: 'news_process.targets' must be an array of at most %d targets\n",
+                NEWS_MAX_TARGETS);
+        return -1;
+    }
+
+    for (size_t i = 0; i < targets->count; i++) {
+        const JsonValue *t = &targets->items[i];
+        NewsTargetConfig *tc = &cfg->news_targets[i];
+        char agents[32] = "";
+        uint64_t first = 0, count = 0;
+
+        memset(tc, 0, sizeof(NewsTargetConfig));
+        tc->process = cfg->news;
+        rc |= read_string(t, "agents", agents, sizeof(agents));
+        rc |= read_u64(t, "first", &first);
+        rc |= read_u64(t, "count", &count);
+        rc |= read_news(t, &tc->process);
+
+        if (news_target_from_string(agents, tc) != 0) {
+            fprintf(stderr, "config: news target %zu has unknown agents '%s' "
+                            "(retail, institution, noise, range, community)\n", i, agents);
+            return -1;
+        }
+        if (tc->kind == NEWS_TARGET_RANGE && (count == 0 || first + count > UINT32_MAX)) {
+            fprintf(stderr, "config: news target %zu needs 'first' and a positive 'count'\n", i);
+            return -1;
+        }
+        if (tc->kind == NEWS_TARGET_COMMUNITY && cfg->network.kind == NETWORK_NONE) {
+            fprintf(stderr, "config: news target %zu (community) needs a network\n", i);
+            return -1;
+        }
+        tc->first = (uint32_t)first;
+        tc->count = (uint32_t)count;
+    }
+    cfg->n_news_targets = (int)targets->count;
+
+    return rc;
+}
+
+static int read_network(const JsonValue *root, NetworkConfig *net)
+{
+    int rc = 0;
+    char kind[32] = "", order[32] = "";
+
+    rc |= read_string(root, "network.type", kind, sizeof(kind));
+    rc |= read_int(root, "network.degree", &net->degree);
+    rc |= read_number(root, "network.rewire_prob", &net->rewire_prob);
+    rc |= read_string(root, "network.reorder", order, sizeof(order));
+    rc |= read_bool(root, "network.compress", &net->compress);
+    rc |= read_string(root, "network.edges", net->edges, sizeof(net->edges));
+    rc |= read_string(root, "network.cache", net->cache, sizeof(net->cache));
+    rc |= read_bool(root, "network.symmetrize", &net->symmetrize);
+    rc |= read_bool(root, "network.dedup", &net->dedup);
+
+    char rule[32] = "";
+    RewireConfig *rw = &net->rewire;
+    rc |= read_string(root, "network.rewire.rule", rule, sizeof(rule));
+    rc |= read_int(root, "network.rewire.every", &rw->every);
+    rc |= read_number(root, "network.rewire.rate", &rw->rate);
+    rc |= read_int(root, "network.rewire.candidates", &rw->candidates);
+    rc |= read_number(root, "network.rewire.slack", &rw->slack);
+
+    HubSampleConfig *hs = &net->hub_sample;
+    rc |= read_int(root, "network.hub_sample.above", &hs->above);
+    rc |= read_int(root, "network.hub_sample.size", &hs->size);
+    rc |= read_int(root, "network.hub_sample.every", &hs->every);
+
+    char herding[32] = "";
+    rc |= read_string(root, "network.herding", herding, sizeof(herding));
+    rc |= read_int(root, "network.community.passes", &net->community.passes);
+    rc |= read_number(root, "network.community.global_weight", &net->community.global_weight);
+
+    if (kind[0] != '\0' && network_kind_from_string(kind, &net->kind) != 0) {
+        fprintf(stderr, "config: unknown network type '%s'\n", kind);
+        return -1;
+    }
+    if (order[0] != '\0' && graph_order_from_string(order, &net->order) != 0) {
+        fprintf(stderr, "config: unknown network reorder '%s'\n", order);
+        return -1;
+    }
+    if (net->kind == NETWORK_FILE && net->edges[0] == '\0') {
+        fprintf(stderr, "config: network type 'file' needs 'network.edges'\n");
+        return -1;
+    }
+    if (rule[0] != '\0' && rewire_rule_from_string(rule, &rw->rule) != 0) {
+        fprintf(stderr, "config: unknown network rewire rule '%s'\n", rule);
+        return -1;
+    }
+    if (rw->rule != REWIRE_NONE) {
+        if (net->kind == NETWORK_NONE || net->compress) {
+            fprintf(stderr, "config: network.rewire needs a network without 'compress'\n");
+            return -1;
+        }
+        if (rw->every < 1 || rw->rate < 0.0 || rw->rate > 1.0 ||
+            rw->candidates < 1 || rw->candidates > REWIRE_MAX_CANDIDATES) {
+            fprintf(stderr, "config: network.rewire needs every >= 1, rate in [0, 1] "
+                            "and candidates in 1..%d\n", REWIRE_MAX_CANDIDATES);
+            return -1;
+        }
+    }
+    if (herding[0] != '\0' && herding_mode_from_string(herding, &net->herding) != 0) {
+        fprintf(stderr, "config: unknown network herding '%s'\n", herding);
+        return -1;
+    }
+    if (net->herding == HERDING_COMMUNITY) {
+        if (net->kind == NETWORK_NONE) {
+            fprintf(stderr, "config: community herding needs a network\n");
+            return -1;
+        }
+        if (net->community.passes < 1 || net->community.global_weight < 0.0 ||
+            net->community.global_weight > 1.0) {
+            fprintf(stderr, "config: network.community needs passes >= 1 "
+                            "and global_weight in [0, 1]\n");
+            return -1;
+        }
+    }
+    if (hs->above != 0) {
+        if (net->kind == NETWORK_NONE) {
+            fprintf(stderr, "config: network.hub_sample needs a network\n");
+            return -1;
+        }
+        if (hs->above < 0 || hs->size < 1 || hs->size > GRAPH_WORK_CHUNK ||
+            hs->size >= hs->above || hs->every < 1) {
+            fprintf(stderr, "config: network.hub_sample needs size in 1..%d, "
+                            "above > size and every >= 1\n", GRAPH_WORK_CHUNK);
+            return -1;
+        }
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------
+   Entry points
+---------------------------------------------------- */
+
+int config_parse(SimConfig *cfg, const char *text, size_t len)
+{
+    char err[128];
+    JsonValue *root = json_parse(text, len, err, sizeof(err));
+    if (!root) {
+        fprintf(stderr, "config: %s\n", err);
+        return -1;
+    }
+
+    int rc = 0;
+
+    rc |= read_string(root, "experiment_name", cfg->experiment_name,
+                      sizeof(cfg->experiment_name));
+
+    if (json_get(root, "random_seed")) {
+        rc |= read_u64(root, "random_seed", &cfg->random_seed);
+        cfg->has_seed = true;
+    }
+    rc |= read_u64(root, "simulation.time_steps", &cfg->time_steps);
+
+    rc |= read_number(root, "market.initial_price", &cfg->market.initial_price);
+    rc |= read_number(root, "market.liquidity", &cfg->market.liquidity);
+    rc |= read_number(root, "market.impact_coefficient", &cfg->market.impact_coefficient);
+    rc |= read_number(root, "market.volatility_decay", &cfg->market.volatility_decay);
+    rc |= read_number(root, "market.max_price_change", &cfg->market.max_price_change);
+
+    rc |= read_int(root, "population.num_agents", &cfg->population.num_agents);
+    rc |= read_number(root, "population.agent_mix.retail_share", &cfg->population.type_share[0]);
+    rc |= read_number(root, "population.agent_mix.institution_share", &cfg->population.type_share[1]);
+    rc |= read_number(root, "population.agent_mix.noise_share", &cfg->population.type_share[2]);
+    rc |= read_string(root, "population.file", cfg->population.file, sizeof(cfg->population.file));
+
+    rc |= read_network(root, &cfg->network);
+
+    rc |= read_agent_type(root, "retail", &cfg->agents[0]);
+    rc |= read_agent_type(root, "institution", &cfg->agents[1]);
+    rc |= read_agent_type(root, "noise", &cfg->agents[2]);
+
+    const JsonValue *news = json_get(root, "news_process");
+    if (news) rc |= read_news(news, &cfg->news);
+    rc |= read_news_targets(root, cfg);
+
+    char spread[32] = "";
+    rc |= read_string(root, "information_flow.spread", spread, sizeof(spread));
+    rc |= read_number(root, "information_flow.base_attention", &cfg->information_flow.base_attention);
+    rc |= read_int(root, "information_flow.max_propagation_steps",
+                   &cfg->information_flow.max_propagation_steps);
+    rc |= read_number(root, "information_flow.temporal_decay", &cfg->information_flow.temporal_decay);
+    rc |= read_int(root, "information_flow.hop_latency", &cfg->information_flow.hop_latency);
+
+    rc |= read_number(root, "statistics.jump_threshold", &cfg->statistics.jump_threshold);
+    rc |= read_number(root, "statistics.ewma_decay", &cfg->statistics.ewma_decay);
+
+    rc |= read_output(root, &cfg->output);
+
+    json_free(root);
+
+    if (rc == 0 && cfg->population.num_agents <= 0) {
+        fprintf(stderr, "config: 'population.num_agents' must be positive\n");
+        rc = -1;
+    }
+    if (rc == 0 && cfg->information_flow.hop_latency < 0) {
+        fprintf(stderr, "config: 'information_flow.hop_latency' must be >= 0\n");
+        rc = -1;
+    }
+    if (rc == 0 && spread[0] != '\0' &&
+        news_spread_from_string(spread, &cfg->information_flow.spread) != 0) {
+        fprintf(stderr, "config: unknown information_flow spread '%s'\n", spread);
+        rc = -1;
+    }
+    if (rc == 0 && cfg->information_flow.spread == NEWS_SPREAD_NETWORK &&
+        cfg->network.kind == NETWORK_NONE) {
+        fprintf(stderr, "config: information_flow spread 'network' needs a network\n");
+        rc = -1;
+    }
+    if (rc == 0 && cfg->information_flow.hop_latency > 0 &&
+        cfg->information_flow.spread != NEWS_SPREAD_NETWORK) {
+        fprintf(stderr, "config: 'information_flow.hop_latency' needs spread 'network'\n");
+        rc = -1;
+    }
+
+    return rc == 0 ? 0 : -1;
+}
+
+char *config_read_text(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "config: cannot open %s\n", path);
+        return NULL;
+    }
+
+    /* Pipes and other unseekable files have no size to read up front */
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "config: cannot determine the size of %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+
+    char *text = malloc((size_t)size + 1);
+    if (!text) {
+        fprintf(stderr, "config: out of memory reading %s\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    *len = fread(text, 1, (size_t)size, fp);
+    fclose(fp);
+    text[*len] = '\0';
+
+    return text;
+}
+
+int config_load(SimConfig *cfg, const char *path)
+{
+    size_t len = 0;
+    char *text = config_read_text(path, &len);
+    if (!text) return -1;
+
+    int rc = config_parse(cfg, text, len);
+    free(text);
+    return rc;
+}
@@ -0,0 +1,171 @@
+#ifndef JUMPSIM_CONFIG_H
+#define JUMPSIM_CONFIG_H
+
+/*
+ * config.h
+ * --------
+ * Experiment configuration for JumpSim.
+ *
+ * Mirrors the JSON files in experiments/. Every field has a default equal
+ * to the built-in parameters, so a config only needs to list what it
+ * changes and the simulator still runs with no config at all.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "writer.h"
+#include "graph.h"
+
+/* -------------------- Sections -------------------- */
+
+#define CONFIG_NAME_MAX 64
+#define CONFIG_AGENT_TYPES 3   /* indexed by AgentType */
+
+typedef struct MarketConfig {
+    double initial_price;
+    double liquidity;
+    double impact_coefficient;
+    double volatility_decay;
+    double max_price_change;
+} MarketConfig;
+
+typedef struct PopulationConfig {
+    int num_agents;
+    double type_share[CONFIG_AGENT_TYPES];  /* retail, institution, noise */
+    char file[OUTPUT_PATH_MAX];   /* optional population file (popfile.h); overrides the above */
+} PopulationConfig;
+
+/*
+ * Per-agent parameter distribution. A plain number in the config is a
+ * constant; an object selects a distribution, e.g.
+ *   { "dist": "lognormal", "mu": 0.0, "sigma": 0.3 }
+ *   { "dist": "beta", "alpha": 2, "beta": 8 }            (on [0,1])
+ *   { "dist": "normal", "mean": 1.0, "std": 0.2, "min": 0 }
+ *   { "dist": "uniform", "min": 0.5, "max": 1.5 }
+ * Optional "min"/"max" clamp (normal, lognormal) or rescale (beta) draws.
+ */
+typedef enum {
+    DIST_CONSTANT = 0,
+    DIST_NORMAL,
+    DIST_LOGNORMAL,
+    DIST_UNIFORM,
+    DIST_BETA
+} DistKind;
+
+typedef struct ParamDist {
+    DistKind kind;
+    double a;        /* value | mean | mu | min | alpha */
+    double b;        /* -     | std  | sigma | max | beta */
+    double lo, hi;   /* clamp / beta support */
+} ParamDist;
+
+/* Shorthand for a constant parameter */
+#define PARAM_CONST(v) ((ParamDist){ DIST_CONSTANT, (v), 0.0, -HUGE_VAL, HUGE_VAL })
+
+typedef struct AgentTypeConfig {
+    ParamDist aggressiveness;
+    ParamDist risk_aversion;
+    ParamDist network_influence;
+    ParamDist noise_std;
+    ParamDist belief_update_rate;
+    ParamDist liquidity_tolerance;
+} AgentTypeConfig;
+
+typedef struct NewsConfig {
+    double calm_arrival_prob;
+    double stress_arrival_prob;
+    double calm_scale;
+    double stress_scale;
+    double regime_switch_to_stress;
+    double regime_switch_to_calm;
+} NewsConfig;
+
+/*
+ * Targeted news (news_process.targets): stories that hit a subset of
+ * agents, each target with its own arrival process, e.g.
+ *   { "agents": "retail", "calm_arrival_prob": 0.02 }
+ *   { "agents": "range", "first": 0, "count": 1000 }
+ *   { "agents": "community" }
+ * Arrival fields default to those of news_process.
+ */
+#define NEWS_MAX_TARGETS 8
+
+typedef enum {
+    NEWS_TARGET_TYPE = 0,      /* every agent of one type */
+    NEWS_TARGET_RANGE,         /* original ids first .. first+count-1 */
+    NEWS_TARGET_COMMUNITY      /* per story, one community drawn by size (a sector) */
+} NewsTargetKind;
+
+typedef struct NewsTargetConfig {
+    NewsTargetKind kind;
+    int type;                  /* AgentType, NEWS_TARGET_TYPE */
+    uint32_t first, count;     /* NEWS_TARGET_RANGE */
+    NewsConfig process;
+} NewsTargetConfig;
+
+/* How news reaches agents ("information_flow.spread") */
+typedef enum {
+    NEWS_SPREAD_BROADCAST = 0, /* every agent reacts directly, by type (kernels.h) */
+    NEWS_SPREAD_NETWORK        /* diffusion through the agent network (information_flow.h) */
+} NewsSpread;
+
+typedef struct InformationFlowConfig {
+    NewsSpread spread;
+    double base_attention;
+    int max_propagation_steps;
+    double temporal_decay;
+    int hop_latency;          /* market steps per network hop; 0 = all hops at once */
+} InformationFlowConfig;
+
+typedef struct StatisticsConfig {
+    double jump_threshold;
+    double ewma_decay;
+} StatisticsConfig;
+
+typedef struct SimConfig {
+    char experiment_name[CONFIG_NAME_MAX];
+
+    bool has_seed;               /* false => seed chosen at run time */
+    uint64_t random_seed;
+    uint64_t time_steps;
+
+    MarketConfig market;
+    PopulationConfig population;
+    NetworkConfig network;
+    AgentTypeConfig agents[CONFIG_AGENT_TYPES];
+    NewsConfig news;
+    NewsTargetConfig news_targets[NEWS_MAX_TARGETS];
+    int n_news_targets;
+    InformationFlowConfig information_flow;
+    StatisticsConfig statistics;
+    OutputConfig output;
+} SimConfig;
+
+/* -------------------- API (implemented in config.c) -------------------- */
+
+/* Fill 'cfg' with the built-in defaults */
+void config_defaults(SimConfig *cfg);
+
+/*
+ * Parse JSON text over the defaults.
+ * Returns 0 on success, -1 on malformed JSON or invalid values
+ * (a message is printed to stderr).
+ */
+int config_parse(SimConfig *cfg, const char *text, size_t len);
+
+/*
+ * Read a config file verbatim (for parsing and for run records).
+ * Returns a NUL-terminated heap buffer, or NULL if unreadable.
+ */
+char *config_read_text(const char *path, size_t *len);
+
+/*
+ * Read and parse a JSON config file over the defaults.
+ * Returns 0 on success, -1 on failure.
+ */
+int config_load(SimConfig *cfg, const char *path);
+
+#endif /* JUMPSIM_CONFIG_H */
@@ -0,0 +1,174 @@
+#include "ensemble.h"
+#include "kernels.h"
+#include "information_flow.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ----------------------------------------------------
+   Setup / Teardown
+---------------------------------------------------- */
+
+int ensemble_init(Ensemble *e, const Simulation *base, size_t k)
+{
+    size_t n = (size_t)base->n_agents;
+
+    memset(e, 0, sizeof(Ensemble));
+    e->base = base;
+    e->k = k;
+    e->n = n;
+
+    e->markets = malloc(k * sizeof(Market));
+    e->rng_state = malloc(k * sizeof(uint64_t));
+    e->shock = malloc(k * sizeof(double));
+    e->price = malloc(k * sizeof(double));
+    if (!e->markets || !e->rng_state || !e->shock || !e->price ||
+        agent_state_alloc(&e->state, n * k) != 0) {
+        ensemble_free(e);
+        return -1;
+    }
+
+    if (base->cfg.information_flow.spread == NEWS_SPREAD_NETWORK) {
+        e->column = malloc(n * sizeof(double));
+        if (!e->column) {
+            ensemble_free(e);
+            return -1;
+        }
+    }
+    if (base->neighbor_mean) {
+        e->neighbor_mean = malloc(n * k * sizeof(double));
+        if (!e->neighbor_mean) {
+            ensemble_free(e);
+            return -1;
+        }
+    }
+
+    for (size_t r = 0; r < k; r++) {
+        e->markets[r] = base->market;
+        e->rng_state[r] = simulation_replica_seed(base->seeds.dynamics, r);
+    }
+
+    /* Interleave the initial state; streams as in simulation_init_replica */
+    const AgentState *from = &base->state;
+    AgentState *to = &e->state;
+    long count = (long)n;
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < count; i++) {
+        for (size_t r = 0; r < k; r++) {
+            size_t at = (size_t)i * k + r;
+            to->belief[at] = from->belief[i];
+            to->cash[at] = from->cash[i];
+            to->position[at] = from->position[i];
+            to->rng_state[at] = simulation_replica_seed(from->rng_state[i], r);
+        }
+    }
+
+    e->step = 0;
+    return 0;
+}
+
+void ensemble_free(Ensemble *e)
+{
+    agent_state_free(&e->state);
+    free(e->neighbor_mean);
+    free(e->column);
+    free(e->markets);
+    free(e->rng_state);
+    free(e->shock);
+    free(e->price);
+    memset(e, 0, sizeof(Ensemble));
+}
+
+/* ----------------------------------------------------
+   Network shocks
+---------------------------------------------------- */
+
+/*
+ Diffusion (information_flow.c) is rare and works on one belief column,
+ so each shocked replica's column is gathered, propagated and scattered.
+*/
+static void propagate_shocks(Ensemble *e)
+{
+    const Simulation *base = e->base;
+    size_t n = e->n, k = e->k;
+
+    for (size_t r = 0; r < k; r++) {
+        if (e->shock[r] == 0.0) continue;
+
+        for (size_t i = 0; i < n; i++) e->column[i] = e->state.belief[i * k + r];
+
+        AgentState view = { .n = n, .belief = e->column };
+        information_propagate(&base->params, &view, &base->graph,
+                              &base->cfg.information_flow, e->shock[r]);
+
+        for (size_t i = 0; i < n; i++) e->state.belief[i * k + r] = e->column[i];
+    }
+}
+
+/* ----------------------------------------------------
+   Time Step
+---------------------------------------------------- */
+
+/* Phase for phase the same as simulation_step(), for k replicas */
+void ensemble_step(Ensemble *e, StepRecord *recs)
+{
+    const Simulation *base = e->base;
+    size_t k = e->k;
+    bool diffused = base->cfg.information_flow.spread == NEWS_SPREAD_NETWORK;
+    bool any_shock = false;
+
+    for (size_t r = 0; r < k; r++) {
+        market_begin_step(&e->markets[r]);
+        e->shock[r] = simulation_news_shock(&e->rng_state[r]);
+        any_shock |= (e->shock[r] != 0.0);
+    }
+
+    /* Broadcast news is applied by the demand pass (kernels.h) */
+    if (any_shock && diffused) propagate_shocks(e);
+
+    /* Each network row (or community block) is read once for all replicas */
+    if (e->neighbor_mean) {
+        if (base->cfg.network.herding != HERDING_COMMUNITY ||
+            community_mean_k(&base->communities, e->state.belief, k,
+                             base->cfg.network.community.global_weight, e->neighbor_mean) != 0) {
+            graph_neighbor_mean_k(&base->graph, e->state.belief, k, e->neighbor_mean);
+        }
+    }
+
+    kernel_demand_execute_k(&base->params, &e->state, k, e->markets, e->shock,
+                            diffused ? NULL : e->shock, e->neighbor_mean);
+
+    for (size_t r = 0; r < k; r++) {
+        market_clear(&e->markets[r]);
+        market_update_volatility(&e->markets[r]);
+        e->price[r] = e->markets[r].price;
+    }
+
+    kernel_update_beliefs_k(&base->params, &e->state, k, e->price, e->shock);
+
+    for (size_t r = 0; r < k; r++) {
+        Market *market = &e->markets[r];
+        double logret = market_log_return(market);
+
+        if (recs) {
+            StepRecord *rec = &recs[r];
+            rec->time = e->step;
+            rec->price = market->price;
+            rec->log_return = logret;
+            rec->volatility = market->volatility;
+            rec->shock = e->shock[r];
+            rec->volume = market->cumulative_volume;
+            rec->jump = fabs(logret) > base->cfg.statistics.jump_threshold;
+        }
+
+        /* Circuit breaker, as in simulation_step() */
+        if (fabs(logret) > 0.15)
+            market_halt(market);
+        else
+            market_resume(market);
+    }
+
+    e->step++;
+}
@@ -0,0 +1,59 @@
+#ifndef JUMPSIM_ENSEMBLE_H
+#define JUMPSIM_ENSEMBLE_H
+
+/*
+ * ensemble.h
+ * ----------
+ * Lockstep ensemble: k replicas of one run advanced together.
+ *
+ * Small populations (hundreds of agents) leave cores and vector lanes
+ * idle when run one at a time. Here every state column is laid out
+ * [agent][replica] (belief[i * k + r]), so each step's kernels read an
+ * agent's parameters and network row once and apply them to all k
+ * replicas in a unit-stride inner loop (kernels.h, graph.h).
+ *
+ * Replica r follows exactly the random streams of simulation_init_replica
+ * (replica 0 is the plain run): its price path is bit-identical to
+ * running that replica on its own.
+ *
+ * Parameters, network and config are borrowed from the base Simulation,
+ * which must not have stepped yet and must outlive the ensemble.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "simulation.h"
+
+/* -------------------- Types -------------------- */
+
+typedef struct Ensemble {
+    const Simulation *base;   /* shared parameters, network, config */
+    size_t k;                 /* replicas */
+    size_t n;                 /* agents per replica */
+
+    AgentState state;         /* n * k values per column */
+    double *neighbor_mean;    /* n * k herding gather, NULL without a network */
+    double *column;           /* n: one replica's beliefs (network shocks) */
+
+    Market *markets;          /* k */
+    uint64_t *rng_state;      /* k dynamics streams */
+    double *shock;            /* k: this step's news */
+    double *price;            /* k: post-clearing prices */
+    uint64_t step;
+} Ensemble;
+
+/* -------------------- API (implemented in ensemble.c) -------------------- */
+
+/* Set up replicas 0 .. k-1 of 'base'. Returns 0 / -1 */
+int ensemble_init(Ensemble *e, const Simulation *base, size_t k);
+
+/*
+ * Advance every replica one step; recs[r] describes replica r
+ * ('recs' may be NULL, else k entries).
+ */
+void ensemble_step(Ensemble *e, StepRecord *recs);
+
+void ensemble_free(Ensemble *e);
+
+#endif /* JUMPSIM_ENSEMBLE_H */
@@ -0,0 +1,431 @@
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ----------------------------------------------------
+   Internal utilities (private to kernels.c)
+---------------------------------------------------- */
+
+/* Same xorshift64 + Box–Muller draw as agent.c, so both views agree */
+static inline double kernel_normal(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+
+    double u1 = (x & 0xFFFFFFFF) / (double)0xFFFFFFFF;
+    double u2 = ((x >> 32) & 0xFFFFFFFF) / (double)0xFFFFFFFF;
+
+    if (u1 < 1e-12) u1 = 1e-12;
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static inline size_t block_count(size_t n)
+{
+    return (n + KERNEL_BLOCK - 1) / KERNEL_BLOCK;
+}
+
+/* ----------------------------------------------------
+   Shock response
+---------------------------------------------------- */
+
+/*
+ Only noise traders draw here, so the branch stays: skipping the draw
+ for everyone else is what keeps their RNG streams untouched.
+*/
+static inline void shock_agent(const AgentParams *p, AgentState *s, size_t i, double shock)
+{
+    const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[p->type[i]];
+    if (r->shock_noise != 0.0)
+        s->belief[i] += shock * kernel_normal(&s->rng_state[i]);
+    else
+        s->belief[i] += r->shock_gain * shock;
+}
+
+void kernel_apply_shock(const AgentParams *p, AgentState *s, double shock)
+{
+    long n = (long)s->n;
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) shock_agent(p, s, (size_t)i, shock);
+}
+
+void kernel_apply_shock_ranges(const AgentParams *p, AgentState *s,
+                               const AgentRange *ranges, size_t n_ranges, double shock)
+{
+    long count = (long)n_ranges;
+
+    /* Ranges are disjoint, so any split over them is race-free */
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long k = 0; k < count; k++) {
+        for (uint32_t i = ranges[k].first; i < ranges[k].end; i++) shock_agent(p, s, i, shock);
+    }
+}
+
+/* ----------------------------------------------------
+   Sentiment
+---------------------------------------------------- */
+
+double kernel_mean_belief(const AgentState *s)
+{
+    size_t n = s->n;
+    if (n == 0) return 0.0;
+
+    long nb = (long)block_count(n);
+    double *partial = malloc((size_t)nb * sizeof(double));
+    if (!partial) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; i++) sum += s->belief[i];
+        return sum / (double)n;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < nb; b++) {
+        size_t lo = (size_t)b * KERNEL_BLOCK;
+        size_t hi = lo + KERNEL_BLOCK < n ? lo + KERNEL_BLOCK : n;
+        double sum = 0.0;
+        for (size_t i = lo; i < hi; i++) sum += s->belief[i];
+        partial[b] = sum;
+    }
+
+    double total = 0.0;
+    for (long b = 0; b < nb; b++) total += partial[b];
+    free(partial);
+
+    return total / (double)n;
+}
+
+/* ----------------------------------------------------
+   Demand + execution (fused)
+---------------------------------------------------- */
+
+/*
+ Dispersion sums of one block, while its columns are still in cache.
+ Accumulators are spread over several copies so that runs of agents
+ in the same type or bin do not serialize on one memory location.
+*/
+static void dispersion_block(const AgentParams *p, const AgentState *s,
+                             size_t lo, size_t hi, double price,
+                             const DispersionLog *d, DispersionBlock *out)
+{
+    double dev[KERNEL_BLOCK];
+    uint32_t hist[4][AGENT_TYPE_COUNT * DISP_BINS];
+    double acc[2][AGENT_TYPE_COUNT][4];    /* count, sum d, sum q, sum q^2 */
+    size_t m = hi - lo;
+    double inv = 1.0 / price;
+    const uint8_t *type = p->type + lo;
+    const int32_t *position = s->position + lo;
+
+    memset(hist, 0, sizeof(hist));
+    memset(acc, 0, sizeof(acc));
+    for (size_t k = 0; k < m; k++) {
+        double x = s->belief[lo + k] * inv - 1.0;
+        double q = (double)position[k];
+        double *a = acc[k & 1][type[k]];
+
+        dev[k] = x;
+        hist[k & 3][type[k] * DISP_BINS + disp_bin(d, x)]++;
+        a[0] += 1.0;
+        a[1] += x;
+        a[2] += q;
+        a[3] += q * q;
+    }
+
+    double mean[AGENT_TYPE_COUNT], cm[2][AGENT_TYPE_COUNT][2];
+    memset(out, 0, sizeof(DispersionBlock));
+    memset(cm, 0, sizeof(cm));
+    for (int t = 0; t < AGENT_TYPE_COUNT; t++) {
+        double n = acc[0][t][0] + acc[1][t][0];
+        out->n[t] = (uint32_t)n;
+        mean[t] = n > 0.0 ? (acc[0][t][1] + acc[1][t][1]) / n : 0.0;
+        out->position[t][0] = acc[0][t][2] + acc[1][t][2];
+        out->position[t][1] = acc[0][t][3] + acc[1][t][3];
+        for (int k = 0; k < DISP_BINS; k++) {
+            int at = t * DISP_BINS + k;
+            out->hist[t][k] = hist[0][at] + hist[1][at] + hist[2][at] + hist[3][at];
+        }
+    }
+
+    /* Central moments about the block's own means */
+    for (size_t k = 0; k < m; k++) {
+        double e = dev[k] - mean[type[k]];
+        double *c = cm[k & 1][type[k]];
+        c[0] += e * e;
+        c[1] += e * e * e;
+    }
+    for (int t = 0; t < AGENT_TYPE_COUNT; t++) {
+        out->belief[t][0] = mean[t];
+        out->belief[t][1] = cm[0][t][0] + cm[1][t][0];
+        out->belief[t][2] = cm[0][t][1] + cm[1][t][1];
+    }
+}
+
+static void demand_block(const AgentParams *p, AgentState *s,
+                         size_t lo, size_t hi,
+                         double price, double shock, double belief_shock,
+                         const double *neighbor_mean, TapeBlock *tape,
+                         DispersionLog *disp, size_t block,
+                         double *net_out, double *gross_out)
+{
+    double net = 0.0, gross = 0.0;
+
+    for (size_t i = lo; i < hi; i++) {
+        const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[p->type[i]];
+        double belief = s->belief[i];
+
+        /* Deferred broadcast shock first, as kernel_apply_shock() would have */
+        if (belief_shock != 0.0) {
+            belief += r->shock_noise != 0.0
+                    ? belief_shock * kernel_normal(&s->rng_state[i])
+                    : r->shock_gain * belief_shock;
+            s->belief[i] = belief;
+        }
+
+        /* Same decomposition as agent_compute_demand() */
+        double signal = belief - price
+                      + r->anchor_weight * (p->fundamental_anchor[i] - price);
+        double inventory_cost = p->risk_aversion[i] * position_penalty(s->position[i]);
+        double herding = neighbor_mean
+                       ? p->network_influence[i] * (neighbor_mean[i] - belief)
+                       : 0.0;
+        double noise = p->noise_std[i] * kernel_normal(&s->rng_state[i]);
+
+        double raw = p->aggressiveness[i] * signal
+                   - inventory_cost
+                   + herding
+                   + noise
+                   + shock;
+
+        /* Liquidity threshold as a select rather than an early return */
+        double demand = fabs(raw) < p->liquidity_tolerance[i]
+                      ? 0.0 : p->trade_size_scale[i] * raw;
+
+        net += demand;
+        gross += fabs(demand);
+
+        /* Mean-field execution at the pre-clearing price */
+        int executed = (int)round(demand);
+        s->position[i] += executed;
+        s->cash[i] -= executed * price;
+
+        if (tape && executed != 0) tape_put(tape, (uint32_t)i, executed);
+    }
+
+    if (disp) dispersion_block(p, s, lo, hi, price, disp, &disp->blocks[block]);
+
+    *net_out = net;
+    *gross_out = gross;
+}
+
+void kernel_demand_execute(const AgentParams *p,
+                           AgentState *s,
+                           Market *m,
+                           double price,
+                           double shock,
+                           double belief_shock,
+                           const double *neighbor_mean,
+                           ExecTape *tape,
+                           DispersionLog *disp)
+{
+    size_t n = s->n;
+    long nb = (long)block_count(n);
+    double *partial = malloc(2 * (size_t)nb * sizeof(double));
+
+    if (!partial) {
+        /* Same blocks, one after the other (the tape stages by block) */
+        double net = 0.0, gross = 0.0;
+        for (long b = 0; b < nb; b++) {
+            size_t lo = (size_t)b * KERNEL_BLOCK;
+            size_t hi = lo + KERNEL_BLOCK < n ? lo + KERNEL_BLOCK : n;
+            double bn, bg;
+            demand_block(p, s, lo, hi, price, shock, belief_shock, neighbor_mean,
+                         tape ? &tape->blocks[b] : NULL, disp, (size_t)b, &bn, &bg);
+            net += bn;
+            gross += bg;
+        }
+        market_add_flow(m, net, gross);
+        return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < nb; b++) {
+        size_t lo = (size_t)b * KERNEL_BLOCK;
+        size_t hi = lo + KERNEL_BLOCK < n ? lo + KERNEL_BLOCK : n;
+        demand_block(p, s, lo, hi, price, shock, belief_shock, neighbor_mean,
+                     tape ? &tape->blocks[b] : NULL, disp, (size_t)b,
+                     &partial[2 * b], &partial[2 * b + 1]);
+    }
+
+    /* Combine block sums in block order: independent of thread count */
+    double net = 0.0, gross = 0.0;
+    for (long b = 0; b < nb; b++) {
+        net += partial[2 * b];
+        gross += partial[2 * b + 1];
+    }
+    free(partial);
+
+    market_add_flow(m, net, gross);
+}
+
+/* ----------------------------------------------------
+   Belief update
+---------------------------------------------------- */
+
+void kernel_update_beliefs(const AgentParams *p, AgentState *s,
+                           double observed_price, double shock)
+{
+    const uint8_t *type = p->type;
+    const double *rate = p->belief_update_rate;
+    const double *anchor = p->fundamental_anchor;
+    double *belief = s->belief;
+    long n = (long)s->n;
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[type[i]];
+        double target = r->price_weight * observed_price
+                      + r->anchor_target * anchor[i];
+        belief[i] += rate[i] * (target - belief[i]);
+        belief[i] += 0.1 * shock;
+    }
+}
+
+void kernel_update_beliefs_at(const AgentParams *p, AgentState *s,
+                              const uint32_t *ids, size_t count,
+                              double observed_price, double shock)
+{
+    long n = (long)count;
+
+    #pragma omp parallel for schedule(static)
+    for (long k = 0; k < n; k++) {
+        uint32_t i = ids[k];
+        const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[p->type[i]];
+        double target = r->price_weight * observed_price
+                      + r->anchor_target * p->fundamental_anchor[i];
+        s->belief[i] += p->belief_update_rate[i] * (target - s->belief[i]);
+        s->belief[i] += 0.1 * shock;
+    }
+}
+
+/* ----------------------------------------------------
+   Lockstep ensemble ([agent][replica] state)
+---------------------------------------------------- */
+
+/* Per-replica sums accumulate in agent order, as in demand_block() */
+static void demand_block_k(const AgentParams *p, AgentState *s, size_t k,
+                           size_t lo, size_t hi,
+                           const Market *m, const double *shock,
+                           const double *belief_shock,
+                           const double *neighbor_mean,
+                           double *net, double *gross)
+{
+    for (size_t q = 0; q < k; q++) net[q] = gross[q] = 0.0;
+
+    for (size_t i = lo; i < hi; i++) {
+        const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[p->type[i]];
+        double aggressiveness = p->aggressiveness[i];
+        double anchor = p->fundamental_anchor[i];
+        double risk_aversion = p->risk_aversion[i];
+        double influence = p->network_influence[i];
+        double noise_std = p->noise_std[i];
+        double tolerance = p->liquidity_tolerance[i];
+        double scale = p->trade_size_scale[i];
+
+        size_t at = i * k;
+        for (size_t q = 0; q < k; q++) {
+            double price = m[q].price;
+            double belief = s->belief[at + q];
+
+            if (belief_shock && belief_shock[q] != 0.0) {
+                belief += r->shock_noise != 0.0
+                        ? belief_shock[q] * kernel_normal(&s->rng_state[at + q])
+                        : r->shock_gain * belief_shock[q];
+                s->belief[at + q] = belief;
+            }
+
+            double signal = belief - price + r->anchor_weight * (anchor - price);
+            double inventory_cost = risk_aversion * position_penalty(s->position[at + q]);
+            double herding = neighbor_mean
+                           ? influence * (neighbor_mean[at + q] - belief)
+                           : 0.0;
+            double noise = noise_std * kernel_normal(&s->rng_state[at + q]);
+
+            double raw = aggressiveness * signal
+                       - inventory_cost
+                       + herding
+                       + noise
+                       + shock[q];
+
+            double demand = fabs(raw) < tolerance ? 0.0 : scale * raw;
+
+            net[q] += demand;
+            gross[q] += fabs(demand);
+
+            int executed = (int)round(demand);
+            s->position[at + q] += executed;
+            s->cash[at + q] -= executed * price;
+        }
+    }
+}
+
+void kernel_demand_execute_k(const AgentParams *p, AgentState *s, size_t k,
+                             Market *m, const double *shock,
+                             const double *belief_shock,
+                             const double *neighbor_mean)
+{
+    size_t n = p->n;
+    long nb = (long)block_count(n);
+    double *partial = malloc(2 * k * (size_t)(nb ? nb : 1) * sizeof(double));
+
+    if (!partial) {
+        double *sums = malloc(2 * k * sizeof(double));
+        if (!sums) return;
+        demand_block_k(p, s, k, 0, n, m, shock, belief_shock, neighbor_mean, sums, sums + k);
+        for (size_t q = 0; q < k; q++) market_add_flow(&m[q], sums[q], sums[k + q]);
+        free(sums);
+        return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < nb; b++) {
+        size_t lo = (size_t)b * KERNEL_BLOCK;
+        size_t hi = lo + KERNEL_BLOCK < n ? lo + KERNEL_BLOCK : n;
+        double *block = partial + 2 * k * (size_t)b;
+        demand_block_k(p, s, k, lo, hi, m, shock, belief_shock, neighbor_mean, block, block + k);
+    }
+
+    /* Combine block sums in block order, per replica */
+    for (size_t q = 0; q < k; q++) {
+        double net = 0.0, gross = 0.0;
+        for (long b = 0; b < nb; b++) {
+            net += partial[2 * k * (size_t)b + q];
+            gross += partial[2 * k * (size_t)b + k + q];
+        }
+        market_add_flow(&m[q], net, gross);
+    }
+    free(partial);
+}
+
+void kernel_update_beliefs_k(const AgentParams *p, AgentState *s, size_t k,
+                             const double *observed_price, const double *shock)
+{
+    long n = (long)p->n;
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        const AgentTypeResponse *r = &AGENT_TYPE_RESPONSE[p->type[i]];
+        double rate = p->belief_update_rate[i];
+        double anchor_term = r->anchor_target * p->fundamental_anchor[i];
+        double *belief = s->belief + (size_t)i * k;
+
+        for (size_t q = 0; q < k; q++) {
+            double target = r->price_weight * observed_price[q] + anchor_term;
+            belief[q] += rate * (target - belief[q]);
+            belief[q] += 0.1 * shock[q];
+        }
+    }
+}
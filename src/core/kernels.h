@@ -0,0 +1,113 @@
+#ifndef JUMPSIM_KERNELS_H
+#define JUMPSIM_KERNELS_H
+
+/*
+ * kernels.h
+ * ---------
+ * Columnar step kernels: the agent.c behavior applied to a whole
+ * population stored as AgentParams/AgentState columns.
+ *
+ * Design goals:
+ *  - Same economics as agent.c (agent_compute_demand, agent_update_belief,
+ *    agent_apply_shock), one streaming pass per phase
+ *  - No branching on agent type in the per-step passes: type-dependent
+ *    coefficients come from AGENT_TYPE_RESPONSE, and continuous per-agent
+ *    parameters make heterogeneity free at run time
+ *  - Deterministic reductions: order flow is summed in fixed-size blocks
+ *    and the block sums are combined in order, so results do not depend
+ *    on the number of OpenMP threads
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "population.h"
+#include "market.h"
+#include "tape.h"
+#include "dispersion.h"
+
+/* Agents per reduction block (fixed so sums are thread-count independent) */
+#define KERNEL_BLOCK 4096
+
+/*
+ * Apply a broadcast news shock to every belief (agent_apply_shock).
+ * Steps defer this to the demand pass instead (belief_shock below) and
+ * call it only when something else must see the shocked beliefs first.
+ */
+void kernel_apply_shock(const AgentParams *p, AgentState *s, double shock);
+
+/*
+ * The same for the agents in 'ranges' only (targeted news); per agent
+ * bit-identical to kernel_apply_shock.
+ */
+void kernel_apply_shock_ranges(const AgentParams *p, AgentState *s,
+                               const AgentRange *ranges, size_t n_ranges, double shock);
+
+/*
+ * Mean belief over the population.
+ */
+double kernel_mean_belief(const AgentState *s);
+
+/*
+ * Fused demand pass: compute each agent's demand, execute it at
+ * 'price' (mean-field assumption) and submit the block-reduced order flow
+ * to the market.
+ *
+ *  - belief_shock: broadcast shock not yet applied to beliefs (0 = none).
+ *    The pass adds it as kernel_apply_shock() would, agent by agent just
+ *    before reading the belief: the per-type gain is a constant and only
+ *    noise traders draw, from the stream their demand noise uses next,
+ *    so results are bit-identical and the shock costs no pass of its own.
+ *  - neighbor_mean: per-agent mean neighbor belief, or NULL when there is
+ *    no network (herding term is then zero, as in agent_compute_demand)
+ *  - tape: execution tape opened with KERNEL_BLOCK, or NULL; every nonzero
+ *    execution goes to its block's staging area (tape_end_step follows)
+ *  - disp: dispersion log opened with KERNEL_BLOCK, or NULL; each block
+ *    leaves its per-type sums and bin counts there (disp_end_step follows)
+ */
+void kernel_demand_execute(const AgentParams *p,
+                           AgentState *s,
+                           Market *m,
+                           double price,
+                           double shock,
+                           double belief_shock,
+                           const double *neighbor_mean,
+                           ExecTape *tape,
+                           DispersionLog *disp);
+
+/*
+ * Adaptive belief update after the market has cleared (agent_update_belief).
+ */
+void kernel_update_beliefs(const AgentParams *p, AgentState *s,
+                           double observed_price, double shock);
+
+/*
+ * The same update for the agents listed in ids[0 .. count-1] only
+ * (bit-identical per agent), e.g. halo copies in a sharded run.
+ */
+void kernel_update_beliefs_at(const AgentParams *p, AgentState *s,
+                              const uint32_t *ids, size_t count,
+                              double observed_price, double shock);
+
+/* -------------------- Lockstep ensemble -------------------- */
+
+/*
+ * The same kernels for k replicas advanced together (ensemble.h): state
+ * columns hold k values per agent, s->belief[i * k + r], and s->n is
+ * n_agents * k. Parameters are read once per agent for all replicas and
+ * the inner loop over replicas is unit-stride. Per replica, results are
+ * bit-identical to the single-replica kernels.
+ *
+ *  - shock[r]: replica r's news shock (0 = none)
+ *  - belief_shock[r]: replica r's deferred broadcast shock, or NULL
+ *  - m[r]: replica r's market; demand executes at m[r].price
+ */
+void kernel_demand_execute_k(const AgentParams *p, AgentState *s, size_t k,
+                             Market *m, const double *shock,
+                             const double *belief_shock,
+                             const double *neighbor_mean);
+
+void kernel_update_beliefs_k(const AgentParams *p, AgentState *s, size_t k,
+                             const double *observed_price, const double *shock);
+
+#endif /* JUMPSIM_KERNELS_H */
@@ -70,6 +70,12 @@ void market_add_demand(Market *m, double signed_demand)
     m->cumulative_volume += fabs(signed_demand);
 }
 
+void market_add_flow(Market *m, double net_demand, double gross_volume)
+{
+    m->cumulative_demand += net_demand;
+    m->cumulative_volume += gross_volume;
+}
+
 /* ----------------------------------------------------
    Market Clearing & Price Formation
 ---------------------------------------------------- */
@@ -83,6 +83,18 @@ void market_begin_step(Market *m);
  */
 void market_add_demand(Market *m, double signed_demand);
 
+/*
+ * Submit pre-aggregated order flow from a batch of agents.
+ *
+ * Arguments:
+ *  - net_demand: sum of signed demands
+ *  - gross_volume: sum of |demand|
+ *
+ * Equivalent to calling market_add_demand() for each agent; used by the
+ * columnar kernels, which reduce a whole block before touching the market.
+ */
+void market_add_flow(Market *m, double net_demand, double gross_volume);
+
 /*
  * Clear the market and update price.
  *
@@ -0,0 +1,387 @@
+#include "population.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ----------------------------------------------------
+   Counter-based draws
+---------------------------------------------------- */
+
+/*
+ Draw k for agent id: a hash of (seed, id, k). Independent of the order
+ in which agents are generated, which is what makes generation parallel
+ and regeneration exact.
+
+ Draw indices:
+   0            type (alias column)
+   1            noise RNG seed
+   2            type (alias coin)
+   16 + 64*p..  parameter p (room for rejection sampling)
+*/
+
+#define DRAW_TYPE        0
+#define DRAW_NOISE       1
+#define DRAW_TYPE_COIN   2
+#define DRAW_PARAM_BASE  16
+#define DRAW_PARAM_SPAN  64
+
+static inline uint64_t agent_draw(uint64_t seed, AgentId id, uint64_t k)
+{
+    return hash_mix64(hash_mix64(seed ^ ((uint64_t)id << 8)) + k);
+}
+
+/* Uniform in (0, 1] */
+static inline double agent_uniform(uint64_t seed, AgentId id, uint64_t k)
+{
+    return ((agent_draw(seed, id, k) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double agent_normal(uint64_t seed, AgentId id, uint64_t k)
+{
+    double u1 = agent_uniform(seed, id, k);
+    double u2 = agent_uniform(seed, id, k + 1);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* Marsaglia–Tsang; consumes draws k, k+1, ... */
+static double agent_gamma(uint64_t seed, AgentId id, uint64_t k, double alpha)
+{
+    double boost = 1.0;
+    if (alpha < 1.0) {
+        boost = pow(agent_uniform(seed, id, k++), 1.0 / alpha);
+        alpha += 1.0;
+    }
+
+    double d = alpha - 1.0 / 3.0;
+    double c = 1.0 / sqrt(9.0 * d);
+
+    /* Acceptance is > 95%; the cap only bounds the draw budget */
+    for (int tries = 0; tries < DRAW_PARAM_SPAN / 8; tries++) {
+        double z = agent_normal(seed, id, k);
+        double u = agent_uniform(seed, id, k + 2);
+        k += 3;
+
+        double v = 1.0 + c * z;
+        if (v <= 0.0) continue;
+        v = v * v * v;
+
+        if (log(u) < 0.5 * z * z + d - d * v + d * log(v)) return boost * d * v;
+    }
+    return boost * d;
+}
+
+static double clamp(double x, double lo, double hi)
+{
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+static double sample_param(const ParamDist *d, uint64_t seed, AgentId id, int param)
+{
+    uint64_t k = DRAW_PARAM_BASE + (uint64_t)param * DRAW_PARAM_SPAN;
+
+    switch (d->kind) {
+        case DIST_NORMAL:
+            return clamp(d->a + d->b * agent_normal(seed, id, k), d->lo, d->hi);
+
+        case DIST_LOGNORMAL:
+            return clamp(exp(d->a + d->b * agent_normal(seed, id, k)), d->lo, d->hi);
+
+        case DIST_UNIFORM:
+            return d->a + (d->b - d->a) * agent_uniform(seed, id, k);
+
+        case DIST_BETA: {
+            double x = agent_gamma(seed, id, k, d->a);
+            double y = agent_gamma(seed, id, k + DRAW_PARAM_SPAN / 2, d->b);
+            return d->lo + (d->hi - d->lo) * x / (x + y);
+        }
+
+        case DIST_CONSTANT:
+        default:
+            return d->a;
+    }
+}
+
+/* ----------------------------------------------------
+   Alias table (Vose)
+---------------------------------------------------- */
+
+int alias_build(AliasTable *t, const double *weights, int n)
+{
+    if (n <= 0 || n > ALIAS_MAX_OUTCOMES) return -1;
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) total += (weights[i] > 0.0) ? weights[i] : 0.0;
+    if (total <= 0.0) return -1;
+
+    double scaled[ALIAS_MAX_OUTCOMES];
+    int small[ALIAS_MAX_OUTCOMES], large[ALIAS_MAX_OUTCOMES];
+    int ns = 0, nl = 0;
+
+    for (int i = 0; i < n; i++) {
+        double w = (weights[i] > 0.0) ? weights[i] : 0.0;
+        scaled[i] = w * n / total;
+        if (scaled[i] < 1.0) small[ns++] = i;
+        else large[nl++] = i;
+    }
+
+    t->n = n;
+
+    while (ns > 0 && nl > 0) {
+        int s = small[--ns];
+        int l = large[--nl];
+
+        t->prob[s] = scaled[s];
+        t->alias[s] = l;
+
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) small[ns++] = l;
+        else large[nl++] = l;
+    }
+
+    /* Leftovers are 1.0 up to rounding */
+    while (nl > 0) { int l = large[--nl]; t->prob[l] = 1.0; t->alias[l] = l; }
+    while (ns > 0) { int s = small[--ns]; t->prob[s] = 1.0; t->alias[s] = s; }
+
+    return 0;
+}
+
+int alias_sample(const AliasTable *t, uint64_t u_column, uint64_t u_coin)
+{
+    /*
+     Separate draws: bits shared by the column and the coin would
+     correlate them and bias the shares
+    */
+    int col = (int)(((u_column >> 32) * (uint64_t)t->n) >> 32);
+    double coin = (u_coin >> 11) * (1.0 / 9007199254740992.0);
+
+    return (coin < t->prob[col]) ? col : t->alias[col];
+}
+
+/* ----------------------------------------------------
+   Population spec
+---------------------------------------------------- */
+
+int population_spec_init(PopulationSpec *spec, const SimConfig *cfg, uint64_t seed)
+{
+    memset(spec, 0, sizeof(PopulationSpec));
+
+    spec->seed = seed;
+    spec->init_price = cfg->market.initial_price;
+    memcpy(spec->params, cfg->agents, sizeof(spec->params));
+
+    if (alias_build(&spec->types, cfg->population.type_share, CONFIG_AGENT_TYPES) != 0) {
+        fprintf(stderr, "population: agent mix must have a positive share\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Column storage
+---------------------------------------------------- */
+
+static void free_column(void *col, const unsigned char *mapping, size_t mapping_size)
+{
+    uintptr_t c = (uintptr_t)col;
+    uintptr_t lo = (uintptr_t)mapping;
+
+    if (mapping && c >= lo && c < lo + mapping_size) return;
+    free(col);
+}
+
+int agent_params_alloc(AgentParams *p, size_t n)
+{
+    memset(p, 0, sizeof(AgentParams));
+    p->n = n;
+
+    p->type = malloc(n ? n : 1);
+    p->aggressiveness = malloc(n * sizeof(double));
+    p->trade_size_scale = malloc(n * sizeof(double));
+    p->risk_aversion = malloc(n * sizeof(double));
+    p->liquidity_tolerance = malloc(n * sizeof(double));
+    p->belief_update_rate = malloc(n * sizeof(double));
+    p->network_influence = malloc(n * sizeof(double));
+    p->noise_std = malloc(n * sizeof(double));
+    p->fundamental_anchor = malloc(n * sizeof(double));
+
+    if (!p->type || !p->aggressiveness || !p->trade_size_scale || !p->risk_aversion ||
+        !p->liquidity_tolerance || !p->belief_update_rate || !p->network_influence ||
+        !p->noise_std || !p->fundamental_anchor) {
+        agent_params_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+void agent_params_free(AgentParams *p)
+{
+    free_column(p->type, p->mapping, p->mapping_size);
+    free_column(p->aggressiveness, p->mapping, p->mapping_size);
+    free_column(p->trade_size_scale, p->mapping, p->mapping_size);
+    free_column(p->risk_aversion, p->mapping, p->mapping_size);
+    free_column(p->liquidity_tolerance, p->mapping, p->mapping_size);
+    free_column(p->belief_update_rate, p->mapping, p->mapping_size);
+    free_column(p->network_influence, p->mapping, p->mapping_size);
+    free_column(p->noise_std, p->mapping, p->mapping_size);
+    free_column(p->fundamental_anchor, p->mapping, p->mapping_size);
+    memset(p, 0, sizeof(AgentParams));
+}
+
+int agent_state_alloc(AgentState *s, size_t n)
+{
+    memset(s, 0, sizeof(AgentState));
+    s->n = n;
+
+    s->belief = malloc(n * sizeof(double));
+    s->cash = malloc(n * sizeof(double));
+    s->rng_state = malloc(n * sizeof(uint64_t));
+    s->position = malloc(n * sizeof(int32_t));
+
+    if (!s->belief || !s->cash || !s->rng_state || !s->position) {
+        agent_state_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+void agent_state_free(AgentState *s)
+{
+    free_column(s->belief, s->mapping, s->mapping_size);
+    free_column(s->cash, s->mapping, s->mapping_size);
+    free_column(s->rng_state, s->mapping, s->mapping_size);
+    free_column(s->position, s->mapping, s->mapping_size);
+    memset(s, 0, sizeof(AgentState));
+}
+
+/* Gather 'col' through 'perm' into a fresh column; frees the old one */
+#define PERMUTE_COLUMN(owner, field, T)                                     \
+    do {                                                                    \
+        T *next_ = malloc((n ? n : 1) * sizeof(T));                         \
+        if (!next_) return -1;                                              \
+        _Pragma("omp parallel for schedule(static)")                        \
+        for (long i_ = 0; i_ < (long)n; i_++) next_[i_] = (owner)->field[perm[i_]]; \
+        free_column((owner)->field, (owner)->mapping, (owner)->mapping_size); \
+        (owner)->field = next_;                                             \
+    } while (0)
+
+int population_permute(AgentParams *params, AgentState *state, const uint32_t *perm)
+{
+    size_t n = params->n;
+
+    PERMUTE_COLUMN(params, type, uint8_t);
+    PERMUTE_COLUMN(params, aggressiveness, double);
+    PERMUTE_COLUMN(params, trade_size_scale, double);
+    PERMUTE_COLUMN(params, risk_aversion, double);
+    PERMUTE_COLUMN(params, liquidity_tolerance, double);
+    PERMUTE_COLUMN(params, belief_update_rate, double);
+    PERMUTE_COLUMN(params, network_influence, double);
+    PERMUTE_COLUMN(params, noise_std, double);
+    PERMUTE_COLUMN(params, fundamental_anchor, double);
+
+    PERMUTE_COLUMN(state, belief, double);
+    PERMUTE_COLUMN(state, cash, double);
+    PERMUTE_COLUMN(state, rng_state, uint64_t);
+    PERMUTE_COLUMN(state, position, int32_t);
+
+    return 0;
+}
+
+#undef PERMUTE_COLUMN
+
+/* ----------------------------------------------------
+   Generation
+---------------------------------------------------- */
+
+/* Parameter draw order (part of the reproducibility contract) */
+enum {
+    PARAM_AGGRESSIVENESS = 0,
+    PARAM_RISK_AVERSION,
+    PARAM_NETWORK_INFLUENCE,
+    PARAM_NOISE_STD,
+    PARAM_BELIEF_UPDATE_RATE,
+    PARAM_LIQUIDITY_TOLERANCE
+};
+
+uint64_t population_rng_seed(const PopulationSpec *spec, AgentId id)
+{
+    return hash_derive_seed(agent_draw(spec->seed, id, DRAW_NOISE), id);
+}
+
+void population_make_agent(const PopulationSpec *spec, AgentId id, Agent *out)
+{
+    uint64_t seed = spec->seed;
+    AgentType type = (AgentType)alias_sample(&spec->types, agent_draw(seed, id, DRAW_TYPE),
+                                             agent_draw(seed, id, DRAW_TYPE_COIN));
+    const AgentTypeConfig *p = &spec->params[type];
+
+    agent_init(out,
+               id,
+               type,
+               "",                    /* named on demand */
+               spec->init_price,
+               sample_param(&p->aggressiveness, seed, id, PARAM_AGGRESSIVENESS),
+               1.0,                   /* trade size scale */
+               sample_param(&p->risk_aversion, seed, id, PARAM_RISK_AVERSION),
+               sample_param(&p->liquidity_tolerance, seed, id, PARAM_LIQUIDITY_TOLERANCE),
+               sample_param(&p->belief_update_rate, seed, id, PARAM_BELIEF_UPDATE_RATE),
+               sample_param(&p->network_influence, seed, id, PARAM_NETWORK_INFLUENCE),
+               sample_param(&p->noise_std, seed, id, PARAM_NOISE_STD),
+               spec->init_price,      /* fundamental anchor */
+               population_rng_seed(spec, id));
+}
+
+void population_generate(const PopulationSpec *spec, AgentParams *params, AgentState *state)
+{
+    size_t n = params->n;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++) {
+        Agent a;
+        population_make_agent(spec, (AgentId)i, &a);
+
+        params->type[i] = (uint8_t)a.type;
+        params->aggressiveness[i] = a.aggressiveness;
+        params->trade_size_scale[i] = a.trade_size_scale;
+        params->risk_aversion[i] = a.risk_aversion;
+        params->liquidity_tolerance[i] = a.liquidity_tolerance;
+        params->belief_update_rate[i] = a.belief_update_rate;
+        params->network_influence[i] = a.network_influence;
+        params->noise_std[i] = a.noise_std;
+        params->fundamental_anchor[i] = a.fundamental_anchor;
+
+        state->belief[i] = a.belief;
+        state->cash[i] = a.cash;
+        state->rng_state[i] = a.rng_state;
+        state->position[i] = a.position;
+    }
+}
+
+void population_materialize(const AgentParams *params, const AgentState *state,
+                            size_t i, Agent *out)
+{
+    agent_init(out,
+               (AgentId)i,
+               (AgentType)params->type[i],
+               "",
+               state->belief[i],
+               params->aggressiveness[i],
+               params->trade_size_scale[i],
+               params->risk_aversion[i],
+               params->liquidity_tolerance[i],
+               params->belief_update_rate[i],
+               params->network_influence[i],
+               params->noise_std[i],
+               params->fundamental_anchor[i],
+               state->rng_state[i]);
+
+    out->cash = state->cash[i];
+    out->position = state->position[i];
+    population_agent_name(out->id, out->name, sizeof(out->name));
+}
+
+void population_agent_name(AgentId id, char *buf, size_t cap)
+{
+    snprintf(buf, cap, "Agent_%u", id);
+}
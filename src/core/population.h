@@ -0,0 +1,143 @@
+#ifndef JUMPSIM_POPULATION_H
+#define JUMPSIM_POPULATION_H
+
+/*
+ * population.h
+ * ------------
+ * Columnar (structure-of-arrays) agent population and its procedural,
+ * stateless generator.
+ *
+ * Storage:
+ *  - AgentParams : parameters fixed after setup (type, aggressiveness, ...)
+ *  - AgentState  : columns that change every step (belief, cash, ...)
+ *  Step kernels (kernels.h) stream over these columns; the AoS Agent in
+ *  agent.h remains the single-agent view used for dumps and analysis.
+ *
+ * Generation: every agent's type and parameters are a pure function of
+ * (population seed, agent id):
+ *
+ *   type   = alias_sample(type table, hash(seed, id, 0), hash(seed, id, 2))
+ *   params = draw from the type's per-parameter distributions,
+ *            using hash(seed, id, k) for the k-th uniform
+ *
+ * There is no sequential RNG stream, so:
+ *  - initialization is embarrassingly parallel (OpenMP over ids)
+ *  - any single agent can be regenerated on demand, e.g. for a debug
+ *    dump, without touching the rest of the population
+ *  - names are not materialized; population_agent_name() derives one
+ *    when needed
+ *
+ * Type shares are sampled in O(1) per agent with Walker/Vose alias tables.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "agent.h"
+#include "config.h"
+
+/* -------------------- Types -------------------- */
+
+#define ALIAS_MAX_OUTCOMES 16
+
+/* Walker alias table over a small discrete distribution */
+typedef struct AliasTable {
+    int n;
+    double prob[ALIAS_MAX_OUTCOMES];   /* probability of keeping column i */
+    int alias[ALIAS_MAX_OUTCOMES];     /* outcome used otherwise */
+} AliasTable;
+
+/* Everything needed to regenerate any agent */
+typedef struct PopulationSpec {
+    uint64_t seed;
+    double init_price;
+    AliasTable types;
+    AgentTypeConfig params[CONFIG_AGENT_TYPES];
+} PopulationSpec;
+
+/*
+ * Columns are either heap-allocated or borrowed from a read-only file
+ * mapping (popfile.h); columns inside [mapping, mapping + mapping_size)
+ * are not freed by the *_free functions.
+ */
+
+/* Parameters fixed after setup (one column per field) */
+typedef struct AgentParams {
+    size_t n;
+    const unsigned char *mapping;
+    size_t mapping_size;
+    uint8_t *type;                 /* AgentType */
+    double *aggressiveness;
+    double *trade_size_scale;
+    double *risk_aversion;
+    double *liquidity_tolerance;
+    double *belief_update_rate;
+    double *network_influence;
+    double *noise_std;
+    double *fundamental_anchor;
+} AgentParams;
+
+/* Columns that change during a run */
+typedef struct AgentState {
+    size_t n;
+    const unsigned char *mapping;  /* copy-on-write when borrowed */
+    size_t mapping_size;
+    double *belief;
+    double *cash;
+    uint64_t *rng_state;
+    int32_t *position;
+} AgentState;
+
+/* Agents first .. end-1; selections are ascending, disjoint ranges */
+typedef struct AgentRange {
+    uint32_t first, end;
+} AgentRange;
+
+/* -------------------- API (implemented in population.c) -------------------- */
+
+/*
+ * Build an alias table from 'n' non-negative weights (normalized
+ * internally). Returns 0 on success, -1 if n is out of range or all
+ * weights are zero.
+ */
+int alias_build(AliasTable *t, const double *weights, int n);
+
+/*
+ * Draw an outcome from two independent uniform 64-bit values: one picks
+ * the column, the other tosses its coin
+ */
+int alias_sample(const AliasTable *t, uint64_t u_column, uint64_t u_coin);
+
+/* Capture the type mix and per-type distributions from 'cfg' */
+int population_spec_init(PopulationSpec *spec, const SimConfig *cfg, uint64_t seed);
+
+/* Allocate columns for 'n' agents; returns 0 on success, -1 on failure */
+int agent_params_alloc(AgentParams *p, size_t n);
+int agent_state_alloc(AgentState *s, size_t n);
+void agent_params_free(AgentParams *p);
+void agent_state_free(AgentState *s);
+
+/* Fill parameters and initial state for agents [0, n) in parallel */
+void population_generate(const PopulationSpec *spec, AgentParams *params, AgentState *state);
+
+/* Seed of agent 'id's noise RNG stream */
+uint64_t population_rng_seed(const PopulationSpec *spec, AgentId id);
+
+/*
+ * Reorder every column so that new index i holds old agent perm[i]
+ * (see reorder.h). Borrowed columns are replaced by owned copies.
+ * Returns 0 / -1.
+ */
+int population_permute(AgentParams *params, AgentState *state, const uint32_t *perm);
+
+/* Deterministically (re)create agent 'id' in its initial state */
+void population_make_agent(const PopulationSpec *spec, AgentId id, Agent *out);
+
+/* Assemble the AoS view of agent 'i' from its columns */
+void population_materialize(const AgentParams *params, const AgentState *state,
+                            size_t i, Agent *out);
+
+/* Display name for agent 'id' ("Agent_<id>") */
+void population_agent_name(AgentId id, char *buf, size_t cap);
+
+#endif /* JUMPSIM_POPULATION_H */
@@ -0,0 +1,490 @@
+#define _GNU_SOURCE   /* memfd_create */
+#include "shard.h"
+#include "kernels.h"
+#include "information_flow.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+/* ----------------------------------------------------
+   Exchange plan
+---------------------------------------------------- */
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ Halo lists per shard (remote ids its rows read), then the boundary:
+ every id in some halo, in id order, so each shard's posted slots are
+ one contiguous run of the mailbox.
+*/
+static int build_halo(ShardPlan *plan, const Graph *g)
+{
+    size_t n = g->n, max_deg = 0;
+    int k = plan->k;
+
+    for (size_t i = 0; i < n; i++) {
+        if (graph_degree(g, i) > max_deg) max_deg = graph_degree(g, i);
+    }
+
+    uint32_t *stamp = calloc(n ? n : 1, sizeof(uint32_t));   /* last shard + 1 to list it */
+    uint32_t *row = malloc((max_deg ? max_deg : 1) * sizeof(uint32_t));
+    size_t cap = 1024, count = 0;
+    plan->halo = malloc(cap * sizeof(uint32_t));
+    if (!stamp || !row || !plan->halo) {
+        free(stamp); free(row);
+        return -1;
+    }
+
+    for (int s = 0; s < k; s++) {
+        size_t lo = plan->start[s], hi = plan->start[s + 1];
+        plan->halo_start[s] = count;
+
+        for (size_t v = lo; v < hi; v++) {
+            size_t d = graph_row(g, v, row);
+            for (size_t e = 0; e < d; e++) {
+                uint32_t u = row[e];
+                if ((u >= lo && u < hi) || stamp[u] == (uint32_t)s + 1) continue;
+                stamp[u] = (uint32_t)s + 1;
+
+                if (count == cap) {
+                    uint32_t *grown = realloc(plan->halo, 2 * cap * sizeof(uint32_t));
+                    if (!grown) {
+                        free(stamp); free(row);
+                        return -1;
+                    }
+                    plan->halo = grown;
+                    cap *= 2;
+                }
+                plan->halo[count++] = u;
+            }
+        }
+        qsort(plan->halo + plan->halo_start[s], count - plan->halo_start[s],
+              sizeof(uint32_t), cmp_u32);
+    }
+    plan->halo_start[k] = count;
+    free(row);
+
+    /* Boundary: stamp becomes "slot + 1" for every id read remotely */
+    memset(stamp, 0, (n ? n : 1) * sizeof(uint32_t));
+    for (size_t j = 0; j < count; j++) stamp[plan->halo[j]] = 1;
+
+    size_t n_boundary = 0;
+    for (size_t v = 0; v < n; v++) n_boundary += stamp[v];
+
+    plan->boundary = malloc((n_boundary ? n_boundary : 1) * sizeof(uint32_t));
+    plan->halo_slot = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!plan->boundary || !plan->halo_slot) {
+        free(stamp);
+        return -1;
+    }
+
+    size_t at = 0;
+    for (int s = 0; s < k; s++) {
+        plan->boundary_start[s] = at;
+        for (size_t v = plan->start[s]; v < plan->start[s + 1]; v++) {
+            if (!stamp[v]) continue;
+            stamp[v] = (uint32_t)at + 1;
+            plan->boundary[at++] = (uint32_t)v;
+        }
+    }
+    plan->boundary_start[k] = at;
+    plan->n_boundary = at;
+
+    for (size_t j = 0; j < count; j++) plan->halo_slot[j] = stamp[plan->halo[j]] - 1;
+
+    free(stamp);
+    return 0;
+}
+
+int shard_plan_build(ShardPlan *plan, const Simulation *sim)
+{
+    memset(plan, 0, sizeof(ShardPlan));
+    plan->k = sim->n_shards;
+    plan->start = sim->shard_start;
+
+    if (plan->k < 2 || !plan->start) {
+        fprintf(stderr, "shard: simulation was not set up for sharding\n");
+        return -1;
+    }
+
+    size_t k = (size_t)plan->k;
+    plan->halo_start = calloc(k + 1, sizeof(size_t));
+    plan->boundary_start = calloc(k + 1, sizeof(size_t));
+    if (!plan->halo_start || !plan->boundary_start) {
+        shard_plan_free(plan);
+        return -1;
+    }
+
+    if (sim->graph.n == 0) return 0;
+
+    if (build_halo(plan, &sim->graph) != 0) {
+        shard_plan_free(plan);
+        return -1;
+    }
+    if (sim->cfg.information_flow.spread != NEWS_SPREAD_NETWORK) return 0;
+
+    plan->response = malloc((size_t)sim->n_agents * sizeof(double));
+    if (!plan->response ||
+        information_response(&sim->params, &sim->graph,
+                             &sim->cfg.information_flow, plan->response) != 0) {
+        shard_plan_free(plan);
+        return -1;
+    }
+    return 0;
+}
+
+void shard_plan_free(ShardPlan *plan)
+{
+    free(plan->halo);
+    free(plan->halo_slot);
+    free(plan->halo_start);
+    free(plan->boundary);
+    free(plan->boundary_start);
+    free(plan->response);
+    memset(plan, 0, sizeof(ShardPlan));
+}
+
+/* ----------------------------------------------------
+   Shared mailbox & barrier
+---------------------------------------------------- */
+
+/*
+ Sense-reversing barrier on process-shared atomics. Waiters yield
+ rather than sleep: a step is short and every shard arrives within it.
+ 'failed' releases everyone when a shard dies or cannot continue.
+ All-zero (a fresh memfd page) is the initial state.
+*/
+typedef struct ShardShared {
+    _Atomic unsigned arrived;
+    _Atomic unsigned sense;
+    _Atomic int failed;
+} ShardShared;
+
+/* One process's view of the mailbox: header, flow[2][k][2], box[2][n_boundary] */
+typedef struct Mailbox {
+    ShardShared *sh;
+    double *flow[2];           /* (net, gross) per shard, by step parity */
+    double *box[2];            /* boundary beliefs, by step parity */
+    size_t bytes;
+    int k;
+} Mailbox;
+
+#define MAILBOX_HEADER 64
+
+static int mailbox_map(Mailbox *mb, int fd, int k, size_t n_boundary)
+{
+    mb->k = k;
+    mb->bytes = MAILBOX_HEADER + (4 * (size_t)k + 2 * n_boundary) * sizeof(double);
+
+    /* Every shard derives the same size, so the order of these calls is free */
+    if (ftruncate(fd, (off_t)mb->bytes) != 0) return -1;
+
+    void *base = mmap(NULL, mb->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) return -1;
+
+    double *data = (double *)((unsigned char *)base + MAILBOX_HEADER);
+    mb->sh = base;
+    mb->flow[0] = data;
+    mb->flow[1] = data + 2 * (size_t)k;
+    mb->box[0] = data + 4 * (size_t)k;
+    mb->box[1] = mb->box[0] + n_boundary;
+    return 0;
+}
+
+typedef struct ShardProcs {
+    pid_t *pid;                /* k; pid[0] unused (this process) */
+    bool *reaped;
+    int k;
+} ShardProcs;
+
+/* Reap exited shards without blocking; true if one failed */
+static bool procs_failed(ShardProcs *procs)
+{
+    int status;
+    pid_t pid;
+    bool failed = false;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int s = 1; s < procs->k; s++) {
+            if (procs->pid[s] == pid) procs->reaped[s] = true;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+    }
+    return failed;
+}
+
+/* 'procs' is set in shard 0, which watches the other processes */
+static int barrier_wait(Mailbox *mb, unsigned *sense, ShardProcs *procs)
+{
+    ShardShared *sh = mb->sh;
+    *sense ^= 1u;
+
+    if (atomic_fetch_add(&sh->arrived, 1u) + 1u == (unsigned)mb->k) {
+        atomic_store(&sh->arrived, 0u);
+        atomic_store(&sh->sense, *sense);
+        return 0;
+    }
+
+    for (unsigned spins = 1; atomic_load(&sh->sense) != *sense; spins++) {
+        if (atomic_load(&sh->failed)) return -1;
+        if (procs && spins % 1024 == 0 && procs_failed(procs)) {
+            atomic_store(&sh->failed, 1);
+            return -1;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Shard loop
+---------------------------------------------------- */
+
+/* Columns of agents lo .. hi-1 (kernels index from the pointers given) */
+static AgentParams params_slice(const AgentParams *p, size_t lo, size_t hi)
+{
+    AgentParams v = *p;
+    v.n = hi - lo;
+    v.type += lo;
+    v.aggressiveness += lo;
+    v.trade_size_scale += lo;
+    v.risk_aversion += lo;
+    v.liquidity_tolerance += lo;
+    v.belief_update_rate += lo;
+    v.network_influence += lo;
+    v.noise_std += lo;
+    v.fundamental_anchor += lo;
+    return v;
+}
+
+static AgentState state_slice(const AgentState *s, size_t lo, size_t hi)
+{
+    AgentState v = *s;
+    v.n = hi - lo;
+    v.belief += lo;
+    v.cash += lo;
+    v.rng_state += lo;
+    v.position += lo;
+    return v;
+}
+
+/* Phase for phase the same as simulation_step(), for agents of shard s */
+static int shard_loop(Simulation *sim, const ShardPlan *plan, Mailbox *mb,
+                      int s, PriceWriter *writer, ShardProcs *procs)
+{
+    size_t lo = plan->start[s], hi = plan->start[s + 1];
+    AgentParams params = params_slice(&sim->params, lo, hi);
+    AgentState state = state_slice(&sim->state, lo, hi);
+    double *belief = sim->state.belief;
+    bool network = sim->graph.n > 0;
+    bool diffused = sim->cfg.information_flow.spread == NEWS_SPREAD_NETWORK;
+
+    const uint32_t *halo = plan->halo ? plan->halo + plan->halo_start[s] : NULL;
+    const uint32_t *halo_slot = plan->halo_slot ? plan->halo_slot + plan->halo_start[s] : NULL;
+    size_t n_halo = plan->halo_start[s + 1] - plan->halo_start[s];
+    size_t post_lo = plan->boundary_start[s], post_hi = plan->boundary_start[s + 1];
+
+    Market *market = &sim->market;
+    double last_price = market->price, last_shock = 0.0;
+    unsigned sense = 0;
+
+    while (sim->step < sim->cfg.time_steps) {
+        int parity = (int)(sim->step & 1);
+
+        market_begin_step(market);
+        simulation_sample_hubs(sim);
+        double shock = simulation_news_shock(&sim->rng_state);
+        bool diffuse = diffused && fabs(shock) >= 1e-9;   /* as information_propagate */
+
+        const double *neighbor_mean = NULL;
+        if (network) {
+            /* Halo: owners' posted beliefs, advanced to where the owner is now */
+            if (sim->step > 0) {
+                const double *box = mb->box[parity ^ 1];
+                for (size_t j = 0; j < n_halo; j++) belief[halo[j]] = box[halo_slot[j]];
+                kernel_update_beliefs_at(&sim->params, &sim->state, halo, n_halo,
+                                         last_price, last_shock);
+            }
+            if (diffuse) {
+                for (size_t i = lo; i < hi; i++) belief[i] += shock * plan->response[i];
+                for (size_t j = 0; j < n_halo; j++) {
+                    belief[halo[j]] += shock * plan->response[halo[j]];
+                }
+            }
+
+            graph_neighbor_mean_range(&sim->graph, belief, lo, hi, sim->neighbor_mean);
+            neighbor_mean = sim->neighbor_mean + lo;
+        }
+
+        /* This shard's order flow goes to the mailbox, not the market */
+        Market partial = *market;
+        kernel_demand_execute(&params, &state, &partial, market->price, shock,
+                              diffused ? 0.0 : shock, neighbor_mean, NULL, NULL);
+
+        double *flow = mb->flow[parity];
+        flow[2 * s] = partial.cumulative_demand;
+        flow[2 * s + 1] = partial.cumulative_volume;
+
+        double *box = mb->box[parity];
+        for (size_t j = post_lo; j < post_hi; j++) box[j] = belief[plan->boundary[j]];
+
+        /* The step's one communication round */
+        if (barrier_wait(mb, &sense, procs) != 0) return -1;
+
+        double net = 0.0, gross = 0.0;
+        for (int q = 0; q < plan->k; q++) {
+            net += flow[2 * q];
+            gross += flow[2 * q + 1];
+        }
+        market_add_flow(market, net, gross);
+
+        market_clear(market);
+        market_update_volatility(market);
+        kernel_update_beliefs(&params, &state, market->price, shock);
+        last_price = market->price;
+        last_shock = shock;
+
+        double logret = market_log_return(market);
+
+        if (writer) {
+            StepRecord rec;
+            rec.time = sim->step;
+            rec.price = market->price;
+            rec.log_return = logret;
+            rec.volatility = market->volatility;
+            rec.shock = shock;
+            rec.volume = market->cumulative_volume;
+            rec.jump = fabs(logret) > sim->cfg.statistics.jump_threshold;
+            writer_push(writer, &rec);
+        }
+
+        /* Circuit breaker, as in simulation_step() */
+        if (fabs(logret) > 0.15)
+            market_halt(market);
+        else
+            market_resume(market);
+
+        sim->step++;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Processes
+---------------------------------------------------- */
+
+/* Everything one shard process does; shard 0 also writes the outputs */
+static int run_shard(const SimConfig *cfg, uint64_t master_seed, int k, int s,
+                     int fd, ShardProcs *procs)
+{
+    Simulation sim;
+    ShardPlan plan;
+    Mailbox mb = { 0 };
+    PriceWriter writer;
+    bool writing = false;
+    int rc = -1;
+
+    /* Same config and seed: every shard builds the same agents and partition */
+    if (simulation_init_sharded(&sim, cfg, master_seed, k) != 0) return -1;
+
+    if (shard_plan_build(&plan, &sim) != 0) {
+        simulation_free(&sim);
+        return -1;
+    }
+
+    if (mailbox_map(&mb, fd, k, plan.n_boundary) != 0) {
+        fprintf(stderr, "shard: cannot map the shared mailbox\n");
+        goto done;
+    }
+
+    if (s == 0) {
+        printf("Sharded run: %d processes, %zu halo beliefs exchanged per step "
+               "(%.2f%% of agents)\n", k, plan.halo_start[k],
+               100.0 * (double)plan.halo_start[k] / (double)sim.n_agents);
+        if (writer_open(&writer, &cfg->output) != 0) goto done;
+        writing = true;
+    }
+
+    rc = shard_loop(&sim, &plan, &mb, s, writing ? &writer : NULL, procs);
+
+done:
+    if (rc != 0 && mb.sh) atomic_store(&mb.sh->failed, 1);
+    if (writing) writer_close(&writer);
+    if (mb.sh) munmap(mb.sh, mb.bytes);
+    shard_plan_free(&plan);
+    simulation_free(&sim);
+    return rc;
+}
+
+int shard_run(const SimConfig *cfg, uint64_t master_seed, int k)
+{
+    int fd = memfd_create("jumpsim-shards", MFD_CLOEXEC);
+    ShardProcs procs = {
+        .pid = calloc((size_t)k, sizeof(pid_t)),
+        .reaped = calloc((size_t)k, sizeof(bool)),
+        .k = k
+    };
+    int rc = -1;
+
+    if (fd < 0 || !procs.pid || !procs.reaped) {
+        fprintf(stderr, "shard: cannot create the shared mailbox\n");
+        goto done;
+    }
+
+    /*
+     Fork before anything runs in parallel: an OpenMP runtime that has
+     started threads does not survive fork(), so each shard sets itself
+     up in its own process (shared graph caches and population files
+     are mapped, so their pages are still shared).
+    */
+    fflush(NULL);
+    pid_t parent = getpid();
+    int started = 1;
+
+    for (; started < k; started++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "shard: cannot start shard %d\n", started);
+            break;
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent) _exit(1);
+            _exit(run_shard(cfg, master_seed, k, started, fd, NULL) == 0 ? 0 : 1);
+        }
+        procs.pid[started] = pid;
+    }
+
+    if (started == k) rc = run_shard(cfg, master_seed, k, 0, fd, &procs);
+
+    /* Shards still waiting at a barrier for a failed run would never return */
+    for (int s = 1; s < started; s++) {
+        int status;
+        if (procs.reaped[s]) continue;
+        if (rc != 0) kill(procs.pid[s], SIGKILL);
+        if (waitpid(procs.pid[s], &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            rc = -1;
+        }
+    }
+    if (rc != 0) fprintf(stderr, "shard: sharded run failed\n");
+
+done:
+    if (fd >= 0) close(fd);
+    free(procs.pid);
+    free(procs.reaped);
+    return rc;
+}
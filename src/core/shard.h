@@ -0,0 +1,83 @@
+#ifndef JUMPSIM_SHARD_H
+#define JUMPSIM_SHARD_H
+
+/*
+ * shard.h
+ * -------
+ * Sharded execution: one run split across k local processes.
+ *
+ * The population is partitioned (partition.h) so that shard s owns the
+ * contiguous agents shard_start[s] .. shard_start[s+1]-1 and updates only
+ * those. Setup is a pure function of (config, seed), so every process
+ * builds the same agents and partition itself, as a cluster rank would.
+ * Every shard keeps a copy of the market and of the news stream and
+ * performs the same clearing, so prices need no broadcast.
+ *
+ * One communication round per step, through a shared-memory mailbox
+ * (a memfd inherited by every shard process):
+ *  - each shard posts its demand partial (net, gross) and the beliefs
+ *    of its boundary agents (those other shards' rows read)
+ *  - a barrier
+ *  - every shard sums the partials in shard order and clears the market
+ *
+ * Boundary beliefs are posted after the news shock and before the
+ * post-clearing update. The receiver finishes the step for its halo
+ * copies itself: the belief update (cleared price) and the next shock
+ * are pure functions of an agent's own belief and parameters, so the
+ * halo holds exactly the beliefs the owner gathers with. Diffusion of
+ * news uses the precomputed unit-shock response (information_flow.h),
+ * which needs no communication at all.
+ *
+ * Mailboxes are double-buffered by step parity: the barrier of step t
+ * guarantees every read of step t-1's slots is done before they are
+ * overwritten. The plan (ranges, halo and boundary index lists, mailbox
+ * slots) is what a message-passing transport needs as well.
+ *
+ * Results are deterministic for a given shard count. They agree with the
+ * single-process run up to rounding (order of the demand sums, shock
+ * response), so sharded runs are not recorded.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "simulation.h"
+
+/* -------------------- Types -------------------- */
+
+typedef struct ShardPlan {
+    int k;                     /* shards */
+    const size_t *start;       /* k + 1 agent bounds (the Simulation's) */
+
+    /* Halo of shard s: halo[halo_start[s] .. halo_start[s+1]), sorted ids
+       owned by other shards; halo[j] is posted in mailbox slot halo_slot[j] */
+    uint32_t *halo;
+    uint32_t *halo_slot;
+    size_t *halo_start;
+
+    /* Agents some other shard reads, ascending; mailbox slot = position.
+       Shard s posts boundary[boundary_start[s] .. boundary_start[s+1]) */
+    uint32_t *boundary;
+    size_t *boundary_start;
+    size_t n_boundary;
+
+    double *response;          /* unit-shock diffusion, NULL unless news spreads over the network */
+} ShardPlan;
+
+/* -------------------- API (implemented in shard.c) -------------------- */
+
+/* Build the exchange plan of a sharded simulation. Returns 0 / -1 */
+int shard_plan_build(ShardPlan *plan, const Simulation *sim);
+
+void shard_plan_free(ShardPlan *plan);
+
+/*
+ * Run the experiment 'cfg' with 'master_seed' split into k processes.
+ * The processes are started first and each sets up its own copy of the
+ * simulation (simulation_init_sharded) before stepping its shard; this
+ * process is shard 0 and writes the outputs. Call it before anything has
+ * run an OpenMP parallel region. Returns 0, or -1 if any shard failed.
+ */
+int shard_run(const SimConfig *cfg, uint64_t master_seed, int k);
+
+#endif /* JUMPSIM_SHARD_H */
@@ -0,0 +1,202 @@
+#ifndef JUMPSIM_SIMULATION_H
+#define JUMPSIM_SIMULATION_H
+
+/*
+ * simulation.h
+ * ------------
+ * Simulation state and time stepping for JumpSim.
+ *
+ * A Simulation is fully determined by (config, master seed, engine
+ * version): every random stream is derived from the master seed, and no
+ * platform RNG (rand/srand) is used. This is what makes record/replay,
+ * checkpoints and ensembles possible.
+ *
+ * Seed derivation:
+ *   seeds.agents   = derive(master, SEED_TAG_AGENTS)    population (see population.h)
+ *   seeds.dynamics = derive(master, SEED_TAG_DYNAMICS)  news arrivals
+ *   seeds.network  = derive(master, SEED_TAG_NETWORK)   social network
+ *   seeds.rewire   = derive(master, SEED_TAG_REWIRE)    network rewiring (rewire.h)
+ *   seeds.hubs     = derive(master, SEED_TAG_HUBS)      sampled hub rows (graph.h)
+ *   seeds.community = derive(master, SEED_TAG_COMMUNITY) community detection (community.h)
+ *   seeds.news     = derive(master, SEED_TAG_NEWS)      targeted news, derive(news, target) each
+ *   seeds.sample   = derive(master, SEED_TAG_SAMPLE)    agents whose trajectories are logged
+ *
+ * With a reordered network (cfg.network.order), agent index i holds the
+ * agent originally numbered order[i]; outputs map back through it. A
+ * sharded setup relabels once more so each shard is a contiguous range.
+ *
+ * Ensembles: replica r of a run shares the population parameters, the
+ * network, the ordering and the news targets with replica 0 and owns
+ * only mutable state (agent state columns, market, RNG streams). For
+ * r > 0 the dynamics and news streams and every agent's RNG state are
+ * re-derived from r; replica 0 is the plain run.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "agent.h"
+#include "market.h"
+#include "config.h"
+#include "population.h"
+#include "popfile.h"
+#include "graph.h"
+#include "graphfile.h"
+#include "rewire.h"
+#include "community.h"
+#include "information_flow.h"
+#include "news.h"
+#include "writer.h"
+#include "tape.h"
+#include "trajectory.h"
+#include "dispersion.h"
+#include "regime.h"
+#include "hash.h"
+
+/* -------------------- Constants -------------------- */
+
+/* Bumped whenever a seed and config give different results: recordings
+   and checkpoints of another version are refused, not replayed */
+#define JUMPSIM_VERSION "0.7.0"
+
+#define SEED_TAG_AGENTS   1
+#define SEED_TAG_DYNAMICS 2
+#define SEED_TAG_NETWORK  3
+#define SEED_TAG_REWIRE   4
+#define SEED_TAG_HUBS     5
+#define SEED_TAG_COMMUNITY 6
+#define SEED_TAG_NEWS     7
+#define SEED_TAG_SAMPLE   8
+
+/* -------------------- Types -------------------- */
+
+typedef struct SimSeeds {
+    uint64_t master;
+    uint64_t agents;
+    uint64_t dynamics;
+    uint64_t network;
+    uint64_t rewire;
+    uint64_t hubs;
+    uint64_t community;
+    uint64_t news;
+    uint64_t sample;
+    uint64_t replica;         /* ensemble member, 0 for a single run */
+} SimSeeds;
+
+/* Sampled hub rows against exact averaging, checked at every redraw */
+typedef struct HubSampleError {
+    uint64_t rows;            /* sampled rows compared */
+    double sum_abs;           /* sum of |sample mean - exact mean| */
+    double max_abs;
+} HubSampleError;
+
+typedef struct Simulation {
+    SimConfig cfg;
+    SimSeeds seeds;
+
+    PopulationSpec population; /* regenerates any agent from its id */
+    AgentParams params;       /* owned columns, fixed after setup */
+    AgentState state;         /* owned columns, updated every step */
+    PopulationFile popfile;   /* mapping the columns borrow from, if imported */
+    int n_agents;
+
+    Graph graph;              /* social network, empty without one */
+    GraphFile graphfile;      /* loaded network (cache mapping, hash), if from a file */
+    uint32_t *order;          /* order[i] = original id of agent i; NULL if not reordered */
+    uint32_t *order_inverse;  /* original id -> index */
+    double *neighbor_mean;    /* herding gather scratch, NULL without a network */
+    Communities communities;  /* community herding (cfg.network.herding), else empty */
+    Diffusion diffusion;      /* news in flight (information_flow.hop_latency > 0) */
+    NewsTarget *news_targets; /* agents of each cfg.news_targets entry, NULL without */
+    NewsProcess *news;        /* their arrival processes (per replica) */
+    AgentRange *sector;       /* agents of the community a sector story hits */
+    Rewirer rewire;           /* network rewiring, if cfg.network.rewire.rule is set */
+    uint64_t hub_draw;        /* draw the hub samples are from (step / every + 1), 0 = none */
+    HubSampleError hub_error;
+    int n_shards;             /* sharded run (shard.h): agent ranges per process */
+    size_t *shard_start;      /* n_shards + 1 bounds; NULL unless n_shards > 1 */
+
+    ExecTape *tape;           /* execution tape (output.tape), owned by the caller; NULL = none */
+    TrajectoryLog *traj;      /* sampled trajectories (output.trajectories), likewise */
+    DispersionLog *disp;      /* per-type dispersion (output.dispersion), likewise */
+    RegimeLog *regime;        /* regime detection (output.changepoint), likewise */
+
+    Market market;
+    uint64_t rng_state;       /* dynamics stream (news arrivals) */
+    uint64_t step;            /* number of completed steps */
+    bool failed;              /* a step could not keep the run reproducible: stop */
+
+    bool borrowed;            /* params, graph and order belong to another Simulation
+                                 (all but graph.work_part, which is per replica) */
+} Simulation;
+
+/* -------------------- API (implemented in simulation.c) -------------------- */
+
+/* Derive every sub-stream seed from the master seed */
+void simulation_derive_seeds(SimSeeds *s, uint64_t master_seed);
+
+/* Seed of a random stream in ensemble member 'replica' (replica 0 keeps it) */
+static inline uint64_t simulation_replica_seed(uint64_t seed, uint64_t replica) {
+    return replica ? hash_derive_seed(seed, replica) : seed;
+}
+
+/* Original (pre-reordering) id of agent index 'i' */
+static inline uint32_t simulation_original_id(const Simulation *sim, size_t i) {
+    return sim->order ? sim->order[i] : (uint32_t)i;
+}
+
+/*
+ * Build agents and market from 'cfg' and 'master_seed'. Agents are
+ * generated, or mapped from cfg->population.file when set (the file then
+ * also fixes the number of agents).
+ * Returns 0 on success, -1 on invalid population settings, an unreadable
+ * population file or allocation failure.
+ */
+int simulation_init(Simulation *sim, const SimConfig *cfg, uint64_t master_seed);
+
+/*
+ * simulation_init for a run split into 'shards' processes (shard.h):
+ * agents are partitioned (partition.h) and relabeled so that shard s
+ * owns indices shard_start[s] .. shard_start[s+1]-1.
+ */
+int simulation_init_sharded(Simulation *sim, const SimConfig *cfg, uint64_t master_seed,
+                            int shards);
+
+/*
+ * Set up ensemble member 'replica' of 'base' (which must not have stepped
+ * yet): parameters, network and ordering are borrowed read-only, state
+ * starts from base's initial state with replica-specific RNG streams.
+ * 'base' must outlive the replica. Returns 0 / -1.
+ */
+int simulation_init_replica(Simulation *rep, const Simulation *base, uint64_t replica);
+
+/*
+ * Draw this step's global news shock from a dynamics stream
+ * (usually 0; rare large jumps).
+ */
+double simulation_news_shock(uint64_t *rng_state);
+
+/*
+ * Bring the sampled hub rows (cfg.network.hub_sample) up to date for the
+ * coming step. Draw d = step / every + 1 uses a seed derived from
+ * (seeds.hubs, d), so restored and sharded runs sample alike. Before a
+ * redraw, the retiring samples are compared with exact averaging of
+ * the current beliefs (hub_error). Called by simulation_step().
+ */
+void simulation_sample_hubs(Simulation *sim);
+
+/*
+ * Advance one step and describe it in 'rec' (may be NULL).
+ */
+void simulation_step(Simulation *sim, StepRecord *rec);
+
+/*
+ * Hash of every mutable bit of state (market, RNG streams, agents).
+ * Two runs agree on this value iff they are bit-identical so far.
+ */
+uint64_t simulation_state_hash(const Simulation *sim);
+
+/* Release memory owned by the simulation (a replica only frees its state) */
+void simulation_free(Simulation *sim);
+
+#endif /* JUMPSIM_SIMULATION_H */
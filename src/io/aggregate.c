@@ -0,0 +1,115 @@
+#include "aggregate.h"
+#include "writer.h"
+#include <string.h>
+
+/* ----------------------------------------------------
+   Stage Setup
+---------------------------------------------------- */
+
+int stage_type_from_string(const char *name, OutputStageType *out)
+{
+    if (strcmp(name, "bars") == 0)     { *out = OUTPUT_STAGE_BARS; return 0; }
+    if (strcmp(name, "decimate") == 0) { *out = OUTPUT_STAGE_DECIMATE; return 0; }
+    if (strcmp(name, "events") == 0)   { *out = OUTPUT_STAGE_EVENTS; return 0; }
+    return -1;
+}
+
+int stage_open(OutputStage *st, const OutputStageConfig *cfg)
+{
+    memset(st, 0, sizeof(OutputStage));
+    st->cfg = *cfg;
+    if (st->cfg.interval == 0) st->cfg.interval = 1;
+
+    st->fp = writer_fopen(cfg->path);
+    if (!st->fp) return -1;
+
+    switch (cfg->type) {
+        case OUTPUT_STAGE_BARS:
+            fprintf(st->fp, "start,steps,open,high,low,close,volume,jumps,shocks\n");
+            break;
+        case OUTPUT_STAGE_DECIMATE:
+            fprintf(st->fp, "time,price,log_return,volatility,shock\n");
+            break;
+        case OUTPUT_STAGE_EVENTS:
+            fprintf(st->fp, "time,price,log_return,volatility,shock,jump\n");
+            break;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Bars
+---------------------------------------------------- */
+
+static void flush_bar(OutputStage *st)
+{
+    if (st->bar_count == 0) return;
+
+    fprintf(st->fp, "%llu,%llu,%f,%f,%f,%f,%f,%d,%d\n",
+            (unsigned long long)st->bar_start,
+            (unsigned long long)st->bar_count,
+            st->open, st->high, st->low, st->close,
+            st->volume, st->jumps, st->shocks);
+
+    st->bar_count = 0;
+}
+
+static void push_bar(OutputStage *st, const StepRecord *rec)
+{
+    if (st->bar_count == 0) {
+        st->bar_start = rec->time;
+        st->open = st->high = st->low = rec->price;
+        st->volume = 0.0;
+        st->jumps = 0;
+        st->shocks = 0;
+    }
+
+    if (rec->price > st->high) st->high = rec->price;
+    if (rec->price < st->low) st->low = rec->price;
+    st->close = rec->price;
+    st->volume += rec->volume;
+    st->jumps += rec->jump ? 1 : 0;
+    st->shocks += (rec->shock != 0.0) ? 1 : 0;
+
+    if (++st->bar_count == st->cfg.interval) flush_bar(st);
+}
+
+/* ----------------------------------------------------
+   Dispatch
+---------------------------------------------------- */
+
+void stage_push(OutputStage *st, const StepRecord *rec)
+{
+    switch (st->cfg.type) {
+        case OUTPUT_STAGE_BARS:
+            push_bar(st, rec);
+            break;
+
+        case OUTPUT_STAGE_DECIMATE:
+            if (rec->time % st->cfg.interval == 0) {
+                fprintf(st->fp, "%llu,%f,%f,%f,%f\n",
+                        (unsigned long long)rec->time, rec->price,
+                        rec->log_return, rec->volatility, rec->shock);
+            }
+            break;
+
+        case OUTPUT_STAGE_EVENTS:
+            if (rec->jump || rec->shock != 0.0) {
+                fprintf(st->fp, "%llu,%f,%f,%f,%f,%d\n",
+                        (unsigned long long)rec->time, rec->price,
+                        rec->log_return, rec->volatility, rec->shock,
+                        rec->jump ? 1 : 0);
+            }
+            break;
+    }
+}
+
+void stage_close(OutputStage *st)
+{
+    if (!st->fp) return;
+
+    if (st->cfg.type == OUTPUT_STAGE_BARS) flush_bar(st);
+
+    fclose(st->fp);
+    st->fp = NULL;
+}
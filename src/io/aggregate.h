@@ -0,0 +1,77 @@
+#ifndef JUMPSIM_AGGREGATE_H
+#define JUMPSIM_AGGREGATE_H
+
+/*
+ * aggregate.h
+ * -----------
+ * Inline aggregation stages of the output pipeline.
+ *
+ * Many consumers never need every step. A stage reduces the step stream
+ * before anything touches the disk:
+ *
+ *  - BARS      : one OHLCV row per 'interval' steps, with jump and
+ *                shock counts for the bar
+ *  - DECIMATE  : every 'interval'-th step, same columns as the full CSV
+ *  - EVENTS    : only steps with a news shock or a detected jump
+ *
+ * Stages are independent and each writes its own CSV, so an experiment
+ * can persist 100-step bars plus the event log while skipping the
+ * full-resolution path entirely.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct StepRecord;
+
+/* -------------------- Configuration -------------------- */
+
+#define OUTPUT_PATH_MAX   512
+#define OUTPUT_MAX_STAGES 8
+
+typedef enum {
+    OUTPUT_STAGE_BARS = 0,
+    OUTPUT_STAGE_DECIMATE = 1,
+    OUTPUT_STAGE_EVENTS = 2
+} OutputStageType;
+
+typedef struct OutputStageConfig {
+    OutputStageType type;
+    uint64_t interval;              /* steps per bar / decimation stride */
+    char path[OUTPUT_PATH_MAX];
+} OutputStageConfig;
+
+/* -------------------- Stage State -------------------- */
+
+typedef struct OutputStage {
+    OutputStageConfig cfg;
+    FILE *fp;
+
+    /* Bar under construction (BARS only) */
+    uint64_t bar_start;
+    uint64_t bar_count;
+    double open, high, low, close;
+    double volume;
+    int jumps;
+    int shocks;
+} OutputStage;
+
+/* -------------------- API (implemented in aggregate.c) -------------------- */
+
+/*
+ * Open the stage's CSV and write its header.
+ * Returns 0 on success, -1 on failure.
+ */
+int stage_open(OutputStage *st, const OutputStageConfig *cfg);
+
+/* Consume one step */
+void stage_push(OutputStage *st, const struct StepRecord *rec);
+
+/* Flush a partial bar (if any) and close the file */
+void stage_close(OutputStage *st);
+
+/* Parse "bars" / "decimate" / "events"; returns -1 if unknown */
+int stage_type_from_string(const char *name, OutputStageType *out);
+
+#endif /* JUMPSIM_AGGREGATE_H */
@@ -0,0 +1,721 @@
+#include "checkpoint.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/* ----------------------------------------------------
+   Slot file layout
+---------------------------------------------------- */
+
+/*
+   char     magic[8]   = "JSCKPT04"
+   char     engine[16] = JUMPSIM_VERSION
+   uint32_t header_size, market_size   (sizeof(SlotHeader), sizeof(Market))
+   uint64_t master_seed, config_hash   (the run the slot belongs to)
+   uint64_t step, seq, key_seq
+   uint32_t delta      (0 = raw columns, 1 = XOR-delta encoded)
+   int32_t  n_agents
+   Market   market     (raw struct)
+   uint64_t rng_state
+   uint64_t payload_size
+   payload
+
+ The header from master_seed on, Market included, is a raw struct.
+ Slots are only read back when the engine version string and both
+ struct sizes match ours. That catches releases and layout changes
+ that resize the structs, not a rebuild that reorders fields of the
+ same size or changes byte order.
+*/
+
+static const char CKPT_MAGIC[8] = { 'J', 'S', 'C', 'K', 'P', 'T', '0', '4' };
+
+typedef struct {
+    uint64_t master_seed, config_hash;
+    uint64_t step, seq, key_seq;
+    uint32_t delta;
+    int32_t n_agents;
+    Market market;
+    uint64_t rng_state;
+    uint64_t payload_size;
+} SlotHeader;
+
+/* ----------------------------------------------------
+   Mutable columns
+---------------------------------------------------- */
+
+/*
+ Raw layout, one contiguous column per field:
+   belief[n] (f64) | cash[n] (f64) | rng_state[n] (u64) | position[n] (i32)
+*/
+
+#define COLUMN_BYTES_PER_AGENT (8 + 8 + 8 + 4)
+
+static size_t raw_size_for(int n_agents)
+{
+    return (size_t)n_agents * COLUMN_BYTES_PER_AGENT;
+}
+
+static size_t packed_bound(size_t raw_size)
+{
+    /* zero-run coding never expands by more than ~2 varints per 3 bytes */
+    return raw_size * 2 + 2 * VARINT_MAX_BYTES;
+}
+
+/* The state already lives in columns: saving is four block copies */
+static void gather_columns(const Simulation *sim, unsigned char *raw)
+{
+    size_t n = (size_t)sim->n_agents;
+    const AgentState *st = &sim->state;
+
+    memcpy(raw, st->belief, n * sizeof(double));
+    raw += n * sizeof(double);
+    memcpy(raw, st->cash, n * sizeof(double));
+    raw += n * sizeof(double);
+    memcpy(raw, st->rng_state, n * sizeof(uint64_t));
+    raw += n * sizeof(uint64_t);
+    memcpy(raw, st->position, n * sizeof(int32_t));
+}
+
+static void scatter_columns(const unsigned char *raw, Simulation *sim)
+{
+    size_t n = (size_t)sim->n_agents;
+    AgentState *st = &sim->state;
+
+    memcpy(st->belief, raw, n * sizeof(double));
+    raw += n * sizeof(double);
+    memcpy(st->cash, raw, n * sizeof(double));
+    raw += n * sizeof(double);
+    memcpy(st->rng_state, raw, n * sizeof(uint64_t));
+    raw += n * sizeof(uint64_t);
+    memcpy(st->position, raw, n * sizeof(int32_t));
+}
+
+/* ----------------------------------------------------
+   Delta codec
+---------------------------------------------------- */
+
+/*
+ Byte-plane shuffle: within each column, byte k of every element is
+ stored together. XOR deltas of doubles are zero in their high (sign and
+ exponent) bytes, so shuffling turns them into long zero runs.
+*/
+
+static void shuffle(const unsigned char *src, unsigned char *dst, size_t n, size_t elem)
+{
+    for (size_t i = 0; i < n; i++)
+        for (size_t b = 0; b < elem; b++)
+            dst[b * n + i] = src[i * elem + b];
+}
+
+static void unshuffle(const unsigned char *src, unsigned char *dst, size_t n, size_t elem)
+{
+    for (size_t i = 0; i < n; i++)
+        for (size_t b = 0; b < elem; b++)
+            dst[i * elem + b] = src[b * n + i];
+}
+
+static void shuffle_columns(const unsigned char *src, unsigned char *dst, size_t n, bool forward)
+{
+    static const size_t elem[4] = { 8, 8, 8, 4 };
+    size_t off = 0;
+
+    for (int c = 0; c < 4; c++) {
+        if (forward) shuffle(src + off, dst + off, n, elem[c]);
+        else unshuffle(src + off, dst + off, n, elem[c]);
+        off += n * elem[c];
+    }
+}
+
+/*
+ Zero-run coding: repeated (varint zero_run, varint literal_len, literal)
+ tokens. A literal run ends at the next pair of zero bytes.
+*/
+
+static size_t zrle_encode(const unsigned char *in, size_t len, unsigned char *out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        size_t z = i;
+        while (z < len && in[z] == 0) z++;
+
+        size_t lit = z;
+        while (lit < len && !(in[lit] == 0 && (lit + 1 == len || in[lit + 1] == 0))) lit++;
+
+        o += varint_put(out + o, z - i);
+        o += varint_put(out + o, lit - z);
+        memcpy(out + o, in + z, lit - z);
+        o += lit - z;
+
+        i = lit;
+    }
+    return o;
+}
+
+static int zrle_decode(const unsigned char *in, size_t len, unsigned char *out, size_t out_len)
+{
+    const unsigned char *p = in, *end = in + len;
+    size_t o = 0;
+
+    while (p < end) {
+        uint64_t zeros, lit;
+        size_t k = varint_get(p, end, &zeros);
+        if (!k) return -1;
+        p += k;
+        k = varint_get(p, end, &lit);
+        if (!k) return -1;
+        p += k;
+
+        if (zeros > out_len - o || lit > out_len - o - zeros || lit > (size_t)(end - p)) return -1;
+
+        memset(out + o, 0, zeros);
+        o += zeros;
+        memcpy(out + o, p, lit);
+        o += lit;
+        p += lit;
+    }
+    return o == out_len ? 0 : -1;
+}
+
+/* Encode ring->raw into ring->packed; returns payload size */
+static size_t encode_payload(CheckpointRing *ring, int n_agents, bool keyframe)
+{
+    size_t size = ring->raw_size;
+
+    if (!ring->delta) {
+        memcpy(ring->packed, ring->raw, size);
+        return size;
+    }
+
+    unsigned char *x = ring->work;
+    unsigned char *sh = ring->work + size;
+
+    for (size_t i = 0; i < size; i++) {
+        x[i] = keyframe ? ring->raw[i] : (unsigned char)(ring->raw[i] ^ ring->prev_raw[i]);
+    }
+    shuffle_columns(x, sh, (size_t)n_agents, true);
+
+    return zrle_encode(sh, size, ring->packed);
+}
+
+/* Apply one payload onto ring->raw (XOR for deltas, copy otherwise) */
+static int apply_payload(CheckpointRing *ring, bool delta, int n_agents,
+                         const unsigned char *payload, size_t payload_size)
+{
+    size_t size = ring->raw_size;
+
+    if (!delta) {
+        if (payload_size != size) return -1;
+        memcpy(ring->raw, payload, size);
+        return 0;
+    }
+
+    unsigned char *sh = ring->work + size;
+    unsigned char *x = ring->work;
+
+    if (zrle_decode(payload, payload_size, sh, size) != 0) return -1;
+    shuffle_columns(sh, x, (size_t)n_agents, false);
+
+    for (size_t i = 0; i < size; i++) ring->raw[i] ^= x[i];
+    return 0;
+}
+
+static int ensure_buffers(CheckpointRing *ring, int n_agents)
+{
+    size_t size = raw_size_for(n_agents);
+    if (ring->raw && ring->raw_size == size) return 0;
+
+    free(ring->raw);
+    free(ring->prev_raw);
+    free(ring->work);
+    free(ring->packed);
+
+    ring->raw_size = size;
+    ring->raw = calloc(size ? size : 1, 1);
+    ring->prev_raw = calloc(size ? size : 1, 1);
+    ring->work = malloc(2 * size + 1);
+    ring->packed = malloc(packed_bound(size));
+
+    return (ring->raw && ring->prev_raw && ring->work && ring->packed) ? 0 : -1;
+}
+
+/* ----------------------------------------------------
+   Slot files
+---------------------------------------------------- */
+
+static void slot_path(const CheckpointRing *ring, int slot, char *out, size_t cap)
+{
+    snprintf(out, cap, "%s/ckpt_%03d.bin", ring->dir, slot);
+}
+
+/* Slot index of a directory entry named like a slot file, else -1 */
+static int slot_of_name(const char *name)
+{
+    int slot, end = 0;
+    if (sscanf(name, "ckpt_%d.bin%n", &slot, &end) != 1 || end == 0 ||
+        name[end] != '\0' || slot < 0) {
+        return -1;
+    }
+    return slot;
+}
+
+/* Slots written by another run (seed or config) must never be restored */
+static bool slot_of_run(const CheckpointRing *ring, const SlotHeader *h)
+{
+    return h->master_seed == ring->master_seed && h->config_hash == ring->config_hash;
+}
+
+static int write_slot_file(const CheckpointRing *ring, int slot, const SlotHeader *h,
+                           const unsigned char *payload)
+{
+    char path[CKPT_PATH_MAX + 32];
+    slot_path(ring, slot, path, sizeof(path));
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "checkpoint: cannot write %s\n", path);
+        return -1;
+    }
+
+    char engine[16] = { 0 };
+    strncpy(engine, JUMPSIM_VERSION, sizeof(engine) - 1);
+
+    uint32_t sizes[2] = { (uint32_t)sizeof(SlotHeader), (uint32_t)sizeof(Market) };
+
+    fwrite(CKPT_MAGIC, 1, sizeof(CKPT_MAGIC), fp);
+    fwrite(engine, 1, sizeof(engine), fp);
+    fwrite(sizes, sizeof(sizes), 1, fp);
+    fwrite(h, sizeof(SlotHeader), 1, fp);
+    fwrite(payload, 1, (size_t)h->payload_size, fp);
+
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* Read the header; on success the stream is positioned at the payload */
+static FILE *open_slot_file(const char *path, SlotHeader *h)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    char magic[8];
+    char engine[16];
+    uint32_t sizes[2];
+
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, CKPT_MAGIC, sizeof(magic)) != 0 ||
+        fread(engine, 1, sizeof(engine), fp) != sizeof(engine) ||
+        fread(sizes, sizeof(sizes), 1, fp) != 1) {
+        fclose(fp);
+        return NULL;
+    }
+
+    engine[sizeof(engine) - 1] = '\0';
+    if (strcmp(engine, JUMPSIM_VERSION) != 0) {
+        fprintf(stderr, "checkpoint: %s was written by engine %s\n", path, engine);
+        fclose(fp);
+        return NULL;
+    }
+
+    /* Checked before the raw structs are read into ours */
+    if (sizes[0] != sizeof(SlotHeader) || sizes[1] != sizeof(Market)) {
+        fprintf(stderr, "checkpoint: %s has another slot layout (header %u, market %u bytes; "
+                        "expected %zu, %zu)\n", path, sizes[0], sizes[1],
+                sizeof(SlotHeader), sizeof(Market));
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fread(h, sizeof(SlotHeader), 1, fp) != 1) {
+        fclose(fp);
+        return NULL;
+    }
+
+    return fp;
+}
+
+/* ----------------------------------------------------
+   Ring management
+---------------------------------------------------- */
+
+int ckpt_ring_init(CheckpointRing *ring, int capacity, const char *dir,
+                   bool delta, int keyframe_every,
+                   uint64_t master_seed, uint64_t config_hash)
+{
+    memset(ring, 0, sizeof(CheckpointRing));
+    ring->master_seed = master_seed;
+    ring->config_hash = config_hash;
+
+    if (capacity <= 0) capacity = 1;
+    ring->capacity = capacity;
+    ring->delta = delta;
+
+    /* At least half of the ring must stay restorable */
+    if (keyframe_every <= 0) keyframe_every = CKPT_DEFAULT_KEYFRAME_EVERY;
+    if (keyframe_every > capacity / 2) keyframe_every = capacity / 2;
+    ring->keyframe_every = keyframe_every > 0 ? keyframe_every : 1;
+
+    ring->slots = calloc((size_t)capacity, sizeof(SimCheckpoint));
+    if (!ring->slots) return -1;
+
+    if (dir) {
+        if (strlen(dir) >= CKPT_PATH_MAX) {
+            fprintf(stderr, "checkpoint: directory path too long\n");
+            ckpt_ring_free(ring);
+            return -1;
+        }
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "checkpoint: cannot create %s\n", dir);
+            ckpt_ring_free(ring);
+            return -1;
+        }
+        strcpy(ring->dir, dir);
+        ring->on_disk = true;
+
+        /*
+         Slots of an earlier run in the same directory would be found by
+         ckpt_ring_open next to ours, with a ring size that is not ours
+        */
+        DIR *d = opendir(dir);
+        if (!d) {
+            fprintf(stderr, "checkpoint: cannot open %s\n", dir);
+            ckpt_ring_free(ring);
+            return -1;
+        }
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            int slot = slot_of_name(e->d_name);
+            if (slot < 0) continue;
+            char path[CKPT_PATH_MAX + 300];
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            if (remove(path) != 0) {
+                fprintf(stderr, "checkpoint: cannot remove stale %s\n", path);
+                closedir(d);
+                ckpt_ring_free(ring);
+                return -1;
+            }
+        }
+        closedir(d);
+    }
+
+    return 0;
+}
+
+int ckpt_ring_open(CheckpointRing *ring, const char *dir,
+                   uint64_t master_seed, uint64_t config_hash)
+{
+    memset(ring, 0, sizeof(CheckpointRing));
+    ring->master_seed = master_seed;
+    ring->config_hash = config_hash;
+
+    DIR *d = opendir(dir);
+    if (!d || strlen(dir) >= CKPT_PATH_MAX) {
+        fprintf(stderr, "checkpoint: cannot open %s\n", dir);
+        if (d) closedir(d);
+        return -1;
+    }
+
+    /* Capacity = highest slot index present + 1 */
+    int max_slot = -1;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        int slot = slot_of_name(e->d_name);
+        if (slot > max_slot) max_slot = slot;
+    }
+    closedir(d);
+
+    if (max_slot < 0) {
+        fprintf(stderr, "checkpoint: no checkpoints in %s\n", dir);
+        return -1;
+    }
+
+    strcpy(ring->dir, dir);
+    ring->on_disk = true;
+    ring->capacity = max_slot + 1;
+    ring->slots = calloc((size_t)ring->capacity, sizeof(SimCheckpoint));
+    if (!ring->slots) return -1;
+
+    int n_used = 0;
+    for (int slot = 0; slot <= max_slot; slot++) {
+        char path[CKPT_PATH_MAX + 32];
+        slot_path(ring, slot, path, sizeof(path));
+
+        SlotHeader h;
+        FILE *fp = open_slot_file(path, &h);
+        if (!fp) continue;
+        fclose(fp);
+
+        if (!slot_of_run(ring, &h)) {
+            fprintf(stderr, "checkpoint: %s belongs to another run (seed %llu), ignored\n",
+                    path, (unsigned long long)h.master_seed);
+            continue;
+        }
+        n_used++;
+
+        SimCheckpoint *c = &ring->slots[slot];
+        c->used = true;
+        c->step = h.step;
+        c->seq = h.seq;
+        c->key_seq = h.key_seq;
+        c->market = h.market;
+        c->rng_state = h.rng_state;
+        c->n_agents = h.n_agents;
+        c->size = (size_t)h.payload_size;
+
+        ring->delta = h.delta != 0;
+        if (h.seq + 1 > ring->saved) ring->saved = h.seq + 1;
+    }
+
+    if (n_used == 0) {
+        fprintf(stderr, "checkpoint: no checkpoints of this run in %s\n", dir);
+        ckpt_ring_free(ring);
+        return -1;
+    }
+    return 0;
+}
+
+void ckpt_ring_free(CheckpointRing *ring)
+{
+    if (ring->slots) {
+        for (int i = 0; i < ring->capacity; i++) free(ring->slots[i].data);
+        free(ring->slots);
+    }
+    free(ring->raw);
+    free(ring->prev_raw);
+    free(ring->work);
+    free(ring->packed);
+    memset(ring, 0, sizeof(CheckpointRing));
+}
+
+size_t ckpt_ring_bytes(const CheckpointRing *ring)
+{
+    size_t total = 0;
+    for (int i = 0; i < ring->capacity; i++) {
+        if (ring->slots[i].used) total += ring->slots[i].size;
+    }
+    return total;
+}
+
+/* ----------------------------------------------------
+   Save / Restore
+---------------------------------------------------- */
+
+int ckpt_ring_save(CheckpointRing *ring, const Simulation *sim)
+{
+    if (ensure_buffers(ring, sim->n_agents) != 0) return -1;
+
+    uint64_t seq = ring->saved;
+    int slot = (int)(seq % (uint64_t)ring->capacity);
+    bool keyframe = !ring->delta || seq % (uint64_t)ring->keyframe_every == 0;
+    uint64_t key_seq = keyframe ? seq : seq - seq % (uint64_t)ring->keyframe_every;
+
+    gather_columns(sim, ring->raw);
+    size_t size = encode_payload(ring, sim->n_agents, keyframe);
+
+    SimCheckpoint *c = &ring->slots[slot];
+
+    if (ring->on_disk) {
+        SlotHeader h = {
+            .master_seed = ring->master_seed, .config_hash = ring->config_hash,
+            .step = sim->step, .seq = seq, .key_seq = key_seq,
+            .delta = ring->delta ? 1 : 0, .n_agents = sim->n_agents,
+            .market = sim->market, .rng_state = sim->rng_state,
+            .payload_size = size
+        };
+        if (write_slot_file(ring, slot, &h, ring->packed) != 0) return -1;
+    } else {
+        if (c->cap < size) {
+            unsigned char *data = realloc(c->data, size);
+            if (!data) return -1;
+            c->data = data;
+            c->cap = size;
+        }
+        memcpy(c->data, ring->packed, size);
+    }
+
+    c->used = true;
+    c->step = sim->step;
+    c->seq = seq;
+    c->key_seq = key_seq;
+    c->market = sim->market;
+    c->rng_state = sim->rng_state;
+    c->n_agents = sim->n_agents;
+    c->size = size;
+
+    /* The next delta is taken against these columns */
+    unsigned char *tmp = ring->prev_raw;
+    ring->prev_raw = ring->raw;
+    ring->raw = tmp;
+
+    ring->saved++;
+    return 0;
+}
+
+static const SimCheckpoint *slot_for_seq(const CheckpointRing *ring, uint64_t seq)
+{
+    const SimCheckpoint *c = &ring->slots[seq % (uint64_t)ring->capacity];
+    return (c->used && c->seq == seq) ? c : NULL;
+}
+
+/* A checkpoint is restorable while its keyframe and every delta since are held */
+static bool restorable(const CheckpointRing *ring, const SimCheckpoint *c)
+{
+    for (uint64_t s = c->key_seq; s <= c->seq; s++) {
+        if (!slot_for_seq(ring, s)) return false;
+    }
+    return true;
+}
+
+/* Newest restorable slot with step <= 'step', or NULL */
+static const SimCheckpoint *find_checkpoint(const CheckpointRing *ring, uint64_t step)
+{
+    const SimCheckpoint *best = NULL;
+
+    for (int i = 0; i < ring->capacity; i++) {
+        const SimCheckpoint *c = &ring->slots[i];
+        if (!c->used || c->step > step) continue;
+        if (best && c->step <= best->step) continue;
+        if (restorable(ring, c)) best = c;
+    }
+    return best;
+}
+
+static int load_payload(const CheckpointRing *ring, const SimCheckpoint *c,
+                        unsigned char **payload, bool *owned)
+{
+    if (!ring->on_disk) {
+        *payload = c->data;
+        *owned = false;
+        return 0;
+    }
+
+    char path[CKPT_PATH_MAX + 32];
+    slot_path(ring, (int)(c->seq % (uint64_t)ring->capacity), path, sizeof(path));
+
+    SlotHeader h;
+    FILE *fp = open_slot_file(path, &h);
+    if (!fp) return -1;
+
+    *payload = malloc(c->size ? c->size : 1);
+    *owned = true;
+    size_t got = fread(*payload, 1, c->size, fp);
+    fclose(fp);
+
+    if (got != c->size || h.seq != c->seq || !slot_of_run(ring, &h)) {
+        fprintf(stderr, "checkpoint: %s changed since the ring was opened\n", path);
+        free(*payload);
+        return -1;
+    }
+    return 0;
+}
+
+static int restore_checkpoint(CheckpointRing *ring, const SimCheckpoint *target, Simulation *sim)
+{
+    if (target->n_agents != sim->n_agents) {
+        fprintf(stderr, "checkpoint: population size does not match this simulation\n");
+        return -1;
+    }
+    if (ensure_buffers(ring, sim->n_agents) != 0) return -1;
+
+    /* Replay the delta chain from its keyframe */
+    memset(ring->raw, 0, ring->raw_size);
+
+    for (uint64_t s = target->key_seq; s <= target->seq; s++) {
+        const SimCheckpoint *c = slot_for_seq(ring, s);
+        unsigned char *payload;
+        bool owned;
+
+        if (!c || load_payload(ring, c, &payload, &owned) != 0) return -1;
+        int rc = apply_payload(ring, ring->delta, sim->n_agents, payload, c->size);
+        if (owned) free(payload);
+        if (rc != 0) {
+            fprintf(stderr, "checkpoint: corrupt payload at seq %llu\n", (unsigned long long)s);
+            return -1;
+        }
+    }
+
+    scatter_columns(ring->raw, sim);
+    sim->step = target->step;
+    sim->market = target->market;
+    sim->rng_state = target->rng_state;
+
+    /* ring->raw is scratch; prev_raw (the delta base) is left untouched */
+    return 0;
+}
+
+int64_t ckpt_ring_restore(CheckpointRing *ring, uint64_t step, Simulation *sim)
+{
+    const SimCheckpoint *c = find_checkpoint(ring, step);
+    if (!c) return -1;
+    if (restore_checkpoint(ring, c, sim) != 0) return -1;
+    return (int64_t)sim->step;
+}
+
+/* ----------------------------------------------------
+   Time travel
+---------------------------------------------------- */
+
+int ckpt_seek(Simulation *sim, CheckpointRing *ring, uint64_t step)
+{
+    /*
+     Pick the cheapest starting point among:
+       - the current state (if it is not past the target)
+       - the newest checkpoint at or before the target
+       - a fresh step-0 rebuild from config and seed
+    */
+
+    const SimCheckpoint *c = ring ? find_checkpoint(ring, step) : NULL;
+    bool current_usable = sim->step <= step;
+
+    if (c && (!current_usable || c->step > sim->step)) {
+        if (restore_checkpoint(ring, c, sim) != 0) return -1;
+    }
+    else if (!current_usable) {
+        SimConfig cfg = sim->cfg;
+        uint64_t master = sim->seeds.master;
+
+        simulation_free(sim);
+        if (simulation_init(sim, &cfg, master) != 0) return -1;
+    }
+
+    while (sim->step < step) {
+        simulation_step(sim, NULL);
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   State dump
+---------------------------------------------------- */
+
+void ckpt_dump_state(const Simulation *sim, FILE *out)
+{
+    const Market *m = &sim->market;
+
+    fprintf(out,
+            "{ \"step\": %llu, \"price\": %.10g, \"last_price\": %.10g, "
+            "\"volatility\": %.10g, \"halted\": %s }\n",
+            (unsigned long long)sim->step, m->price, m->last_price,
+            m->volatility, m->trading_halted ? "true" : "false");
+
+    /* Agents in original-id order, whatever the in-memory order */
+    for (int id = 0; id < sim->n_agents; id++) {
+        size_t i = sim->order_inverse ? sim->order_inverse[id] : (size_t)id;
+
+        /* AoS view assembled from the columns (name derived from id) */
+        Agent a;
+        population_materialize(&sim->params, &sim->state, i, &a);
+        a.id = (AgentId)id;
+        population_agent_name(a.id, a.name, sizeof(a.name));
+        if (sim->graph.n > 0) a.neighbor_count = graph_degree(&sim->graph, i);
+
+        char *json = agent_to_json(&a);
+        if (json) {
+            fprintf(out, "%s\n", json);
+            free(json);
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef JUMPSIM_CHECKPOINT_H
+#define JUMPSIM_CHECKPOINT_H
+
+/*
+ * checkpoint.h
+ * ------------
+ * Periodic simulation checkpoints for time-travel debugging.
+ *
+ * A CheckpointRing keeps the last 'capacity' snapshots, either in memory
+ * or as slot files in a directory. Any step S can then be reconstructed by
+ * restoring the nearest checkpoint at or before S and replaying forward
+ * with the ordinary step function, which is deterministic (see
+ * simulation.h). Investigating step 4.2M with K = 10000 costs at most
+ * 10000 steps instead of a rerun from step 0.
+ *
+ * Only mutable state is stored: market, dynamics RNG and the per-agent
+ * columns that change during a run (belief, cash, RNG state, position).
+ * Parameters, anchors and names are rebuilt from config and seed.
+ *
+ * Delta mode additionally stores each checkpoint as the XOR against the
+ * previous one, byte-plane shuffled and zero-run compressed. Most bits of
+ * a slowly moving belief or cash value do not change between checkpoints,
+ * so deltas shrink to a fraction of the raw columns. Every
+ * 'keyframe_every'-th checkpoint is encoded against zero so chains stay
+ * short; a delta is restorable only while its whole chain is in the ring.
+ *
+ * Disk rings also hold 'run.rec' (a record log, see record.h) so a later
+ * process can rebuild the exact simulation from the directory alone.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "simulation.h"
+
+/* -------------------- Types -------------------- */
+
+#define CKPT_PATH_MAX 512
+#define CKPT_DEFAULT_KEYFRAME_EVERY 8
+
+typedef struct SimCheckpoint {
+    bool used;
+    uint64_t step;            /* steps completed when taken */
+    uint64_t seq;             /* save index within the ring's lifetime */
+    uint64_t key_seq;         /* seq of the keyframe starting this chain */
+
+    Market market;
+    uint64_t rng_state;
+    int n_agents;
+
+    unsigned char *data;      /* encoded columns (memory rings only) */
+    size_t size;
+    size_t cap;
+} SimCheckpoint;
+
+typedef struct CheckpointRing {
+    int capacity;
+    uint64_t saved;           /* checkpoints taken (next slot = saved % capacity) */
+
+    bool delta;               /* XOR-delta + compression */
+    int keyframe_every;
+
+    bool on_disk;
+    char dir[CKPT_PATH_MAX];
+
+    /* Run the slots belong to: master seed and hash of the config bytes */
+    uint64_t master_seed;
+    uint64_t config_hash;
+
+    SimCheckpoint *slots;     /* metadata always; payload only in memory */
+
+    /* Scratch buffers for encoding */
+    unsigned char *raw;       /* current columns */
+    unsigned char *prev_raw;  /* columns of the previous save (delta base) */
+    unsigned char *work;      /* 2 * raw_size: XOR/shuffle staging */
+    unsigned char *packed;    /* encoder output (worst-case sized) */
+    size_t raw_size;
+} CheckpointRing;
+
+/* -------------------- API (implemented in checkpoint.c) -------------------- */
+
+/*
+ * Create an empty ring with 'capacity' slots.
+ * 'dir' == NULL keeps checkpoints in memory; otherwise the directory is
+ * created and slots are written as dir/ckpt_NNN.bin.
+ * 'delta' enables XOR-delta compression with a keyframe every
+ * 'keyframe_every' checkpoints (clamped to half the capacity).
+ * Slot files left in 'dir' by an earlier run are deleted. Every slot is
+ * stamped with the run's master seed and config hash (as in run.rec).
+ * Returns 0 on success, -1 on failure.
+ */
+int ckpt_ring_init(CheckpointRing *ring, int capacity, const char *dir,
+                   bool delta, int keyframe_every,
+                   uint64_t master_seed, uint64_t config_hash);
+
+/*
+ * Re-open a disk ring written by an earlier run (slots are discovered
+ * from the files present). Slots stamped with another seed or config
+ * hash are rejected. Returns 0 on success, -1 on failure (no slot of
+ * this run).
+ */
+int ckpt_ring_open(CheckpointRing *ring, const char *dir,
+                   uint64_t master_seed, uint64_t config_hash);
+
+/* Snapshot the current state into the next slot (oldest is overwritten) */
+int ckpt_ring_save(CheckpointRing *ring, const Simulation *sim);
+
+/*
+ * Restore the newest restorable checkpoint taken at or before 'step'.
+ * 'sim' must have been built from the same config and seed.
+ * Returns the restored step, or -1 if no such checkpoint exists.
+ */
+int64_t ckpt_ring_restore(CheckpointRing *ring, uint64_t step, Simulation *sim);
+
+/*
+ * Move 'sim' to the state after exactly 'step' steps: restore the best
+ * checkpoint (or rebuild step 0) and replay forward.
+ * Returns 0 on success, -1 on failure.
+ */
+int ckpt_seek(Simulation *sim, CheckpointRing *ring, uint64_t step);
+
+/* Bytes of encoded payload currently held (for sizing the ring) */
+size_t ckpt_ring_bytes(const CheckpointRing *ring);
+
+void ckpt_ring_free(CheckpointRing *ring);
+
+/*
+ * Write the market and every agent's full state as JSON lines.
+ */
+void ckpt_dump_state(const Simulation *sim, FILE *out);
+
+#endif /* JUMPSIM_CHECKPOINT_H */
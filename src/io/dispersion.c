@@ -0,0 +1,286 @@
+#include "dispersion.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const char *const TYPE_NAMES[AGENT_TYPE_COUNT] = { "retail", "institution", "noise" };
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+static void disp_free(DispersionLog *d)
+{
+    free(d->blocks);
+    free(d->steps);
+    free(d->price);
+    free(d->agents);
+    free(d->moments);
+    free(d->counts);
+}
+
+int disp_open(DispersionLog *d, const DispersionConfig *cfg, size_t n_agents, size_t block)
+{
+    memset(d, 0, sizeof(DispersionLog));
+    d->cfg = *cfg;
+
+    d->edge[0] = -INFINITY;
+    d->edge[DISP_BINS] = INFINITY;
+    for (int k = 1; k < DISP_BINS; k++) {
+        d->edge[k] = exp((k - DISP_BINS / 2) * cfg->bin_width) - 1.0;
+    }
+
+    /*
+     Grid of cells no wider than the narrowest bin (the lowest), offset
+     by one cell so everything below edge[1] lands in cell 0, bin 0.
+     A cell then holds at most one edge, and rounding in the cell index
+     costs at most one cell: disp_bin's two comparisons cover both.
+    */
+    double cell = d->edge[2] - d->edge[1];
+    d->lut_scale = 1.0 / cell;
+    d->lut_origin = d->edge[1] - cell;
+    if ((d->edge[DISP_BINS - 1] - d->lut_origin) * d->lut_scale + 2.0 > DISP_LUT) {
+        fprintf(stderr, "dispersion: bin width %g is too wide for %d bins\n",
+                cfg->bin_width, DISP_BINS);
+        memset(d, 0, sizeof(DispersionLog));
+        return -1;
+    }
+    for (int u = 0; u < DISP_LUT; u++) {
+        double x = d->lut_origin + u * cell;
+        int b = 0;
+        while (b < DISP_BINS - 1 && x >= d->edge[b + 1]) b++;
+        d->lut[u] = (uint8_t)(u == 0 ? 0 : b);
+    }
+
+    d->n_blocks = (n_agents + block - 1) / block;
+    d->blocks = calloc(d->n_blocks ? d->n_blocks : 1, sizeof(DispersionBlock));
+    d->steps = malloc(DISP_GROUP * sizeof(uint64_t));
+    d->price = malloc(DISP_GROUP * sizeof(double));
+    d->agents = malloc(AGENT_TYPE_COUNT * DISP_GROUP * sizeof(uint32_t));
+    d->moments = malloc(AGENT_TYPE_COUNT * DISP_MOMENTS * DISP_GROUP * sizeof(float));
+    d->counts = malloc(AGENT_TYPE_COUNT * DISP_BINS * DISP_GROUP * sizeof(uint32_t));
+    if (!d->blocks || !d->steps || !d->price || !d->agents || !d->moments || !d->counts) {
+        goto fail;
+    }
+
+    d->fp = writer_fopen(cfg->path);
+    if (!d->fp) goto fail;
+
+    uint32_t types = AGENT_TYPE_COUNT, bins = DISP_BINS;
+    fwrite(DISP_MAGIC, 1, 8, d->fp);
+    fwrite(&types, sizeof(types), 1, d->fp);
+    fwrite(&bins, sizeof(bins), 1, d->fp);
+    fwrite(&cfg->bin_width, sizeof(double), 1, d->fp);
+    d->bytes = 24;
+    return 0;
+
+fail:
+    fprintf(stderr, "dispersion: cannot open %s\n", cfg->path);
+    disp_free(d);
+    memset(d, 0, sizeof(DispersionLog));
+    return -1;
+}
+
+static void flush_group(DispersionLog *d)
+{
+    uint32_t rows = d->rows;
+    if (rows == 0) return;
+
+    size_t put = 0, want = 1 + 2 * (size_t)rows;
+    put += fwrite(&rows, sizeof(rows), 1, d->fp);
+    put += fwrite(d->steps, sizeof(uint64_t), rows, d->fp);
+    put += fwrite(d->price, sizeof(double), rows, d->fp);
+    for (int t = 0; t < AGENT_TYPE_COUNT; t++) {
+        put += fwrite(d->agents + (size_t)t * DISP_GROUP, sizeof(uint32_t), rows, d->fp);
+    }
+    for (int c = 0; c < AGENT_TYPE_COUNT * DISP_MOMENTS; c++) {
+        put += fwrite(d->moments + (size_t)c * DISP_GROUP, sizeof(float), rows, d->fp);
+    }
+    for (int c = 0; c < AGENT_TYPE_COUNT * DISP_BINS; c++) {
+        put += fwrite(d->counts + (size_t)c * DISP_GROUP, sizeof(uint32_t), rows, d->fp);
+    }
+    want += (size_t)rows * AGENT_TYPE_COUNT * (1 + DISP_MOMENTS + DISP_BINS);
+
+    if (put != want) d->failed = true;
+    d->bytes += sizeof(rows) + (uint64_t)rows * (16 + 4 * AGENT_TYPE_COUNT * (1 + DISP_MOMENTS + DISP_BINS));
+    d->rows = 0;
+}
+
+int disp_close(DispersionLog *d)
+{
+    if (!d->fp) return 0;
+
+    flush_group(d);
+    int rc = (fclose(d->fp) == 0 && !d->failed) ? 0 : -1;
+    if (rc != 0) fprintf(stderr, "dispersion: write failed, %s is incomplete\n", d->cfg.path);
+
+    disp_free(d);
+    d->fp = NULL;
+    return rc;
+}
+
+/* ----------------------------------------------------
+   Steps
+---------------------------------------------------- */
+
+/* Fold (mean, M2, M3) of nb values into those of na values (Pebay 2008) */
+static void merge_moments(double *a, uint32_t na, const double *b, uint32_t nb)
+{
+    if (na == 0) {
+        memcpy(a, b, 3 * sizeof(double));
+        return;
+    }
+    double n1 = na, n2 = nb, n = n1 + n2;
+    double delta = b[0] - a[0];
+
+    a[2] += b[2] + delta * delta * delta * n1 * n2 * (n1 - n2) / (n * n)
+          + 3.0 * delta * (n1 * b[1] - n2 * a[1]) / n;
+    a[1] += b[1] + delta * delta * n1 * n2 / n;
+    a[0] += delta * n2 / n;
+}
+
+void disp_end_step(DispersionLog *d, uint64_t step, double price)
+{
+    DispersionBlock sum;
+    memset(&sum, 0, sizeof(sum));
+
+    /* Block order, as the order flow: independent of the thread count */
+    for (size_t b = 0; b < d->n_blocks; b++) {
+        const DispersionBlock *blk = &d->blocks[b];
+        for (int t = 0; t < AGENT_TYPE_COUNT; t++) {
+            if (blk->n[t] == 0) continue;
+            merge_moments(sum.belief[t], sum.n[t], blk->belief[t], blk->n[t]);
+            sum.n[t] += blk->n[t];
+            for (int k = 0; k < 2; k++) sum.position[t][k] += blk->position[t][k];
+            for (int k = 0; k < DISP_BINS; k++) sum.hist[t][k] += blk->hist[t][k];
+        }
+    }
+
+    uint32_t r = d->rows;
+    d->steps[r] = step;
+    d->price[r] = price;
+
+    for (int t = 0; t < AGENT_TYPE_COUNT; t++) {
+        double n = sum.n[t] ? (double)sum.n[t] : 1.0;
+
+        double m = sum.belief[t][0];
+        double var = sum.belief[t][1] / n;
+        double sd = sqrt(var);
+        double skew = var > 0.0 ? sum.belief[t][2] / n / (var * sd) : 0.0;
+
+        double qm = sum.position[t][0] / n;
+        double qsd = sqrt(fmax(sum.position[t][1] / n - qm * qm, 0.0));
+
+        float *mo = d->moments + (size_t)t * DISP_MOMENTS * DISP_GROUP + r;
+        mo[0 * DISP_GROUP] = (float)m;
+        mo[1 * DISP_GROUP] = (float)sd;
+        mo[2 * DISP_GROUP] = (float)skew;
+        mo[3 * DISP_GROUP] = (float)qm;
+        mo[4 * DISP_GROUP] = (float)qsd;
+
+        d->agents[(size_t)t * DISP_GROUP + r] = sum.n[t];
+        for (int k = 0; k < DISP_BINS; k++) {
+            d->counts[((size_t)t * DISP_BINS + k) * DISP_GROUP + r] = sum.hist[t][k];
+        }
+    }
+
+    d->records++;
+    if (++d->rows == DISP_GROUP) flush_group(d);
+}
+
+/* ----------------------------------------------------
+   Decoding
+---------------------------------------------------- */
+
+int disp_to_csv(const char *disp_path, const char *csv_path)
+{
+    FILE *in = fopen(disp_path, "rb");
+    if (!in) {
+        fprintf(stderr, "dispersion: cannot open %s\n", disp_path);
+        return -1;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    unsigned char *data = malloc(size > 0 ? (size_t)size : 1);
+    size_t len = data ? fread(data, 1, (size_t)size, in) : 0;
+    fclose(in);
+
+    const unsigned char *p = data, *end = data + len;
+    uint32_t types = 0, bins = 0;
+    if (data && len >= 24) {
+        memcpy(&types, p + 8, sizeof(types));
+        memcpy(&bins, p + 12, sizeof(bins));
+    }
+    if (!data || len < 24 || memcmp(p, DISP_MAGIC, 8) != 0 ||
+        types != AGENT_TYPE_COUNT || bins == 0 || bins > 4096) {
+        fprintf(stderr, "dispersion: %s is not a dispersion log\n", disp_path);
+        free(data);
+        return -1;
+    }
+    p += 24;
+
+    FILE *out = writer_fopen(csv_path);
+    if (!out) {
+        free(data);
+        return -1;
+    }
+
+    fprintf(out, "step,price");
+    for (uint32_t t = 0; t < types; t++) {
+        const char *name = TYPE_NAMES[t];
+        fprintf(out, ",%s_agents,%s_belief_mean,%s_belief_std,%s_belief_skew,"
+                     "%s_position_mean,%s_position_std", name, name, name, name, name, name);
+        for (uint32_t k = 0; k < bins; k++) fprintf(out, ",%s_h%u", name, k);
+    }
+    fprintf(out, "\n");
+
+    size_t per_row = 16 + 4 * (size_t)types * (1 + DISP_MOMENTS + bins);
+    int rc = 0;
+    while (p < end) {
+        uint32_t rows;
+        if ((size_t)(end - p) < sizeof(rows)) { rc = -1; break; }
+        memcpy(&rows, p, sizeof(rows));
+        p += sizeof(rows);
+        if ((size_t)(end - p) / per_row < rows) { rc = -1; break; }
+
+        const unsigned char *steps = p;
+        const unsigned char *price = steps + 8 * (size_t)rows;
+        const unsigned char *agents = price + 8 * (size_t)rows;
+        const unsigned char *moments = agents + 4 * (size_t)rows * types;
+        const unsigned char *counts = moments + 4 * (size_t)rows * types * DISP_MOMENTS;
+
+        for (uint32_t r = 0; r < rows; r++) {
+            uint64_t step;
+            double px;
+            memcpy(&step, steps + 8 * (size_t)r, sizeof(step));
+            memcpy(&px, price + 8 * (size_t)r, sizeof(px));
+            fprintf(out, "%llu,%.10g", (unsigned long long)step, px);
+
+            for (uint32_t t = 0; t < types; t++) {
+                uint32_t n;
+                memcpy(&n, agents + 4 * ((size_t)t * rows + r), sizeof(n));
+                fprintf(out, ",%u", n);
+                for (int c = 0; c < DISP_MOMENTS; c++) {
+                    float v;
+                    memcpy(&v, moments + 4 * (((size_t)t * DISP_MOMENTS + c) * rows + r), sizeof(v));
+                    fprintf(out, ",%.7g", v);
+                }
+                for (uint32_t k = 0; k < bins; k++) {
+                    uint32_t v;
+                    memcpy(&v, counts + 4 * (((size_t)t * bins + k) * rows + r), sizeof(v));
+                    fprintf(out, ",%u", v);
+                }
+            }
+            fprintf(out, "\n");
+        }
+        p += (size_t)rows * per_row;
+    }
+    if (rc != 0) fprintf(stderr, "dispersion: %s is corrupt or truncated\n", disp_path);
+
+    fclose(out);
+    free(data);
+    return rc;
+}
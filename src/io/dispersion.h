@@ -0,0 +1,126 @@
+#ifndef JUMPSIM_DISPERSION_H
+#define JUMPSIM_DISPERSION_H
+
+/*
+ * dispersion.h
+ * ------------
+ * Per-step belief dispersion and sentiment by agent type
+ * ("output.dispersion").
+ *
+ * Every step, for each AgentType:
+ *  - a histogram of beliefs relative to the price over DISP_BINS fixed
+ *    log-spaced bins: bin k (0 < k < DISP_BINS - 1) holds agents with
+ *        (k - DISP_BINS/2) w  <=  log(belief / price)  <  (k + 1 - DISP_BINS/2) w
+ *    for the configured width w; the outer bins are open-ended, and the
+ *    middle edge is the price itself
+ *  - mean, standard deviation and skewness of belief / price - 1, from
+ *    central moments per block merged pairwise (herding can make beliefs
+ *    agree to many digits, where raw power sums would cancel)
+ *  - mean and standard deviation of positions
+ *
+ * The fused demand pass (kernels.h) collects these per reduction block
+ * while the block is in cache, and the blocks are combined in block
+ * order, so results do not depend on the thread count. Beliefs are seen
+ * as the demand pass reads them (before this step's update) and
+ * positions after execution, at the pre-clearing price.
+ *
+ * A bin costs no logarithm and no search: a table over a uniform grid
+ * finer than the narrowest bin gives the bin up to one edge, and one
+ * exact comparison on each side settles it (disp_bin).
+ *
+ * Layout (little-endian):
+ *   header   magic "JSDSP001", uint32 n_types, uint32 n_bins, f64 bin width
+ *   groups   uint32 rows, then the columns
+ *              uint64  step[rows]
+ *              f64     price[rows]
+ *              uint32  agents[type][rows]
+ *              f32     belief mean, std, skew, position mean, std: each [type][rows]
+ *              uint32  count[type][bin][rows]
+ *
+ * disp_to_csv() decodes a log.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "writer.h"
+#include "agent.h"
+
+/* -------------------- Constants -------------------- */
+
+#define DISP_MAGIC "JSDSP001"
+#define DISP_BINS 32
+
+/* Grid cells of the bin lookup table; bounds the bin width to about 0.1 */
+#define DISP_LUT 256
+
+/* Records buffered per written group */
+#define DISP_GROUP 256
+
+/* Moments per type in the output: belief mean, std, skew, position mean, std */
+#define DISP_MOMENTS 5
+
+/* -------------------- Types -------------------- */
+
+/* One reduction block's sums for the step */
+typedef struct DispersionBlock {
+    uint32_t n[AGENT_TYPE_COUNT];
+    double belief[AGENT_TYPE_COUNT][3];     /* mean, M2, M3 of d = belief / price - 1 */
+    double position[AGENT_TYPE_COUNT][2];   /* sums of q, q^2 */
+    uint32_t hist[AGENT_TYPE_COUNT][DISP_BINS];
+} DispersionBlock;
+
+typedef struct DispersionLog {
+    FILE *fp;
+    DispersionConfig cfg;
+    /* Bin k spans edge[k] <= d < edge[k + 1] in d = belief / price - 1 (edge[0] = -inf) */
+    double edge[DISP_BINS + 1];
+    uint8_t lut[DISP_LUT];        /* grid cell -> bin of its lower end, about */
+    double lut_origin, lut_scale; /* cell = (d - origin) * scale, clamped */
+
+    DispersionBlock *blocks;
+    size_t n_blocks;
+
+    /* Group under construction */
+    uint32_t rows;
+    uint64_t *steps;
+    double *price;
+    uint32_t *agents;             /* [type][row] */
+    float *moments;               /* [type][moment][row] */
+    uint32_t *counts;             /* [type][bin][row] */
+
+    bool failed;
+    uint64_t records;
+    uint64_t bytes;
+} DispersionLog;
+
+/* -------------------- API (implemented in dispersion.c) -------------------- */
+
+/* Histogram bin of deviation 'dev' (belief / price - 1) */
+static inline int disp_bin(const DispersionLog *d, double dev) {
+    double u = (dev - d->lut_origin) * d->lut_scale;
+    u = u < 0.0 ? 0.0 : (u > DISP_LUT - 1 ? DISP_LUT - 1 : u);
+    int b = d->lut[(int)u];
+    return b + (dev >= d->edge[b + 1]) - (dev < d->edge[b]);
+}
+
+/*
+ * Create cfg->path for a demand pass over 'n_agents' agents in blocks
+ * of 'block' and write the header. Returns 0 / -1.
+ */
+int disp_open(DispersionLog *d, const DispersionConfig *cfg, size_t n_agents, size_t block);
+
+/* Combine the blocks of step 'step' (demand pass at 'price') into a record */
+void disp_end_step(DispersionLog *d, uint64_t step, double price);
+
+/* Write the last group and close. Returns 0 / -1 (write error) */
+int disp_close(DispersionLog *d);
+
+/*
+ * Decode a log into one CSV row per step: step, price, then per type
+ * the agent count, the moments and the bin counts. Returns 0 / -1.
+ */
+int disp_to_csv(const char *disp_path, const char *csv_path);
+
+#endif /* JUMPSIM_DISPERSION_H */
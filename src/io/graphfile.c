@@ -0,0 +1,313 @@
+#include "graphfile.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "graphfile: edge lists and caches are little-endian; byte swapping is not implemented"
+#endif
+
+/* ----------------------------------------------------
+   Helpers
+---------------------------------------------------- */
+
+/* Bytes per independently hashed block (fixed: hash is thread-count free) */
+#define HASH_BLOCK (1u << 20)
+
+static size_t align_up(size_t x, size_t a)
+{
+    return (x + a - 1) / a * a;
+}
+
+static int64_t mtime_ns(const struct stat *st)
+{
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + (int64_t)st->st_mtim.tv_nsec;
+}
+
+/* Hash fixed-size blocks in parallel, then fold the block hashes in order */
+static int hash_array(uint64_t *h, const void *data, size_t bytes)
+{
+    const unsigned char *p = data;
+    size_t n_blocks = (bytes + HASH_BLOCK - 1) / HASH_BLOCK;
+    uint64_t *part = malloc((n_blocks ? n_blocks : 1) * sizeof(uint64_t));
+    if (!part) return -1;
+
+    long count = (long)n_blocks;
+
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < count; b++) {
+        size_t lo = (size_t)b * HASH_BLOCK;
+        size_t len = bytes - lo < HASH_BLOCK ? bytes - lo : HASH_BLOCK;
+        size_t words = len / 8;
+        uint64_t x = HASH_FNV_OFFSET;
+
+        for (size_t k = 0; k < words; k++) {
+            uint64_t w;
+            memcpy(&w, p + lo + 8 * k, 8);
+            x = hash_u64(x, w);
+        }
+        part[b] = hash_bytes(x, p + lo + 8 * words, len - 8 * words);
+    }
+
+    for (size_t b = 0; b < n_blocks; b++) *h = hash_u64(*h, part[b]);
+    free(part);
+    return 0;
+}
+
+static int graph_content_hash(const Graph *g, uint64_t *out)
+{
+    uint64_t h = hash_u64(hash_u64(HASH_FNV_OFFSET, g->n), g->m);
+
+    if (hash_array(&h, g->offsets, (g->n + 1) * sizeof(uint64_t)) != 0 ||
+        hash_array(&h, g->adj, g->m * sizeof(uint32_t)) != 0) {
+        return -1;
+    }
+    *out = h;
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Edge list
+---------------------------------------------------- */
+
+static int build_from_edges(Graph *g, const NetworkConfig *cfg, size_t n,
+                            const struct stat *st, unsigned flags)
+{
+    const char *path = cfg->edges;
+    size_t size = (size_t)st->st_size;
+
+    if (size == 0 || size % (2 * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "graphfile: %s is not a list of uint32 (src, dst) pairs\n", path);
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "graphfile: cannot open %s\n", path);
+        return -1;
+    }
+    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "graphfile: cannot map %s\n", path);
+        return -1;
+    }
+    madvise(base, size, MADV_WILLNEED);
+
+    const uint32_t *edges = base;
+    size_t n_edges = size / (2 * sizeof(uint32_t));
+    long n_ids = (long)(2 * n_edges);
+    uint32_t max_id = 0;
+
+    /* graph_from_edges drops out-of-range ids; for data that is an error */
+    #pragma omp parallel for schedule(static) reduction(max:max_id)
+    for (long k = 0; k < n_ids; k++) {
+        if (edges[k] > max_id) max_id = edges[k];
+    }
+
+    int rc = -1;
+    if ((size_t)max_id >= n) {
+        fprintf(stderr, "graphfile: %s refers to agent %u but there are only %zu agents\n",
+                path, max_id, n);
+    }
+    else {
+        rc = graph_from_edges(g, n, edges, n_edges, flags);
+    }
+
+    munmap(base, size);
+    return rc;
+}
+
+/* ----------------------------------------------------
+   CSR cache
+---------------------------------------------------- */
+
+/* Map 'path' if it is a valid cache for 'key'; 1 on success, 0 if absent
+   or stale, -1 if unreadable */
+static int cache_open(GraphFile *f, const char *path, const GraphFileHeader *key)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(GraphFileHeader)) {
+        close(fd);
+        fprintf(stderr, "graphfile: %s is not a graph cache\n", path);
+        return -1;
+    }
+
+    /* Read-only and shared: every process mapping the cache shares its pages */
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "graphfile: cannot map %s\n", path);
+        return -1;
+    }
+
+    f->base = base;
+    f->size = (size_t)st.st_size;
+
+    const GraphFileHeader *h = (const GraphFileHeader *)f->base;
+
+    if (memcmp(h->magic, GRAPHFILE_MAGIC, 8) != 0 || h->align == 0 || h->align % 8 != 0) {
+        fprintf(stderr, "graphfile: %s has an invalid header\n", path);
+        graphfile_close(f);
+        return -1;
+    }
+
+    if (h->n_nodes != key->n_nodes || h->flags != key->flags ||
+        h->source_size != key->source_size || h->source_mtime_ns != key->source_mtime_ns) {
+        fprintf(stderr, "graphfile: %s is stale, rebuilding\n", path);
+        graphfile_close(f);
+        return 0;
+    }
+
+    size_t adj_at = align_up(h->align + (size_t)(h->n_nodes + 1) * sizeof(uint64_t), h->align);
+    if (adj_at > f->size || (f->size - adj_at) / sizeof(uint32_t) < h->m) {
+        fprintf(stderr, "graphfile: %s is truncated\n", path);
+        graphfile_close(f);
+        return -1;
+    }
+
+    /* Rows must be well formed: the gather trusts them */
+    const uint64_t *off = (const uint64_t *)(f->base + h->align);
+    long count = (long)h->n_nodes;
+    int bad = (off[0] != 0 || off[h->n_nodes] != h->m);
+
+    #pragma omp parallel for schedule(static) reduction(|:bad)
+    for (long i = 0; i < count; i++) bad |= (off[i] > off[i + 1]);
+
+    if (bad) {
+        fprintf(stderr, "graphfile: %s has invalid row offsets\n", path);
+        graphfile_close(f);
+        return -1;
+    }
+
+    /* ...and every neighbor id must name a node */
+    const uint32_t *adj = (const uint32_t *)(f->base + adj_at);
+    uint64_t n_nodes = h->n_nodes;
+    long n_adj = (long)h->m;
+
+    #pragma omp parallel for schedule(static) reduction(|:bad)
+    for (long e = 0; e < n_adj; e++) bad |= ((uint64_t)adj[e] >= n_nodes);
+
+    if (bad) {
+        fprintf(stderr, "graphfile: %s has out-of-range neighbor ids\n", path);
+        graphfile_close(f);
+        return -1;
+    }
+
+    f->content_hash = h->content_hash;
+    madvise(f->base, f->size, MADV_WILLNEED);
+    return 1;
+}
+
+static void cache_bind(const GraphFile *f, Graph *g)
+{
+    const GraphFileHeader *h = (const GraphFileHeader *)f->base;
+    size_t adj_at = align_up(h->align + (size_t)(h->n_nodes + 1) * sizeof(uint64_t), h->align);
+
+    memset(g, 0, sizeof(Graph));
+    g->n = (size_t)h->n_nodes;
+    g->m = (size_t)h->m;
+    g->offsets = (uint64_t *)(f->base + h->align);     /* zero-copy */
+    g->adj = (uint32_t *)(f->base + adj_at);
+    g->mapping = f->base;
+    g->mapping_size = f->size;
+}
+
+static int write_padding(FILE *fp, size_t from, size_t to)
+{
+    static const unsigned char zeros[256];
+
+    while (from < to) {
+        size_t k = to - from < sizeof(zeros) ? to - from : sizeof(zeros);
+        if (fwrite(zeros, 1, k, fp) != k) return -1;
+        from += k;
+    }
+    return 0;
+}
+
+/* Written under a temporary name and renamed, so concurrent runs never
+   map a half-written cache */
+static int cache_write(const Graph *g, const GraphFileHeader *header, const char *path)
+{
+    char tmp[GRAPH_PATH_MAX + 32];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return -1;
+
+    size_t offsets_bytes = (g->n + 1) * sizeof(uint64_t);
+    size_t adj_at = align_up(GRAPHFILE_ALIGN + offsets_bytes, GRAPHFILE_ALIGN);
+
+    int rc = 0;
+    rc |= (fwrite(header, sizeof(GraphFileHeader), 1, fp) != 1);
+    rc |= write_padding(fp, sizeof(GraphFileHeader), GRAPHFILE_ALIGN);
+    rc |= (fwrite(g->offsets, 1, offsets_bytes, fp) != offsets_bytes);
+    rc |= write_padding(fp, GRAPHFILE_ALIGN + offsets_bytes, adj_at);
+    rc |= (fwrite(g->adj, sizeof(uint32_t), g->m, fp) != g->m);
+    rc |= (fclose(fp) != 0);
+
+    if (rc == 0 && rename(tmp, path) == 0) return 0;
+    remove(tmp);
+    return -1;
+}
+
+/* ----------------------------------------------------
+   Public API
+---------------------------------------------------- */
+
+int graphfile_load(Graph *g, GraphFile *f, const NetworkConfig *cfg, size_t n)
+{
+    memset(f, 0, sizeof(GraphFile));
+    memset(g, 0, sizeof(Graph));
+
+    struct stat st;
+    if (stat(cfg->edges, &st) != 0) {
+        fprintf(stderr, "graphfile: cannot open edge list '%s'\n", cfg->edges);
+        return -1;
+    }
+
+    GraphFileHeader key;
+    memset(&key, 0, sizeof(key));
+    memcpy(key.magic, GRAPHFILE_MAGIC, 8);
+    key.n_nodes = n;
+    key.flags = (cfg->symmetrize ? GRAPH_SYMMETRIZE : 0) | (cfg->dedup ? GRAPH_DEDUP : 0);
+    key.source_size = (uint64_t)st.st_size;
+    key.source_mtime_ns = mtime_ns(&st);
+    key.align = GRAPHFILE_ALIGN;
+
+    if (cfg->cache[0] != '\0' && cache_open(f, cfg->cache, &key) == 1) {
+        cache_bind(f, g);
+        return 0;
+    }
+
+    if (build_from_edges(g, cfg, n, &st, key.flags) != 0) return -1;
+
+    if (graph_content_hash(g, &f->content_hash) != 0) {
+        graph_free(g);
+        return -1;
+    }
+
+    if (cfg->cache[0] != '\0') {
+        key.m = g->m;
+        key.content_hash = f->content_hash;
+        if (cache_write(g, &key, cfg->cache) != 0) {
+            fprintf(stderr, "graphfile: warning: cannot write cache %s\n", cfg->cache);
+        }
+    }
+    return 0;
+}
+
+void graphfile_close(GraphFile *f)
+{
+    if (f->base) munmap(f->base, f->size);
+    memset(f, 0, sizeof(GraphFile));
+}
@@ -0,0 +1,68 @@
+#ifndef JUMPSIM_GRAPHFILE_H
+#define JUMPSIM_GRAPHFILE_H
+
+/*
+ * graphfile.h
+ * -----------
+ * Empirical social networks (e.g. follower graphs) loaded from binary
+ * edge lists, with an on-disk cache of the built CSR.
+ *
+ * Edge list: raw little-endian uint32 pairs (src, dst) and nothing else,
+ * as exported by most graph tools. The file is memory-mapped and handed
+ * to the parallel CSR build (graph_from_edges), so a 1e8-edge list costs
+ * the page-ins plus a few passes over the edges. Ids must be below
+ * num_agents; agents that never appear are isolated.
+ *
+ * CSR cache layout (little-endian):
+ *   header   GraphFileHeader (64 bytes, magic "JSCSR001")
+ *   offsets  n_nodes + 1 uint64, at GRAPHFILE_ALIGN
+ *   adj      m uint32, at the next GRAPHFILE_ALIGN boundary
+ *
+ * Later runs map the cache read-only and shared instead of rebuilding:
+ * every process of an ensemble then reads the same page-cache pages. The
+ * cache is keyed on the edge list's size and modification time, the node
+ * count and the build flags; any mismatch rebuilds and rewrites it.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "graph.h"
+
+/* -------------------- Types & Constants -------------------- */
+
+#define GRAPHFILE_MAGIC "JSCSR001"
+#define GRAPHFILE_ALIGN 4096
+
+typedef struct GraphFileHeader {
+    char magic[8];
+    uint64_t n_nodes;
+    uint64_t m;                /* adjacency entries */
+    uint64_t content_hash;     /* over n, m, offsets and adj */
+    uint64_t source_size;      /* edge list the cache was built from */
+    int64_t source_mtime_ns;
+    uint32_t flags;            /* graph_from_edges() flags */
+    uint32_t align;
+    uint8_t reserved[8];
+} GraphFileHeader;
+
+/* A loaded network: owner of the cache mapping the graph may borrow */
+typedef struct GraphFile {
+    unsigned char *base;       /* NULL if the graph was built in memory */
+    size_t size;
+    uint64_t content_hash;     /* identifies the graph in run records */
+} GraphFile;
+
+/* -------------------- API (implemented in graphfile.c) -------------------- */
+
+/*
+ * Build the NETWORK_FILE graph of 'cfg' over 'n' nodes into 'g', reusing
+ * or refreshing cfg->cache when set. A failure to write the cache is only
+ * a warning. Release with graph_free before graphfile_close.
+ * Returns 0 / -1.
+ */
+int graphfile_load(Graph *g, GraphFile *f, const NetworkConfig *cfg, size_t n);
+
+void graphfile_close(GraphFile *f);
+
+#endif /* JUMPSIM_GRAPHFILE_H */
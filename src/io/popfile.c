@@ -0,0 +1,491 @@
+#include "popfile.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "popfile: population files are little-endian; byte swapping is not implemented"
+#endif
+
+/* ----------------------------------------------------
+   Known columns
+---------------------------------------------------- */
+
+typedef enum {
+    DEF_REQUIRED,
+    DEF_ZERO,
+    DEF_ONE,
+    DEF_INIT_PRICE,
+    DEF_RNG_SEED
+} ColumnDefault;
+
+typedef struct {
+    const char *name;
+    PopDtype dtype;
+    bool is_state;        /* field lives in AgentState, else AgentParams */
+    size_t field;         /* offsetof the column pointer */
+    ColumnDefault def;
+} ColumnSpec;
+
+static const ColumnSpec COLUMN_SPECS[] = {
+    { "type",                POP_U8,  false, offsetof(AgentParams, type),                DEF_REQUIRED },
+    { "aggressiveness",      POP_F64, false, offsetof(AgentParams, aggressiveness),      DEF_REQUIRED },
+    { "trade_size_scale",    POP_F64, false, offsetof(AgentParams, trade_size_scale),    DEF_ONE },
+    { "risk_aversion",       POP_F64, false, offsetof(AgentParams, risk_aversion),       DEF_REQUIRED },
+    { "liquidity_tolerance", POP_F64, false, offsetof(AgentParams, liquidity_tolerance), DEF_REQUIRED },
+    { "belief_update_rate",  POP_F64, false, offsetof(AgentParams, belief_update_rate),  DEF_REQUIRED },
+    { "network_influence",   POP_F64, false, offsetof(AgentParams, network_influence),   DEF_ZERO },
+    { "noise_std",           POP_F64, false, offsetof(AgentParams, noise_std),           DEF_REQUIRED },
+    { "fundamental_anchor",  POP_F64, false, offsetof(AgentParams, fundamental_anchor),  DEF_INIT_PRICE },
+    { "belief",              POP_F64, true,  offsetof(AgentState, belief),               DEF_INIT_PRICE },
+    { "cash",                POP_F64, true,  offsetof(AgentState, cash),                 DEF_ZERO },
+    { "rng_state",           POP_U64, true,  offsetof(AgentState, rng_state),            DEF_RNG_SEED },
+    { "position",            POP_I32, true,  offsetof(AgentState, position),             DEF_ZERO }
+};
+
+#define N_COLUMN_SPECS ((int)(sizeof(COLUMN_SPECS) / sizeof(COLUMN_SPECS[0])))
+
+static size_t dtype_size(uint32_t dtype)
+{
+    switch (dtype) {
+        case POP_U8:  return 1;
+        case POP_I32: return 4;
+        case POP_U64: return 8;
+        case POP_F64: return 8;
+        default:      return 0;
+    }
+}
+
+static int find_spec(const char *name)
+{
+    for (int i = 0; i < N_COLUMN_SPECS; i++) {
+        if (strcmp(COLUMN_SPECS[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Column pointers are reached through the table's offsets */
+static void column_set(AgentParams *p, AgentState *s, const ColumnSpec *c, void *ptr)
+{
+    char *obj = c->is_state ? (char *)s : (char *)p;
+    memcpy(obj + c->field, &ptr, sizeof(ptr));
+}
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+int popfile_open(PopulationFile *f, const char *path)
+{
+    memset(f, 0, sizeof(PopulationFile));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "popfile: cannot open %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PopFileHeader)) {
+        fprintf(stderr, "popfile: %s is not a population file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    /* Private + writable: state columns are modified copy-on-write */
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "popfile: cannot map %s\n", path);
+        return -1;
+    }
+
+    f->base = base;
+    f->size = (size_t)st.st_size;
+    f->header = (const PopFileHeader *)f->base;
+    f->columns = (const PopColumnDesc *)(f->base + sizeof(PopFileHeader));
+
+    const PopFileHeader *h = f->header;
+    size_t dir_end = sizeof(PopFileHeader) + (size_t)h->n_columns * sizeof(PopColumnDesc);
+
+    if (memcmp(h->magic, POPFILE_MAGIC, 8) != 0 || h->n_agents == 0 ||
+        h->n_columns > 1024 || dir_end > f->size ||
+        h->align == 0 || h->align % 8 != 0) {
+        fprintf(stderr, "popfile: %s has an invalid header\n", path);
+        popfile_close(f);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < h->n_columns; i++) {
+        const PopColumnDesc *c = &f->columns[i];
+        size_t width = dtype_size(c->dtype);
+
+        if (width == 0 || memchr(c->name, '\0', POPFILE_NAME_MAX) == NULL ||
+            c->offset % h->align != 0 || c->offset < dir_end ||
+            c->offset > f->size || (f->size - c->offset) / width < h->n_agents) {
+            fprintf(stderr, "popfile: %s has an invalid column directory\n", path);
+            popfile_close(f);
+            return -1;
+        }
+    }
+
+    /* Start paging in while the rest of setup runs */
+    madvise(f->base, f->size, MADV_WILLNEED);
+    return 0;
+}
+
+size_t popfile_agents(const PopulationFile *f)
+{
+    return (size_t)f->header->n_agents;
+}
+
+uint64_t popfile_hash(const PopulationFile *f)
+{
+    return f->header->content_hash;
+}
+
+void popfile_close(PopulationFile *f)
+{
+    if (f->base) munmap(f->base, f->size);
+    memset(f, 0, sizeof(PopulationFile));
+}
+
+/* ----------------------------------------------------
+   Binding columns
+---------------------------------------------------- */
+
+static const PopColumnDesc *find_column(const PopulationFile *f, const char *name)
+{
+    for (uint32_t i = 0; i < f->header->n_columns; i++) {
+        if (strcmp(f->columns[i].name, name) == 0) return &f->columns[i];
+    }
+    return NULL;
+}
+
+static void *default_column(const ColumnSpec *c, const PopulationSpec *spec, size_t n)
+{
+    void *col = malloc(n * dtype_size(c->dtype));
+    if (!col) return NULL;
+
+    long count = (long)n;
+
+    switch (c->def) {
+        case DEF_RNG_SEED: {
+            uint64_t *v = col;
+            #pragma omp parallel for schedule(static)
+            for (long i = 0; i < count; i++) v[i] = population_rng_seed(spec, (AgentId)i);
+            break;
+        }
+        case DEF_INIT_PRICE:
+        case DEF_ONE: {
+            double x = (c->def == DEF_ONE) ? 1.0 : spec->init_price;
+            double *v = col;
+            #pragma omp parallel for schedule(static)
+            for (long i = 0; i < count; i++) v[i] = x;
+            break;
+        }
+        default:
+            memset(col, 0, n * dtype_size(c->dtype));
+            break;
+    }
+    return col;
+}
+
+int popfile_bind(const PopulationFile *f, const PopulationSpec *spec,
+                 AgentParams *params, AgentState *state)
+{
+    size_t n = popfile_agents(f);
+
+    memset(params, 0, sizeof(AgentParams));
+    memset(state, 0, sizeof(AgentState));
+    params->n = state->n = n;
+    params->mapping = state->mapping = f->base;
+    params->mapping_size = state->mapping_size = f->size;
+
+    for (int i = 0; i < N_COLUMN_SPECS; i++) {
+        const ColumnSpec *c = &COLUMN_SPECS[i];
+        const PopColumnDesc *d = find_column(f, c->name);
+        void *col;
+
+        if (d) {
+            if (d->dtype != (uint32_t)c->dtype) {
+                fprintf(stderr, "popfile: column '%s' has the wrong type\n", c->name);
+                goto fail;
+            }
+            col = f->base + d->offset;              /* zero-copy */
+        }
+        else if (c->def == DEF_REQUIRED) {
+            fprintf(stderr, "popfile: required column '%s' is missing\n", c->name);
+            goto fail;
+        }
+        else if (!(col = default_column(c, spec, n))) {
+            goto fail;
+        }
+
+        column_set(params, state, c, col);
+    }
+
+    /* Kernels index AGENT_TYPE_RESPONSE by type: reject bad codes up front */
+    const uint8_t *type = params->type;
+    long count = (long)n;
+    int bad = 0;
+
+    #pragma omp parallel for schedule(static) reduction(|:bad)
+    for (long i = 0; i < count; i++) bad |= (type[i] >= AGENT_TYPE_COUNT);
+
+    if (bad) {
+        fprintf(stderr, "popfile: column 'type' has codes outside 0..%d\n", AGENT_TYPE_COUNT - 1);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    agent_params_free(params);
+    agent_state_free(state);
+    return -1;
+}
+
+/* ----------------------------------------------------
+   CSV conversion
+---------------------------------------------------- */
+
+/* Split 'line' in place on commas; trims blanks and the line ending */
+static int split_fields(char *line, char **fields, int max_fields)
+{
+    int n = 0;
+    char *s = line;
+
+    while (n < max_fields) {
+        char *end = strchr(s, ',');
+        if (end) *end = '\0';
+
+        while (isspace((unsigned char)*s)) s++;
+        char *t = s + strlen(s);
+        while (t > s && isspace((unsigned char)t[-1])) *--t = '\0';
+
+        fields[n++] = s;
+        if (!end) break;
+        s = end + 1;
+    }
+    return n;
+}
+
+static bool blank_line(const char *s)
+{
+    while (isspace((unsigned char)*s)) s++;
+    return *s == '\0';
+}
+
+static int parse_type(const char *s, uint8_t *out)
+{
+    if (strcmp(s, "retail") == 0) { *out = AGENT_RETAIL; return 0; }
+    if (strcmp(s, "institution") == 0) { *out = AGENT_INSTITUTION; return 0; }
+    if (strcmp(s, "noise") == 0) { *out = AGENT_NOISE; return 0; }
+
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < 0 || v >= AGENT_TYPE_COUNT) return -1;
+    *out = (uint8_t)v;
+    return 0;
+}
+
+static int parse_value(const ColumnSpec *c, const char *s, unsigned char *col, size_t row)
+{
+    char *end;
+
+    switch (c->dtype) {
+        case POP_U8:
+            return parse_type(s, &col[row]);
+
+        case POP_I32: {
+            long long v = strtoll(s, &end, 10);
+            if (end == s || *end != '\0' || v < INT32_MIN || v > INT32_MAX) return -1;
+            int32_t x = (int32_t)v;
+            memcpy(col + row * 4, &x, 4);
+            return 0;
+        }
+
+        case POP_U64: {
+            unsigned long long v = strtoull(s, &end, 0);
+            if (end == s || *end != '\0') return -1;
+            uint64_t x = (uint64_t)v;
+            memcpy(col + row * 8, &x, 8);
+            return 0;
+        }
+
+        case POP_F64:
+        default: {
+            double v = strtod(s, &end);
+            if (end == s || *end != '\0') return -1;
+            memcpy(col + row * 8, &v, 8);
+            return 0;
+        }
+    }
+}
+
+static size_t align_up(size_t x, size_t a)
+{
+    return (x + a - 1) / a * a;
+}
+
+int popfile_convert_csv(const char *csv_path, const char *out_path)
+{
+    FILE *in = fopen(csv_path, "r");
+    if (!in) {
+        fprintf(stderr, "popfile: cannot open %s\n", csv_path);
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    char *fields[N_COLUMN_SPECS * 4];
+    int max_fields = (int)(sizeof(fields) / sizeof(fields[0]));
+
+    int field_spec[N_COLUMN_SPECS * 4];   /* CSV field -> spec index or -1 */
+    int spec_slot[N_COLUMN_SPECS];        /* spec index -> file column or -1 */
+    int n_fields = 0, n_out = 0;
+    int status = -1;
+
+    int fd = -1;
+    unsigned char *map = MAP_FAILED;
+    size_t total = 0;
+
+    /* Header row */
+    if (getline(&line, &line_cap, in) < 0) {
+        fprintf(stderr, "popfile: %s is empty\n", csv_path);
+        goto done;
+    }
+    n_fields = split_fields(line, fields, max_fields);
+
+    for (int i = 0; i < N_COLUMN_SPECS; i++) spec_slot[i] = -1;
+    for (int j = 0; j < n_fields; j++) {
+        int k = find_spec(fields[j]);
+        field_spec[j] = k;
+        if (k < 0) {
+            fprintf(stderr, "popfile: ignoring unknown column '%s'\n", fields[j]);
+            continue;
+        }
+        if (spec_slot[k] >= 0) {
+            fprintf(stderr, "popfile: duplicate column '%s'\n", fields[j]);
+            goto done;
+        }
+        spec_slot[k] = n_out++;
+    }
+
+    for (int i = 0; i < N_COLUMN_SPECS; i++) {
+        if (COLUMN_SPECS[i].def == DEF_REQUIRED && spec_slot[i] < 0) {
+            fprintf(stderr, "popfile: required column '%s' is missing from %s\n",
+                    COLUMN_SPECS[i].name, csv_path);
+            goto done;
+        }
+    }
+
+    /* Pass 1: count rows so the output can be sized and mapped once */
+    size_t n_agents = 0;
+    while (getline(&line, &line_cap, in) >= 0) {
+        if (!blank_line(line)) n_agents++;
+    }
+    if (n_agents == 0) {
+        fprintf(stderr, "popfile: %s has no rows\n", csv_path);
+        goto done;
+    }
+
+    /* Layout: header, directory, page-aligned columns */
+    PopFileHeader header;
+    PopColumnDesc dir[N_COLUMN_SPECS];
+    memset(&header, 0, sizeof(header));
+    memset(dir, 0, sizeof(dir));
+
+    memcpy(header.magic, POPFILE_MAGIC, 8);
+    header.n_agents = n_agents;
+    header.n_columns = (uint32_t)n_out;
+    header.align = POPFILE_ALIGN;
+
+    total = sizeof(PopFileHeader) + (size_t)n_out * sizeof(PopColumnDesc);
+    for (int i = 0; i < N_COLUMN_SPECS; i++) {
+        int slot = spec_slot[i];
+        if (slot < 0) continue;
+
+        total = align_up(total, POPFILE_ALIGN);
+        snprintf(dir[slot].name, POPFILE_NAME_MAX, "%s", COLUMN_SPECS[i].name);
+        dir[slot].dtype = COLUMN_SPECS[i].dtype;
+        dir[slot].offset = total;
+        total += n_agents * dtype_size(COLUMN_SPECS[i].dtype);
+    }
+
+    fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)total) != 0) {
+        fprintf(stderr, "popfile: cannot create %s\n", out_path);
+        goto done;
+    }
+    map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "popfile: cannot map %s\n", out_path);
+        goto done;
+    }
+
+    /* Pass 2: parse straight into the mapped columns */
+    rewind(in);
+    if (getline(&line, &line_cap, in) < 0) goto done;
+
+    size_t row = 0;
+    size_t line_no = 1;
+    while (row < n_agents && getline(&line, &line_cap, in) >= 0) {
+        line_no++;
+        if (blank_line(line)) continue;
+
+        int n = split_fields(line, fields, max_fields);
+        if (n != n_fields) {
+            fprintf(stderr, "popfile: %s:%zu: expected %d fields, got %d\n",
+                    csv_path, line_no, n_fields, n);
+            goto done;
+        }
+
+        for (int j = 0; j < n; j++) {
+            int k = field_spec[j];
+            if (k < 0) continue;
+
+            unsigned char *col = map + dir[spec_slot[k]].offset;
+            if (parse_value(&COLUMN_SPECS[k], fields[j], col, row) != 0) {
+                fprintf(stderr, "popfile: %s:%zu: bad value '%s' for '%s'\n",
+                        csv_path, line_no, fields[j], COLUMN_SPECS[k].name);
+                goto done;
+            }
+        }
+        row++;
+    }
+
+    /* Content hash over the columns in directory order */
+    uint64_t h = HASH_FNV_OFFSET;
+    for (int s = 0; s < n_out; s++) {
+        int k = find_spec(dir[s].name);
+        h = hash_bytes(h, map + dir[s].offset, n_agents * dtype_size(COLUMN_SPECS[k].dtype));
+    }
+    header.content_hash = h;
+
+    memcpy(map, &header, sizeof(header));
+    memcpy(map + sizeof(header), dir, (size_t)n_out * sizeof(PopColumnDesc));
+
+    if (msync(map, total, MS_SYNC) != 0) {
+        fprintf(stderr, "popfile: cannot write %s\n", out_path);
+        goto done;
+    }
+
+    printf("Converted %zu agents (%d columns) to %s\n", n_agents, n_out, out_path);
+    status = 0;
+
+done:
+    if (map != MAP_FAILED) munmap(map, total);
+    if (fd >= 0) close(fd);
+    if (status != 0 && fd >= 0) unlink(out_path);
+    free(line);
+    fclose(in);
+    return status;
+}
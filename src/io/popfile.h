@@ -0,0 +1,107 @@
+#ifndef JUMPSIM_POPFILE_H
+#define JUMPSIM_POPFILE_H
+
+/*
+ * popfile.h
+ * ---------
+ * Binary columnar population files: externally defined agents (e.g.
+ * derived from account-level data) loaded straight into the SoA
+ * population of population.h.
+ *
+ * The file stores one page-aligned column per field in exactly the
+ * in-memory layout of AgentParams/AgentState, so loading is an mmap():
+ *  - parameter columns are used in place (read-only)
+ *  - state columns are used in place too; the mapping is MAP_PRIVATE, so
+ *    the first write to a page copies it and the file is never modified
+ *  - columns absent from the file are allocated and filled with defaults
+ *
+ * Loading 1e7 agents therefore costs the page-ins, not text parsing. The
+ * one-time CSV conversion is popfile_convert_csv().
+ *
+ * Layout (little-endian):
+ *   header     PopFileHeader (64 bytes, magic "JSPOP001")
+ *   directory  n_columns x PopColumnDesc
+ *   columns    each at a POPFILE_ALIGN-aligned offset, n_agents values
+ *
+ * Known columns (unknown names are ignored):
+ *   type (u8, required; 0 retail, 1 institution, 2 noise)
+ *   aggressiveness, risk_aversion, liquidity_tolerance,
+ *   belief_update_rate, noise_std (f64, required)
+ *   trade_size_scale (f64, default 1), network_influence (f64, default 0),
+ *   fundamental_anchor, belief (f64, default initial price),
+ *   cash (f64, default 0), position (i32, default 0),
+ *   rng_state (u64, default derived from seed and id as for generated agents)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "population.h"
+
+/* -------------------- Types & Constants -------------------- */
+
+#define POPFILE_MAGIC "JSPOP001"
+#define POPFILE_ALIGN 4096
+#define POPFILE_NAME_MAX 32
+
+typedef enum {
+    POP_U8 = 1,
+    POP_I32 = 2,
+    POP_U64 = 3,
+    POP_F64 = 4
+} PopDtype;
+
+typedef struct PopFileHeader {
+    char magic[8];
+    uint64_t n_agents;
+    uint32_t n_columns;
+    uint32_t align;
+    uint64_t content_hash;     /* FNV-1a over the column bytes, in order */
+    uint8_t reserved[32];
+} PopFileHeader;
+
+typedef struct PopColumnDesc {
+    char name[POPFILE_NAME_MAX];
+    uint32_t dtype;            /* PopDtype */
+    uint32_t reserved;
+    uint64_t offset;           /* from start of file */
+} PopColumnDesc;
+
+/* A mapped population file (owner of the mapping) */
+typedef struct PopulationFile {
+    unsigned char *base;
+    size_t size;
+    const PopFileHeader *header;
+    const PopColumnDesc *columns;
+} PopulationFile;
+
+/* -------------------- API (implemented in popfile.c) -------------------- */
+
+/* Map 'path' and validate its header and directory. Returns 0 / -1 */
+int popfile_open(PopulationFile *f, const char *path);
+
+/* Number of agents in an opened file */
+size_t popfile_agents(const PopulationFile *f);
+
+/* Content hash stored by the converter (identifies the input in run records) */
+uint64_t popfile_hash(const PopulationFile *f);
+
+/*
+ * Point 'params' and 'state' at the file's columns (zero-copy), allocating
+ * and filling defaults for absent ones. 'spec' supplies the initial price
+ * and the seed for derived RNG streams. Release with agent_params_free /
+ * agent_state_free before popfile_close. Returns 0 / -1.
+ */
+int popfile_bind(const PopulationFile *f, const PopulationSpec *spec,
+                 AgentParams *params, AgentState *state);
+
+void popfile_close(PopulationFile *f);
+
+/*
+ * Convert a CSV with a header row of column names (see above; 'type' may
+ * also be retail/institution/noise) into a population file.
+ * Returns 0 / -1.
+ */
+int popfile_convert_csv(const char *csv_path, const char *out_path);
+
+#endif /* JUMPSIM_POPFILE_H */
@@ -0,0 +1,132 @@
+#include "pyramid.h"
+#include "writer.h"
+#include <string.h>
+
+/* ----------------------------------------------------
+   File layout
+---------------------------------------------------- */
+
+/*
+ Every level file starts with a 16-byte header:
+   char     magic[8]     = "JSPYR001"
+   uint32_t level        (k: bars span 2^k steps)
+   uint32_t record_size  (sizeof(PyramidBar))
+ followed by PyramidBar records in time order.
+*/
+
+static const char PYRAMID_MAGIC[8] = { 'J', 'S', 'P', 'Y', 'R', '0', '0', '1' };
+
+static FILE *open_level(PricePyramid *p, int idx)
+{
+    if (p->files[idx]) return p->files[idx];
+
+    uint32_t level = (uint32_t)(PYRAMID_BASE_LEVEL + idx);
+    uint32_t record_size = (uint32_t)sizeof(PyramidBar);
+
+    char path[PYRAMID_PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s.L%02u.pyr", p->base_path, level);
+
+    FILE *fp = writer_fopen(path);
+    if (!fp) return NULL;
+
+    fwrite(PYRAMID_MAGIC, 1, sizeof(PYRAMID_MAGIC), fp);
+    fwrite(&level, sizeof(level), 1, fp);
+    fwrite(&record_size, sizeof(record_size), 1, fp);
+
+    p->files[idx] = fp;
+    return fp;
+}
+
+static void emit_bar(PricePyramid *p, int idx)
+{
+    FILE *fp = open_level(p, idx);
+    if (fp) fwrite(&p->pending[idx], sizeof(PyramidBar), 1, fp);
+}
+
+/* Fold bar 'src' into the bar under construction at level 'idx' */
+static void merge_into(PricePyramid *p, int idx, const PyramidBar *src)
+{
+    PyramidBar *dst = &p->pending[idx];
+
+    if (dst->count == 0) {
+        *dst = *src;
+    } else {
+        if (src->high > dst->high) dst->high = src->high;
+        if (src->low < dst->low) dst->low = src->low;
+        dst->close = src->close;
+        dst->volume += src->volume;
+        dst->count += src->count;
+    }
+
+    if (idx + 1 > p->levels_used) p->levels_used = idx + 1;
+}
+
+/* ----------------------------------------------------
+   Public API
+---------------------------------------------------- */
+
+int pyramid_open(PricePyramid *p, const char *base_path)
+{
+    memset(p, 0, sizeof(PricePyramid));
+
+    if (strlen(base_path) >= PYRAMID_PATH_MAX) {
+        fprintf(stderr, "pyramid: output path too long\n");
+        return -1;
+    }
+    strcpy(p->base_path, base_path);
+    return 0;
+}
+
+void pyramid_push(PricePyramid *p, uint64_t time, double price, double volume)
+{
+    /*
+     Binary-counter cascade:
+       - the step joins the base-level bar
+       - a completed bar is written and merged one level up
+       - the merge may complete that level too, and so on
+     Each step is therefore touched O(1) times amortized.
+    */
+
+    PyramidBar step = {
+        .start = time, .count = 1,
+        .open = price, .high = price, .low = price, .close = price,
+        .volume = volume
+    };
+
+    merge_into(p, 0, &step);
+
+    for (int idx = 0; idx < PYRAMID_MAX_LEVELS; idx++) {
+        PyramidBar *bar = &p->pending[idx];
+        uint64_t full = 1ULL << (PYRAMID_BASE_LEVEL + idx);
+
+        if (bar->count < full) break;
+
+        emit_bar(p, idx);
+        if (idx + 1 < PYRAMID_MAX_LEVELS) merge_into(p, idx + 1, bar);
+        bar->count = 0;
+    }
+}
+
+void pyramid_close(PricePyramid *p)
+{
+    /*
+     Partial bars are flushed bottom-up so each coarser level also
+     covers the tail of the run.
+    */
+
+    int used = p->levels_used;
+
+    for (int idx = 0; idx < used; idx++) {
+        PyramidBar *bar = &p->pending[idx];
+        if (bar->count == 0) continue;
+
+        emit_bar(p, idx);
+        if (idx + 1 < used) merge_into(p, idx + 1, bar);
+        bar->count = 0;
+    }
+
+    for (int idx = 0; idx < PYRAMID_MAX_LEVELS; idx++) {
+        if (p->files[idx]) fclose(p->files[idx]);
+        p->files[idx] = NULL;
+    }
+}
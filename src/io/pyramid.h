@@ -0,0 +1,77 @@
+#ifndef JUMPSIM_PYRAMID_H
+#define JUMPSIM_PYRAMID_H
+
+/*
+ * pyramid.h
+ * ---------
+ * Multi-resolution OHLC pyramid of the price path, built incrementally
+ * while the simulation runs.
+ *
+ * Level k summarizes blocks of 2^k consecutive steps as one bar
+ * (open, high, low, close, summed volume). Each level is written to its
+ * own file next to the main output:
+ *
+ *     <output>.L04.pyr, <output>.L05.pyr, ...
+ *
+ * A viewer picks the finest level whose bar count fits its pixel budget
+ * and reads only that file, so any zoom level over a 1e9-step path costs
+ * a few thousand records instead of the full CSV.
+ *
+ * Levels below PYRAMID_BASE_LEVEL are not stored (the full-resolution
+ * output already covers them). Cost per step is O(1) amortized: a bar is
+ * merged into the next level only when it completes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* -------------------- Constants -------------------- */
+
+#define PYRAMID_BASE_LEVEL 4   /* finest stored level: 16 steps per bar */
+#define PYRAMID_MAX_LEVELS 40  /* 2^(4+40) steps is far beyond any run */
+#define PYRAMID_PATH_MAX   512
+
+/* -------------------- Types -------------------- */
+
+/*
+ * On-disk bar record (little-endian, 56 bytes, no padding).
+ * 'count' is 2^level for complete bars; only the last bar of each level
+ * may be partial.
+ */
+typedef struct PyramidBar {
+    uint64_t start;   /* first step covered by the bar */
+    uint64_t count;   /* number of steps aggregated */
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;    /* sum of per-step absolute traded volume */
+} PyramidBar;
+
+typedef struct PricePyramid {
+    char base_path[PYRAMID_PATH_MAX];
+    FILE *files[PYRAMID_MAX_LEVELS];       /* opened lazily per level */
+    PyramidBar pending[PYRAMID_MAX_LEVELS]; /* bar under construction per level */
+    int levels_used;                        /* highest level touched + 1 */
+} PricePyramid;
+
+/* -------------------- API (implemented in pyramid.c) -------------------- */
+
+/*
+ * Prepare a pyramid whose level files are named after 'base_path'.
+ * No file is created until the first bar of a level completes.
+ * Returns 0 on success, -1 if the path is too long.
+ */
+int pyramid_open(PricePyramid *p, const char *base_path);
+
+/*
+ * Feed one simulation step. Steps must arrive in increasing order.
+ */
+void pyramid_push(PricePyramid *p, uint64_t time, double price, double volume);
+
+/*
+ * Flush the partial bar of every level and close all level files.
+ */
+void pyramid_close(PricePyramid *p);
+
+#endif /* JUMPSIM_PYRAMID_H */
@@ -0,0 +1,289 @@
+#include "record.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* ----------------------------------------------------
+   Log layout (text, one key per line)
+---------------------------------------------------- */
+
+/*
+   jumpsim-record 1
+   engine_version 0.7.0
+   master_seed <u64>
+   seed_source config|clock
+   seed_agents <hex>
+   seed_dynamics <hex>
+   config_hash <hex>
+   config_bytes <n>
+   <n raw bytes>
+   input <name> <hex>        (zero or more)
+   hash_interval <k>
+   state <step> <hex>        (every k steps)
+   final <step> <hex>
+*/
+
+/* ----------------------------------------------------
+   Recorder
+---------------------------------------------------- */
+
+int recorder_open(RunRecorder *r,
+                  const char *path,
+                  const Simulation *sim,
+                  const char *config_text,
+                  size_t config_len,
+                  bool seed_from_config,
+                  uint64_t hash_interval)
+{
+    memset(r, 0, sizeof(RunRecorder));
+
+    r->fp = fopen(path, "wb");
+    if (!r->fp) {
+        fprintf(stderr, "record: cannot open %s\n", path);
+        return -1;
+    }
+    r->hash_interval = hash_interval ? hash_interval : RECORD_DEFAULT_HASH_INTERVAL;
+
+    fprintf(r->fp, "jumpsim-record %d\n", RECORD_FORMAT_VERSION);
+    fprintf(r->fp, "engine_version %s\n", JUMPSIM_VERSION);
+    fprintf(r->fp, "master_seed %" PRIu64 "\n", sim->seeds.master);
+    fprintf(r->fp, "seed_source %s\n", seed_from_config ? "config" : "clock");
+    fprintf(r->fp, "seed_agents %016" PRIx64 "\n", sim->seeds.agents);
+    fprintf(r->fp, "seed_dynamics %016" PRIx64 "\n", sim->seeds.dynamics);
+    fprintf(r->fp, "config_hash %016" PRIx64 "\n",
+            hash_bytes(HASH_FNV_OFFSET, config_text, config_len));
+    fprintf(r->fp, "config_bytes %zu\n", config_len);
+    if (config_len > 0) fwrite(config_text, 1, config_len, r->fp);
+    fprintf(r->fp, "\n");
+
+    return 0;
+}
+
+void recorder_add_input(RunRecorder *r, const char *name, uint64_t content_hash)
+{
+    fprintf(r->fp, "input %s %016" PRIx64 "\n", name, content_hash);
+}
+
+/* Inputs may be added until the first step; then the header is closed */
+static void finish_header(RunRecorder *r)
+{
+    if (r->interval_written) return;
+    fprintf(r->fp, "hash_interval %" PRIu64 "\n", r->hash_interval);
+    r->interval_written = true;
+}
+
+void recorder_step(RunRecorder *r, const Simulation *sim)
+{
+    finish_header(r);
+
+    if (sim->step % r->hash_interval == 0) {
+        fprintf(r->fp, "state %" PRIu64 " %016" PRIx64 "\n",
+                sim->step, simulation_state_hash(sim));
+
+        /* Keep the log usable if the run crashes later */
+        fflush(r->fp);
+    }
+}
+
+void recorder_close(RunRecorder *r, const Simulation *sim)
+{
+    if (!r->fp) return;
+
+    finish_header(r);
+    fprintf(r->fp, "final %" PRIu64 " %016" PRIx64 "\n",
+            sim->step, simulation_state_hash(sim));
+
+    fclose(r->fp);
+    r->fp = NULL;
+}
+
+/* ----------------------------------------------------
+   Replayer
+---------------------------------------------------- */
+
+static int read_key(FILE *fp, const char *key, const char *fmt, void *out)
+{
+    char name[32];
+    if (fscanf(fp, "%31s", name) != 1 || strcmp(name, key) != 0) {
+        fprintf(stderr, "replay: expected '%s'\n", key);
+        return -1;
+    }
+    if (fscanf(fp, fmt, out) != 1) {
+        fprintf(stderr, "replay: malformed value for '%s'\n", key);
+        return -1;
+    }
+    return 0;
+}
+
+/* Advance to the next state/final line, skipping input records */
+static void read_next_checkpoint(RunReplay *rp)
+{
+    char kind[32];
+    rp->has_next = false;
+
+    while (fscanf(rp->fp, "%31s", kind) == 1) {
+        if (strcmp(kind, "input") == 0) {
+            char name[256];
+            uint64_t h;
+            if (fscanf(rp->fp, "%255s %" SCNx64, name, &h) != 2) return;
+            continue;
+        }
+
+        if (strcmp(kind, "state") != 0 && strcmp(kind, "final") != 0) return;
+
+        if (fscanf(rp->fp, "%" SCNu64 " %" SCNx64, &rp->next_step, &rp->next_hash) != 2) return;
+        rp->next_is_final = (kind[0] == 'f');
+        rp->has_next = true;
+        return;
+    }
+}
+
+int replay_open(RunReplay *rp, const char *path)
+{
+    memset(rp, 0, sizeof(RunReplay));
+
+    rp->fp = fopen(path, "rb");
+    if (!rp->fp) {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return -1;
+    }
+
+    int format = 0;
+    char source[16];
+    int rc = 0;
+
+    rc |= read_key(rp->fp, "jumpsim-record", "%d", &format);
+    rc |= read_key(rp->fp, "engine_version", "%31s", rp->engine_version);
+    rc |= read_key(rp->fp, "master_seed", "%" SCNu64, &rp->seeds.master);
+    rc |= read_key(rp->fp, "seed_source", "%15s", source);
+    rc |= read_key(rp->fp, "seed_agents", "%" SCNx64, &rp->seeds.agents);
+    rc |= read_key(rp->fp, "seed_dynamics", "%" SCNx64, &rp->seeds.dynamics);
+    rc |= read_key(rp->fp, "config_hash", "%" SCNx64, &rp->config_hash);
+    rc |= read_key(rp->fp, "config_bytes", "%zu", &rp->config_len);
+
+    if (rc != 0 || format != RECORD_FORMAT_VERSION) {
+        fprintf(stderr, "replay: %s is not a supported record log\n", path);
+        replay_close(rp);
+        return -1;
+    }
+
+    /* Exactly one newline separates the length from the raw bytes */
+    fgetc(rp->fp);
+    rp->config_text = malloc(rp->config_len + 1);
+    if (fread(rp->config_text, 1, rp->config_len, rp->fp) != rp->config_len) {
+        fprintf(stderr, "replay: truncated config block\n");
+        replay_close(rp);
+        return -1;
+    }
+    rp->config_text[rp->config_len] = '\0';
+
+    if (hash_bytes(HASH_FNV_OFFSET, rp->config_text, rp->config_len) != rp->config_hash) {
+        fprintf(stderr, "replay: config block does not match its hash\n");
+        replay_close(rp);
+        return -1;
+    }
+
+    /* Inputs may precede the interval line */
+    char kind[32];
+    while (fscanf(rp->fp, "%31s", kind) == 1 && strcmp(kind, "input") == 0) {
+        char name[256];
+        uint64_t h;
+        if (fscanf(rp->fp, "%255s %" SCNx64, name, &h) != 2) break;
+        if (rp->n_inputs == RECORD_MAX_INPUTS || strlen(name) >= sizeof(rp->inputs[0].name)) {
+            fprintf(stderr, "replay: too many or overlong input records\n");
+            replay_close(rp);
+            return -1;
+        }
+        RecordInput *in = &rp->inputs[rp->n_inputs++];
+        strcpy(in->name, name);
+        in->hash = h;
+    }
+    if (strcmp(kind, "hash_interval") != 0 ||
+        fscanf(rp->fp, "%" SCNu64, &rp->hash_interval) != 1) {
+        fprintf(stderr, "replay: missing hash_interval\n");
+        replay_close(rp);
+        return -1;
+    }
+
+    if (strcmp(rp->engine_version, JUMPSIM_VERSION) != 0) {
+        fprintf(stderr, "replay: warning: recorded with engine %s, replaying with %s\n",
+                rp->engine_version, JUMPSIM_VERSION);
+    }
+
+    read_next_checkpoint(rp);
+    return 0;
+}
+
+static int check_input(const RunReplay *rp, const char *name, uint64_t hash, bool *seen)
+{
+    for (int i = 0; i < rp->n_inputs; i++) {
+        if (strcmp(rp->inputs[i].name, name) != 0) continue;
+        seen[i] = true;
+        if (rp->inputs[i].hash == hash) return 0;
+        fprintf(stderr, "replay: input '%s' differs from the recording "
+                        "(hash %016" PRIx64 ", recorded %016" PRIx64 ")\n",
+                name, hash, rp->inputs[i].hash);
+        return -1;
+    }
+    fprintf(stderr, "replay: input '%s' was not part of the recording\n", name);
+    return -1;
+}
+
+int replay_check_inputs(const RunReplay *rp, const Simulation *sim)
+{
+    bool seen[RECORD_MAX_INPUTS] = { false };
+    int rc = 0;
+
+    /* The same inputs main() records */
+    if (sim->popfile.base) rc |= check_input(rp, "population", popfile_hash(&sim->popfile), seen);
+    if (sim->cfg.network.kind == NETWORK_FILE) {
+        rc |= check_input(rp, "network", sim->graphfile.content_hash, seen);
+    }
+
+    for (int i = 0; i < rp->n_inputs; i++) {
+        if (seen[i]) continue;
+        fprintf(stderr, "replay: recorded input '%s' is missing\n", rp->inputs[i].name);
+        rc = -1;
+    }
+    return rc;
+}
+
+int replay_check(RunReplay *rp, const Simulation *sim)
+{
+    if (rp->diverged) return -1;
+
+    /* The last interval hash and the final hash may share a step */
+    while (rp->has_next && sim->step == rp->next_step) {
+
+        uint64_t h = simulation_state_hash(sim);
+        if (h != rp->next_hash) {
+            rp->diverged = true;
+            rp->diverged_step = sim->step;
+            return -1;
+        }
+
+        rp->last_verified_step = sim->step;
+        if (rp->next_is_final) {
+            rp->has_next = false;
+            return 0;
+        }
+
+        read_next_checkpoint(rp);
+    }
+
+    return 0;
+}
+
+bool replay_done(const RunReplay *rp)
+{
+    return !rp->diverged && !rp->has_next && rp->next_is_final;
+}
+
+void replay_close(RunReplay *rp)
+{
+    if (rp->fp) fclose(rp->fp);
+    free(rp->config_text);
+    rp->fp = NULL;
+    rp->config_text = NULL;
+}
@@ -0,0 +1,126 @@
+#ifndef JUMPSIM_RECORD_H
+#define JUMPSIM_RECORD_H
+
+/*
+ * record.h
+ * --------
+ * Deterministic record-and-replay of complete runs.
+ *
+ * Record mode writes a small text log holding everything a run depends on:
+ *  - engine version and master seed (and whether it came from the config
+ *    or the clock), plus the derived sub-stream seeds
+ *  - the exact config bytes and their hash
+ *  - hashes of any other external inputs
+ *  - a full-state hash every 'hash_interval' steps and at the end
+ *
+ * Replay mode rebuilds the simulation from the log alone, runs it with the
+ * same step function (no extra per-step work besides the periodic hash)
+ * and stops at the first checked step whose state hash differs. With
+ * hash_interval = 1 that is exactly the first differing step.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "simulation.h"
+
+/* -------------------- Constants -------------------- */
+
+#define RECORD_FORMAT_VERSION 1
+#define RECORD_DEFAULT_HASH_INTERVAL 1000
+#define RECORD_MAX_INPUTS 8
+
+/* -------------------- Recorder -------------------- */
+
+typedef struct RunRecorder {
+    FILE *fp;
+    uint64_t hash_interval;
+    bool interval_written;    /* header ends with the interval line */
+} RunRecorder;
+
+/*
+ * Create the log and write the run header.
+ *  - config_text/config_len: exact bytes the config was parsed from
+ *    (len 0 for the built-in defaults)
+ *  - seed_from_config: false if the master seed came from the clock
+ * Returns 0 on success, -1 on failure.
+ */
+int recorder_open(RunRecorder *r,
+                  const char *path,
+                  const Simulation *sim,
+                  const char *config_text,
+                  size_t config_len,
+                  bool seed_from_config,
+                  uint64_t hash_interval);
+
+/* Record the hash of an additional external input (file, dataset, ...) */
+void recorder_add_input(RunRecorder *r, const char *name, uint64_t content_hash);
+
+/*
+ * Call after simulation_step(); hashes state on interval steps.
+ * Steps that are not multiples of the interval may be skipped.
+ */
+void recorder_step(RunRecorder *r, const Simulation *sim);
+
+/* Write the final state hash and close the log */
+void recorder_close(RunRecorder *r, const Simulation *sim);
+
+/* -------------------- Replayer -------------------- */
+
+typedef struct RecordInput {
+    char name[64];
+    uint64_t hash;
+} RecordInput;
+
+typedef struct RunReplay {
+    FILE *fp;
+
+    /* Header */
+    char engine_version[32];
+    SimSeeds seeds;
+    uint64_t config_hash;
+    char *config_text;        /* owned, NUL-terminated */
+    size_t config_len;
+    uint64_t hash_interval;
+    RecordInput inputs[RECORD_MAX_INPUTS];
+    int n_inputs;
+
+    /* Next expected checkpoint */
+    bool has_next;
+    bool next_is_final;
+    uint64_t next_step;
+    uint64_t next_hash;
+
+    /* Verification result */
+    uint64_t last_verified_step;
+    bool diverged;
+    uint64_t diverged_step;
+} RunReplay;
+
+/*
+ * Open a log written by the recorder and read its header.
+ * Returns 0 on success, -1 on malformed or unreadable logs.
+ */
+int replay_open(RunReplay *rp, const char *path);
+
+/*
+ * Compare the external inputs 'sim' was built from (population file,
+ * network edge list) with the recorded hashes, before the first step.
+ * Returns 0 if they match, -1 (naming the input) otherwise.
+ */
+int replay_check_inputs(const RunReplay *rp, const Simulation *sim);
+
+/*
+ * Check the simulation against the log after a step.
+ * Returns 0 while consistent, -1 at the first mismatch.
+ */
+int replay_check(RunReplay *rp, const Simulation *sim);
+
+/* True once the recorded final step has been verified */
+bool replay_done(const RunReplay *rp);
+
+void replay_close(RunReplay *rp);
+
+#endif /* JUMPSIM_RECORD_H */
@@ -0,0 +1,95 @@
+#include "regime.h"
+#include <string.h>
+
+static const char *const DETECTOR_NAMES[REGIME_DETECTORS] = { "cusum", "bocpd" };
+
+const char *regime_detector_name(int detector)
+{
+    return DETECTOR_NAMES[detector];
+}
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+int regime_open(RegimeLog *g, const ChangepointConfig *cfg)
+{
+    memset(g, 0, sizeof(RegimeLog));
+    g->cfg = *cfg;
+    g->regime = -2;
+    for (int d = 0; d < REGIME_DETECTORS; d++) g->score[d].pending = UINT64_MAX;
+
+    cusum_init(&g->cusum, cfg->cusum_drift, cfg->cusum_threshold, cfg->cusum_decay);
+    if (bocpd_init(&g->bocpd, cfg->bocpd_hazard, (size_t)cfg->bocpd_max_run,
+                   cfg->bocpd_threshold, (size_t)cfg->bocpd_window) != 0) {
+        fprintf(stderr, "changepoint: cannot set up a posterior of %u runs\n", cfg->bocpd_max_run);
+        memset(g, 0, sizeof(RegimeLog));
+        return -1;
+    }
+
+    g->fp = writer_fopen(cfg->path);
+    if (!g->fp) {
+        bocpd_free(&g->bocpd);
+        memset(g, 0, sizeof(RegimeLog));
+        return -1;
+    }
+    fprintf(g->fp, "step,event,detector,regime,delay\n");
+    return 0;
+}
+
+int regime_close(RegimeLog *g)
+{
+    if (!g->fp) return 0;
+
+    int rc = (fclose(g->fp) == 0 && !g->failed) ? 0 : -1;
+    if (rc != 0) fprintf(stderr, "changepoint: write failed, %s is incomplete\n", g->cfg.path);
+
+    bocpd_free(&g->bocpd);
+    g->fp = NULL;
+    return rc;
+}
+
+/* ----------------------------------------------------
+   Steps
+---------------------------------------------------- */
+
+static void alarm(RegimeLog *g, int detector, const char *name, uint64_t step)
+{
+    RegimeScore *s = &g->score[detector];
+    s->alarms++;
+
+    int n;
+    if (s->pending != UINT64_MAX) {
+        uint64_t delay = step - s->pending;
+        s->detected++;
+        s->delay_sum += delay;
+        s->pending = UINT64_MAX;
+        n = fprintf(g->fp, "%llu,alarm,%s,%d,%llu\n", (unsigned long long)step, name,
+                    g->regime, (unsigned long long)delay);
+    }
+    else {
+        if (g->regime >= 0) s->false_alarms++;
+        n = fprintf(g->fp, "%llu,alarm,%s,%d,\n", (unsigned long long)step, name, g->regime);
+    }
+    if (n < 0) g->failed = true;
+}
+
+void regime_step(RegimeLog *g, uint64_t step, double log_return, int regime)
+{
+    /* The first regime is where the run starts, not a switch */
+    if (g->regime != -2 && regime != g->regime && regime >= 0) {
+        g->switches++;
+        for (int d = 0; d < REGIME_DETECTORS; d++) {
+            if (g->score[d].pending != UINT64_MAX) g->score[d].missed++;
+            g->score[d].pending = step;
+        }
+        if (fprintf(g->fp, "%llu,switch,,%d,\n", (unsigned long long)step, regime) < 0) {
+            g->failed = true;
+        }
+    }
+    g->regime = regime;
+
+    int c = cusum_update(&g->cusum, log_return);
+    if (c != 0) alarm(g, REGIME_CUSUM, c > 0 ? "cusum_up" : "cusum_down", step);
+    if (bocpd_update(&g->bocpd, log_return)) alarm(g, REGIME_BOCPD, "bocpd", step);
+}
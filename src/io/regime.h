@@ -0,0 +1,81 @@
+#ifndef JUMPSIM_REGIME_H
+#define JUMPSIM_REGIME_H
+
+/*
+ * regime.h
+ * --------
+ * Online regime detection on the return stream ("output.changepoint").
+ *
+ * Every step the log return goes to two detectors (changepoint.h): a
+ * CUSUM on the return level and a Bayesian online change-point detector
+ * with a bounded run-length posterior. Both cost a bounded amount of work
+ * per step, so every replica of an ensemble can run its own.
+ *
+ * The hidden truth is the news regime (news.h): the market counts as
+ * stressed while any targeted news process is. Each switch opens a
+ * pending detection for each detector; the detector's next alarm closes
+ * it with a delay in steps, and a switch that arrives first counts the
+ * pending one as missed. Alarms with nothing pending are false alarms.
+ * Without news targets the regime is unknown (-1): alarms are logged,
+ * but there is nothing to score them against.
+ *
+ * The log is a CSV of events, one row each:
+ *   step,event,detector,regime,delay
+ *   - "switch": the regime changed to 'regime' at 'step'
+ *   - "alarm":  'detector' (cusum_up, cusum_down or bocpd) fired;
+ *               'delay' since the switch it detects, empty if none
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "writer.h"
+#include "changepoint.h"
+
+/* -------------------- Types -------------------- */
+
+enum { REGIME_CUSUM, REGIME_BOCPD, REGIME_DETECTORS };
+
+/* Scores of one detector against the regime switches */
+typedef struct RegimeScore {
+    uint64_t alarms;
+    uint64_t detected;        /* switches followed by an alarm before the next switch */
+    uint64_t missed;
+    uint64_t false_alarms;
+    uint64_t delay_sum;       /* over 'detected' */
+    uint64_t pending;         /* step of the undetected switch, or UINT64_MAX */
+} RegimeScore;
+
+typedef struct RegimeLog {
+    FILE *fp;
+    ChangepointConfig cfg;
+    Cusum cusum;
+    Bocpd bocpd;
+    int regime;               /* last regime seen; -2 before the first step */
+    uint64_t switches;
+    RegimeScore score[REGIME_DETECTORS];
+    bool failed;
+} RegimeLog;
+
+/* -------------------- API (implemented in regime.c) -------------------- */
+
+/* Set up the detectors, create cfg->path and write the header. Returns 0 / -1. */
+int regime_open(RegimeLog *g, const ChangepointConfig *cfg);
+
+/*
+ * Feed the log return of step 'step' and the regime during that step
+ * (0 calm, 1 stress, -1 unknown).
+ */
+void regime_step(RegimeLog *g, uint64_t step, double log_return, int regime);
+
+/*
+ * Close the log. A switch still pending at the end is neither detected
+ * nor missed. Returns 0 / -1 (write error).
+ */
+int regime_close(RegimeLog *g);
+
+/* Detector name for reports */
+const char *regime_detector_name(int detector);
+
+#endif /* JUMPSIM_REGIME_H */
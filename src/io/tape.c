@@ -0,0 +1,283 @@
+#include "tape.h"
+#include "writer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ----------------------------------------------------
+   Writer thread
+---------------------------------------------------- */
+
+static void *tape_writer(void *arg)
+{
+    ExecTape *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        while (!t->queued && !t->closing) pthread_cond_wait(&t->cond, &t->lock);
+        if (!t->queued) break;
+
+        /* 'out' is the thread's until 'queued' drops */
+        pthread_mutex_unlock(&t->lock);
+        bool ok = fwrite(t->out, 1, t->out_len, t->fp) == t->out_len;
+        pthread_mutex_lock(&t->lock);
+
+        if (!ok) t->failed = true;
+        t->queued = false;
+        pthread_cond_broadcast(&t->cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+/* Hand the filled buffer to the thread (waiting for the previous one) */
+static void hand_off(ExecTape *t)
+{
+    if (t->fill_len == 0) return;
+
+    pthread_mutex_lock(&t->lock);
+    while (t->queued) pthread_cond_wait(&t->cond, &t->lock);
+
+    unsigned char *buf = t->out;
+    size_t cap = t->out_cap;
+    t->out = t->fill;
+    t->out_cap = t->fill_cap;
+    t->out_len = t->fill_len;
+    t->fill = buf;
+    t->fill_cap = cap;
+    t->fill_len = 0;
+    t->queued = true;
+
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+int tape_open(ExecTape *t, const char *path, size_t n_agents, size_t block,
+              const uint32_t *order)
+{
+    memset(t, 0, sizeof(ExecTape));
+
+    t->n_blocks = (n_agents + block - 1) / block;
+    t->blocks = calloc(t->n_blocks ? t->n_blocks : 1, sizeof(TapeBlock));
+    t->block_mem = malloc((t->n_blocks ? t->n_blocks : 1) * block * TAPE_ENTRY_MAX);
+    t->fill_cap = t->out_cap = TAPE_CHUNK;
+    t->fill = malloc(t->fill_cap);
+    t->out = malloc(t->out_cap);
+    if (!t->blocks || !t->block_mem || !t->fill || !t->out) goto fail;
+
+    for (size_t b = 0; b < t->n_blocks; b++) {
+        t->blocks[b].buf = t->block_mem + b * block * TAPE_ENTRY_MAX;
+    }
+
+    t->fp = writer_fopen(path);
+    if (!t->fp) goto fail;
+
+    uint64_t n = n_agents;
+    uint32_t flags = order ? TAPE_REORDERED : 0, reserved = 0;
+    fwrite(TAPE_MAGIC, 1, 8, t->fp);
+    fwrite(&n, sizeof(n), 1, t->fp);
+    fwrite(&flags, sizeof(flags), 1, t->fp);
+    fwrite(&reserved, sizeof(reserved), 1, t->fp);
+    if (order) fwrite(order, sizeof(uint32_t), n_agents, t->fp);
+
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    if (pthread_create(&t->thread, NULL, tape_writer, t) != 0) {
+        pthread_mutex_destroy(&t->lock);
+        pthread_cond_destroy(&t->cond);
+        fclose(t->fp);
+        t->fp = NULL;
+        goto fail;
+    }
+    return 0;
+
+fail:
+    fprintf(stderr, "tape: cannot open %s\n", path);
+    free(t->blocks);
+    free(t->block_mem);
+    free(t->fill);
+    free(t->out);
+    memset(t, 0, sizeof(ExecTape));
+    return -1;
+}
+
+int tape_close(ExecTape *t)
+{
+    if (!t->fp) return 0;
+
+    hand_off(t);
+
+    pthread_mutex_lock(&t->lock);
+    t->closing = true;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->cond);
+
+    int rc = (fclose(t->fp) == 0 && !t->failed) ? 0 : -1;
+    if (rc != 0) fprintf(stderr, "tape: write failed, the tape is incomplete\n");
+
+    free(t->blocks);
+    free(t->block_mem);
+    free(t->fill);
+    free(t->out);
+    t->fp = NULL;
+    return rc;
+}
+
+/* ----------------------------------------------------
+   Steps
+---------------------------------------------------- */
+
+void tape_end_step(ExecTape *t, uint64_t step, double price)
+{
+    size_t count = 0, body = 0;
+    for (size_t b = 0; b < t->n_blocks; b++) {
+        count += t->blocks[b].count;
+        body += t->blocks[b].len;
+    }
+    if (count == 0) return;
+
+    /* Header, block bodies and every block's first execution */
+    size_t need = 3 * VARINT_MAX_BYTES + sizeof(double) + body + t->n_blocks * TAPE_ENTRY_MAX;
+    if (t->fill_len + need > t->fill_cap) {
+        size_t cap = t->fill_cap;
+        while (t->fill_len + need > cap) cap *= 2;
+        unsigned char *grown = realloc(t->fill, cap);
+        if (!grown) {
+            /* The step is lost; tape_close reports the incomplete tape */
+            t->failed = true;
+            for (size_t b = 0; b < t->n_blocks; b++) {
+                t->blocks[b].count = 0;
+                t->blocks[b].len = 0;
+            }
+            return;
+        }
+        t->fill = grown;
+        t->fill_cap = cap;
+    }
+
+    unsigned char *o = t->fill + t->fill_len;
+    o += varint_put(o, step - t->last_step);
+    memcpy(o, &price, sizeof(double));
+    o += sizeof(double);
+    o += varint_put(o, count);
+
+    /* Blocks in order; only each block's first gap spans blocks */
+    uint32_t prev = UINT32_MAX;
+    for (size_t b = 0; b < t->n_blocks; b++) {
+        TapeBlock *blk = &t->blocks[b];
+        if (blk->count == 0) continue;
+
+        o += varint_put(o, blk->first - prev - 1);
+        o += varint_put(o, zigzag_encode(blk->first_qty));
+        memcpy(o, blk->buf, blk->len);
+        o += blk->len;
+        prev = blk->last;
+
+        blk->count = 0;
+        blk->len = 0;
+    }
+
+    size_t len = (size_t)(o - (t->fill + t->fill_len));
+    t->fill_len += len;
+    t->bytes += len;
+    t->executions += count;
+    t->last_step = step;
+
+    if (t->fill_len >= TAPE_CHUNK) hand_off(t);
+}
+
+/* ----------------------------------------------------
+   Decoding
+---------------------------------------------------- */
+
+int tape_to_csv(const char *tape_path, const char *csv_path)
+{
+    FILE *in = fopen(tape_path, "rb");
+    if (!in) {
+        fprintf(stderr, "tape: cannot open %s\n", tape_path);
+        return -1;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    unsigned char *data = malloc(size > 0 ? (size_t)size : 1);
+    size_t len = data ? fread(data, 1, (size_t)size, in) : 0;
+    fclose(in);
+
+    const unsigned char *p = data, *end = data + len;
+    uint64_t n = 0;
+    uint32_t flags = 0;
+    if (!data || len < 24 || memcmp(p, TAPE_MAGIC, 8) != 0) {
+        fprintf(stderr, "tape: %s is not an execution tape\n", tape_path);
+        free(data);
+        return -1;
+    }
+    memcpy(&n, p + 8, sizeof(n));
+    memcpy(&flags, p + 16, sizeof(flags));
+    p += 24;
+
+    const uint32_t *order = NULL;
+    uint32_t *order_copy = NULL;
+    if (flags & TAPE_REORDERED) {
+        if ((size_t)(end - p) / sizeof(uint32_t) < n || !(order_copy = malloc(n * sizeof(uint32_t)))) {
+            fprintf(stderr, "tape: %s is truncated\n", tape_path);
+            free(data);
+            return -1;
+        }
+        memcpy(order_copy, p, n * sizeof(uint32_t));
+        order = order_copy;
+        p += n * sizeof(uint32_t);
+    }
+
+    FILE *out = writer_fopen(csv_path);
+    if (!out) {
+        free(order_copy);
+        free(data);
+        return -1;
+    }
+    fprintf(out, "step,agent,quantity,price\n");
+
+    uint64_t step = 0;
+    int rc = 0;
+    while (p < end && rc == 0) {
+        uint64_t delta, count, gap, zz;
+        double price;
+        size_t k;
+
+        if (!(k = varint_get(p, end, &delta)) || (size_t)(end - (p + k)) < sizeof(double)) { rc = -1; break; }
+        p += k;
+        memcpy(&price, p, sizeof(double));
+        p += sizeof(double);
+        if (!(k = varint_get(p, end, &count))) { rc = -1; break; }
+        p += k;
+        step += delta;
+
+        uint32_t agent = UINT32_MAX;
+        for (uint64_t e = 0; e < count; e++) {
+            if (!(k = varint_get(p, end, &gap))) { rc = -1; break; }
+            p += k;
+            if (!(k = varint_get(p, end, &zz))) { rc = -1; break; }
+            p += k;
+
+            agent += (uint32_t)gap + 1;
+            if (agent >= n) { rc = -1; break; }
+            fprintf(out, "%llu,%u,%lld,%.6f\n", (unsigned long long)step,
+                    order ? order[agent] : agent, (long long)zigzag_decode(zz), price);
+        }
+    }
+    if (rc != 0) fprintf(stderr, "tape: %s is corrupt or truncated\n", tape_path);
+
+    fclose(out);
+    free(order_copy);
+    free(data);
+    return rc;
+}
@@ -0,0 +1,122 @@
+#ifndef JUMPSIM_TAPE_H
+#define JUMPSIM_TAPE_H
+
+/*
+ * tape.h
+ * ------
+ * Execution tape: who traded what, every step ("output.tape").
+ *
+ * The fused demand pass (kernels.h) hands every nonzero execution to the
+ * tape as it happens, into a staging area per reduction block, so the
+ * blocks encode in parallel and no extra pass over the agents is needed.
+ * At the end of the step the blocks are stitched together in block order
+ * and the step is queued for a writer thread; the time loop never waits
+ * on the disk unless the thread falls a whole chunk behind.
+ *
+ * Layout (little-endian):
+ *   header   magic "JSTAP001", uint64 n_agents, uint32 flags, uint32 reserved
+ *   order    n_agents x uint32 original ids, if flags & TAPE_REORDERED
+ *            (executions name agent indices; order[i] is i's original id)
+ *   steps    one record per step with executions:
+ *              varint  step - previous recorded step (the first: step)
+ *              f64     fill price (all executions of a step share it)
+ *              varint  number of executions
+ *              per execution, in agent order:
+ *                varint  agent - previous agent - 1 (the first: agent)
+ *                varint  zigzag(signed quantity)
+ *
+ * When most agents trade, agent gaps are 0 and quantities small, so an
+ * execution takes about two bytes. tape_to_csv() decodes a tape.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "varint.h"
+
+/* -------------------- Constants -------------------- */
+
+#define TAPE_MAGIC "JSTAP001"
+#define TAPE_REORDERED 1u
+
+/* Largest encoded execution: 32-bit gap and zigzag quantity */
+#define TAPE_ENTRY_MAX 10
+
+/* Bytes collected before a write is handed to the writer thread */
+#define TAPE_CHUNK (1u << 22)
+
+/* -------------------- Types -------------------- */
+
+/*
+ One block's executions this step: the first is kept raw (its gap
+ depends on the previous block), the rest encoded in 'buf'.
+*/
+typedef struct TapeBlock {
+    unsigned char *buf;
+    size_t len;
+    uint32_t count;
+    uint32_t first, last;      /* agent indices */
+    int32_t first_qty;
+} TapeBlock;
+
+typedef struct ExecTape {
+    FILE *fp;
+    TapeBlock *blocks;
+    size_t n_blocks;
+    unsigned char *block_mem;
+
+    /* Double buffer: the time loop fills one, the writer thread drains the other */
+    unsigned char *fill, *out;
+    size_t fill_len, fill_cap;
+    size_t out_len, out_cap;
+    bool queued;               /* 'out' holds bytes not yet written */
+    bool closing;
+    bool failed;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    uint64_t last_step;        /* step of the previous record */
+    uint64_t executions;
+    uint64_t bytes;
+} ExecTape;
+
+/* -------------------- API (implemented in tape.c) -------------------- */
+
+/*
+ * Create the tape at 'path' for 'n_agents' agents whose demand pass runs
+ * in blocks of 'block' agents; 'order' maps indices to original ids
+ * (NULL if not reordered). Starts the writer thread. Returns 0 / -1.
+ */
+int tape_open(ExecTape *t, const char *path, size_t n_agents, size_t block,
+              const uint32_t *order);
+
+/* Record an execution of 'qty' (nonzero) by agent 'id' in its block; ids ascend */
+static inline void tape_put(TapeBlock *b, uint32_t id, int32_t qty) {
+    if (b->count++ == 0) {
+        b->first = id;
+        b->first_qty = qty;
+    }
+    else {
+        b->len += varint_put(b->buf + b->len, id - b->last - 1);
+        b->len += varint_put(b->buf + b->len, zigzag_encode(qty));
+    }
+    b->last = id;
+}
+
+/*
+ * Close step 'step' (executions filled at 'price'): stitch the blocks
+ * into one record and queue it. Write errors are reported by tape_close.
+ */
+void tape_end_step(ExecTape *t, uint64_t step, double price);
+
+/* Write what is left, stop the writer thread and close. Returns 0 / -1 */
+int tape_close(ExecTape *t);
+
+/* Decode a tape into CSV rows step,agent,quantity,price (original ids). Returns 0 / -1 */
+int tape_to_csv(const char *tape_path, const char *csv_path);
+
+#endif /* JUMPSIM_TAPE_H */
@@ -0,0 +1,394 @@
+#include "trajectory.h"
+#include "agent.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------- Internal RNG ---------------- */
+
+static inline uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/* Uniform in [0, bound) (bound < 2^32) */
+static inline uint64_t uniform_below(uint64_t *state, uint64_t bound) {
+    return ((xorshift64(state) >> 32) * bound) >> 32;
+}
+
+/* ----------------------------------------------------
+   Sampling
+---------------------------------------------------- */
+
+/*
+ Reservoir sampling per type (algorithm R) over original ids: one pass,
+ 'per_type' ids kept for each type, each agent of a type equally likely.
+*/
+static int draw_sample(TrajectoryLog *t, const AgentParams *params,
+                       const uint32_t *order_inverse, uint64_t seed)
+{
+    uint32_t k = t->cfg.per_type;
+    uint32_t *res = malloc(((size_t)k * AGENT_TYPE_COUNT + 1) * sizeof(uint32_t));
+    if (!res) return -1;
+
+    uint64_t seen[AGENT_TYPE_COUNT] = { 0 };
+    uint64_t rng = seed ? seed : 88172645463325252ULL;
+
+    for (size_t id = 0; id < params->n; id++) {
+        size_t i = order_inverse ? order_inverse[id] : id;
+        int type = params->type[i];
+        if (type < 0 || type >= AGENT_TYPE_COUNT) continue;
+
+        uint64_t c = seen[type]++;
+        uint64_t j = c < k ? c : uniform_below(&rng, c + 1);
+        if (j < k) res[(size_t)type * k + j] = (uint32_t)id;
+    }
+
+    /* Slots by type, then original id; stored as indices */
+    t->sample = malloc(((size_t)k * AGENT_TYPE_COUNT + 1) * sizeof(uint32_t));
+    if (!t->sample) {
+        free(res);
+        return -1;
+    }
+    for (int type = 0; type < AGENT_TYPE_COUNT; type++) {
+        uint32_t m = seen[type] < k ? (uint32_t)seen[type] : k;
+        uint32_t *ids = res + (size_t)type * k;
+
+        for (uint32_t a = 1; a < m; a++) {
+            uint32_t v = ids[a], b = a;
+            for (; b > 0 && ids[b - 1] > v; b--) ids[b] = ids[b - 1];
+            ids[b] = v;
+        }
+        for (uint32_t a = 0; a < m; a++) {
+            t->sample[t->n_sampled++] = order_inverse ? order_inverse[ids[a]] : ids[a];
+        }
+    }
+    free(res);
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Largest holders
+---------------------------------------------------- */
+
+static inline bool ranks_below(TrajHolder a, TrajHolder b) {
+    return a.size < b.size || (a.size == b.size && a.agent > b.agent);
+}
+
+/* Min-heap on rank: the root is the weakest candidate kept */
+static void sift_down(TrajHolder *h, uint32_t n, uint32_t i) {
+    for (;;) {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && ranks_below(h[l], h[m])) m = l;
+        if (r < n && ranks_below(h[r], h[m])) m = r;
+        if (m == i) return;
+        TrajHolder tmp = h[i];
+        h[i] = h[m];
+        h[m] = tmp;
+        i = m;
+    }
+}
+
+static void offer(TrajHolder *h, uint32_t *n, uint32_t cap, TrajHolder c) {
+    if (*n < cap) {
+        uint32_t i = (*n)++;
+        h[i] = c;
+        while (i > 0 && ranks_below(h[i], h[(i - 1) / 2])) {
+            TrajHolder tmp = h[i];
+            h[i] = h[(i - 1) / 2];
+            h[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
+        }
+    }
+    else if (ranks_below(h[0], c)) {
+        h[0] = c;
+        sift_down(h, *n, 0);
+    }
+}
+
+/*
+ Top n_largest by |position| into slot_agent[n_sampled ..], best first.
+ Chunks keep their own heaps; merging them in chunk order keeps the
+ result independent of the thread count (the ranking is a total order).
+*/
+static void find_holders(TrajectoryLog *t, const AgentState *state)
+{
+    uint32_t cap = t->n_largest;
+    size_t n = state->n;
+
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < TRAJ_CHUNKS; c++) {
+        TrajHolder *h = t->candidates + (size_t)c * cap;
+        uint32_t m = 0;
+        size_t first = n * (size_t)c / TRAJ_CHUNKS, end = n * (size_t)(c + 1) / TRAJ_CHUNKS;
+
+        for (size_t i = first; i < end; i++) {
+            int64_t p = state->position[i];
+            TrajHolder cand = { p < 0 ? -p : p, (uint32_t)i };
+            if (m < cap || ranks_below(h[0], cand)) offer(h, &m, cap, cand);
+        }
+        t->n_candidates[c] = m;
+    }
+
+    TrajHolder *best = t->candidates;
+    uint32_t m = t->n_candidates[0];
+    for (int c = 1; c < TRAJ_CHUNKS; c++) {
+        const TrajHolder *h = t->candidates + (size_t)c * cap;
+        for (uint32_t a = 0; a < t->n_candidates[c]; a++) offer(best, &m, cap, h[a]);
+    }
+
+    /* Heap order -> rank order: pop the weakest to the back */
+    for (uint32_t a = m; a > 0; a--) {
+        t->slot_agent[t->n_sampled + a - 1] = best[0].agent;
+        best[0] = best[a - 1];
+        sift_down(best, a - 1, 0);
+    }
+}
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+static void traj_free(TrajectoryLog *t)
+{
+    free(t->sample);
+    free(t->candidates);
+    free(t->n_candidates);
+    free(t->slot_agent);
+    free(t->steps);
+    free(t->holder_id);
+    free(t->holder_type);
+    free(t->belief);
+    free(t->position);
+    free(t->cash);
+}
+
+int traj_open(TrajectoryLog *t, const TrajectoryConfig *cfg, const AgentParams *params,
+              const uint32_t *order, const uint32_t *order_inverse, uint64_t seed)
+{
+    memset(t, 0, sizeof(TrajectoryLog));
+    t->cfg = *cfg;
+    t->order = order;
+
+    if (draw_sample(t, params, order_inverse, seed) != 0) goto fail;
+    t->n_largest = cfg->largest < params->n ? cfg->largest : (uint32_t)params->n;
+    t->n_slots = t->n_sampled + t->n_largest;
+
+    size_t slots = (size_t)t->n_slots + 1, holders = (size_t)t->n_largest + 1;
+    t->candidates = malloc(TRAJ_CHUNKS * holders * sizeof(TrajHolder));
+    t->n_candidates = calloc(TRAJ_CHUNKS, sizeof(uint32_t));
+    t->slot_agent = malloc(slots * sizeof(uint32_t));
+    t->steps = malloc(TRAJ_GROUP * sizeof(uint64_t));
+    t->holder_id = malloc(holders * TRAJ_GROUP * sizeof(uint32_t));
+    t->holder_type = malloc(holders * TRAJ_GROUP);
+    t->belief = malloc(slots * TRAJ_GROUP * sizeof(double));
+    t->position = malloc(slots * TRAJ_GROUP * sizeof(int32_t));
+    t->cash = malloc(slots * TRAJ_GROUP * sizeof(double));
+    if (!t->candidates || !t->n_candidates || !t->slot_agent || !t->steps || !t->holder_id ||
+        !t->holder_type || !t->belief || !t->position || !t->cash) {
+        goto fail;
+    }
+    memcpy(t->slot_agent, t->sample, t->n_sampled * sizeof(uint32_t));
+
+    t->fp = writer_fopen(cfg->path);
+    if (!t->fp) goto fail;
+
+    uint64_t n = params->n;
+    fwrite(TRAJ_MAGIC, 1, 8, t->fp);
+    fwrite(&n, sizeof(n), 1, t->fp);
+    fwrite(&t->n_sampled, sizeof(uint32_t), 1, t->fp);
+    fwrite(&t->n_largest, sizeof(uint32_t), 1, t->fp);
+    fwrite(&t->cfg.interval, sizeof(uint64_t), 1, t->fp);
+    for (uint32_t s = 0; s < t->n_sampled; s++) {
+        uint32_t id = order ? order[t->sample[s]] : t->sample[s];
+        fwrite(&id, sizeof(id), 1, t->fp);
+    }
+    for (uint32_t s = 0; s < t->n_sampled; s++) fputc(params->type[t->sample[s]], t->fp);
+    t->bytes = 32 + 5 * (uint64_t)t->n_sampled;
+    return 0;
+
+fail:
+    fprintf(stderr, "trajectory: cannot open %s\n", cfg->path);
+    traj_free(t);
+    memset(t, 0, sizeof(TrajectoryLog));
+    return -1;
+}
+
+/* Write the buffered group, each slot's values contiguous per column */
+static void flush_group(TrajectoryLog *t)
+{
+    uint32_t rows = t->rows;
+    if (rows == 0) return;
+
+    size_t put = 0, want = 0;
+    put += fwrite(&rows, sizeof(rows), 1, t->fp);
+    put += fwrite(t->steps, sizeof(uint64_t), rows, t->fp);
+    want += 1 + rows;
+    for (uint32_t s = 0; s < t->n_largest; s++) {
+        put += fwrite(t->holder_id + (size_t)s * TRAJ_GROUP, sizeof(uint32_t), rows, t->fp);
+    }
+    for (uint32_t s = 0; s < t->n_largest; s++) {
+        put += fwrite(t->holder_type + (size_t)s * TRAJ_GROUP, 1, rows, t->fp);
+    }
+    for (uint32_t s = 0; s < t->n_slots; s++) {
+        put += fwrite(t->belief + (size_t)s * TRAJ_GROUP, sizeof(double), rows, t->fp);
+    }
+    for (uint32_t s = 0; s < t->n_slots; s++) {
+        put += fwrite(t->position + (size_t)s * TRAJ_GROUP, sizeof(int32_t), rows, t->fp);
+    }
+    for (uint32_t s = 0; s < t->n_slots; s++) {
+        put += fwrite(t->cash + (size_t)s * TRAJ_GROUP, sizeof(double), rows, t->fp);
+    }
+    want += (size_t)rows * (2 * t->n_largest + 3 * t->n_slots);
+
+    if (put != want) t->failed = true;
+    t->bytes += sizeof(rows) + (uint64_t)rows * (8 + 5 * (uint64_t)t->n_largest + 20 * (uint64_t)t->n_slots);
+    t->rows = 0;
+}
+
+int traj_close(TrajectoryLog *t)
+{
+    if (!t->fp) return 0;
+
+    flush_group(t);
+    int rc = (fclose(t->fp) == 0 && !t->failed) ? 0 : -1;
+    if (rc != 0) fprintf(stderr, "trajectory: write failed, %s is incomplete\n", t->cfg.path);
+
+    traj_free(t);
+    t->fp = NULL;
+    return rc;
+}
+
+/* ----------------------------------------------------
+   Recording
+---------------------------------------------------- */
+
+void traj_record(TrajectoryLog *t, const AgentParams *params, const AgentState *state,
+                 uint64_t step)
+{
+    if (step % t->cfg.interval != 0) return;
+
+    if (t->n_largest > 0) find_holders(t, state);
+
+    uint32_t r = t->rows;
+    t->steps[r] = step;
+    for (uint32_t s = 0; s < t->n_slots; s++) {
+        uint32_t i = t->slot_agent[s];
+        size_t at = (size_t)s * TRAJ_GROUP + r;
+        t->belief[at] = state->belief[i];
+        t->position[at] = state->position[i];
+        t->cash[at] = state->cash[i];
+    }
+    for (uint32_t h = 0; h < t->n_largest; h++) {
+        uint32_t i = t->slot_agent[t->n_sampled + h];
+        t->holder_id[(size_t)h * TRAJ_GROUP + r] = t->order ? t->order[i] : i;
+        t->holder_type[(size_t)h * TRAJ_GROUP + r] = params->type[i];
+    }
+
+    t->records++;
+    if (++t->rows == TRAJ_GROUP) flush_group(t);
+}
+
+/* ----------------------------------------------------
+   Decoding
+---------------------------------------------------- */
+
+int traj_to_csv(const char *traj_path, const char *csv_path)
+{
+    FILE *in = fopen(traj_path, "rb");
+    if (!in) {
+        fprintf(stderr, "trajectory: cannot open %s\n", traj_path);
+        return -1;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    unsigned char *data = malloc(size > 0 ? (size_t)size : 1);
+    size_t len = data ? fread(data, 1, (size_t)size, in) : 0;
+    fclose(in);
+
+    const unsigned char *p = data, *end = data + len;
+    uint32_t n_sampled = 0, n_largest = 0;
+    if (!data || len < 32 || memcmp(p, TRAJ_MAGIC, 8) != 0) {
+        fprintf(stderr, "trajectory: %s is not a trajectory log\n", traj_path);
+        free(data);
+        return -1;
+    }
+    memcpy(&n_sampled, p + 16, sizeof(uint32_t));
+    memcpy(&n_largest, p + 20, sizeof(uint32_t));
+    p += 32;
+
+    const unsigned char *ids = p, *types = p + 4 * (size_t)n_sampled;
+    if ((size_t)(end - p) < 5 * (size_t)n_sampled) {
+        fprintf(stderr, "trajectory: %s is truncated\n", traj_path);
+        free(data);
+        return -1;
+    }
+    p += 5 * (size_t)n_sampled;
+
+    FILE *out = writer_fopen(csv_path);
+    if (!out) {
+        free(data);
+        return -1;
+    }
+    fprintf(out, "step,agent,type,rank,belief,position,cash\n");
+
+    size_t slots = (size_t)n_sampled + n_largest;
+    int rc = 0;
+    while (p < end) {
+        uint32_t rows;
+        if ((size_t)(end - p) < sizeof(rows)) { rc = -1; break; }
+        memcpy(&rows, p, sizeof(rows));
+        p += sizeof(rows);
+
+        size_t body = (size_t)rows * (8 + 5 * (size_t)n_largest + 20 * slots);
+        if ((size_t)(end - p) < body) { rc = -1; break; }
+
+        const unsigned char *steps = p;
+        const unsigned char *hid = steps + 8 * (size_t)rows;
+        const unsigned char *htype = hid + 4 * (size_t)rows * n_largest;
+        const unsigned char *belief = htype + (size_t)rows * n_largest;
+        const unsigned char *position = belief + 8 * (size_t)rows * slots;
+        const unsigned char *cash = position + 4 * (size_t)rows * slots;
+
+        for (uint32_t r = 0; r < rows; r++) {
+            uint64_t step;
+            memcpy(&step, steps + 8 * (size_t)r, sizeof(step));
+
+            for (size_t s = 0; s < slots; s++) {
+                uint32_t id, rank = 0;
+                int type;
+                size_t at = s * rows + r;
+                if (s < n_sampled) {
+                    memcpy(&id, ids + 4 * s, sizeof(id));
+                    type = types[s];
+                }
+                else {
+                    size_t h = (s - n_sampled) * rows + r;
+                    memcpy(&id, hid + 4 * h, sizeof(id));
+                    type = htype[h];
+                    rank = (uint32_t)(s - n_sampled) + 1;
+                }
+
+                double b, c;
+                int32_t q;
+                memcpy(&b, belief + 8 * at, sizeof(b));
+                memcpy(&q, position + 4 * at, sizeof(q));
+                memcpy(&c, cash + 8 * at, sizeof(c));
+                fprintf(out, "%llu,%u,%d,%u,%.10g,%d,%.10g\n", (unsigned long long)step,
+                        id, type, rank, b, q, c);
+            }
+        }
+        p += body;
+    }
+    if (rc != 0) fprintf(stderr, "trajectory: %s is corrupt or truncated\n", traj_path);
+
+    fclose(out);
+    free(data);
+    return rc;
+}
@@ -0,0 +1,113 @@
+#ifndef JUMPSIM_TRAJECTORY_H
+#define JUMPSIM_TRAJECTORY_H
+
+/*
+ * trajectory.h
+ * ------------
+ * Belief, position and cash paths of a few agents ("output.trajectories").
+ *
+ * Logging every agent every step does not scale; a trajectory log
+ * follows a fixed-size set instead:
+ *  - a stratified sample: 'per_type' agents of each AgentType, drawn once
+ *    by reservoir sampling over original ids (seeds.sample), so the same
+ *    agents are followed whatever the memory order and in every replica
+ *  - the 'largest' holders by |position|, chosen anew at each record
+ *
+ * Memory is fixed by the slot count: records are buffered for
+ * TRAJ_GROUP steps and written as one group of columns, each slot's
+ * values contiguous within a column.
+ *
+ * Layout (little-endian):
+ *   header   magic "JSTRJ001", uint64 n_agents, uint32 n_sampled,
+ *            uint32 n_largest, uint64 interval,
+ *            n_sampled x uint32 original ids, n_sampled x uint8 types
+ *   groups   uint32 rows, then the columns
+ *              uint64  step[rows]
+ *              uint32  holder id[n_largest][rows]   (original ids, rank order)
+ *              uint8   holder type[n_largest][rows]
+ *              f64     belief[slots][rows]
+ *              int32   position[slots][rows]
+ *              f64     cash[slots][rows]
+ *            where slots = n_sampled sampled agents, then the holders
+ *
+ * traj_to_csv() decodes a log.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "writer.h"
+#include "population.h"
+
+/* -------------------- Constants -------------------- */
+
+#define TRAJ_MAGIC "JSTRJ001"
+
+/* Records buffered per written group */
+#define TRAJ_GROUP 256
+
+/* Agent chunks searched for large holders in parallel */
+#define TRAJ_CHUNKS 64
+
+/* -------------------- Types -------------------- */
+
+/* A holder candidate: larger 'size', then lower 'agent', ranks first */
+typedef struct TrajHolder {
+    int64_t size;             /* |position| */
+    uint32_t agent;           /* index */
+} TrajHolder;
+
+typedef struct TrajectoryLog {
+    FILE *fp;
+    TrajectoryConfig cfg;
+    const uint32_t *order;    /* index -> original id, borrowed; NULL if not reordered */
+
+    uint32_t *sample;         /* sampled agent indices, by type then original id */
+    uint32_t n_sampled;
+    uint32_t n_largest;
+    uint32_t n_slots;
+
+    TrajHolder *candidates;   /* TRAJ_CHUNKS heaps of n_largest */
+    uint32_t *n_candidates;
+    uint32_t *slot_agent;     /* agent indices of this record's slots */
+
+    /* Group under construction */
+    uint32_t rows;
+    uint64_t *steps;
+    uint32_t *holder_id;
+    uint8_t *holder_type;
+    double *belief;
+    int32_t *position;
+    double *cash;
+
+    bool failed;
+    uint64_t records;
+    uint64_t bytes;
+} TrajectoryLog;
+
+/* -------------------- API (implemented in trajectory.c) -------------------- */
+
+/*
+ * Draw the sample from 'params' (original ids through 'order_inverse',
+ * NULL if not reordered) with 'seed', create cfg->path and write the
+ * header. 'order' is kept for naming holders. Returns 0 / -1.
+ */
+int traj_open(TrajectoryLog *t, const TrajectoryConfig *cfg, const AgentParams *params,
+              const uint32_t *order, const uint32_t *order_inverse, uint64_t seed);
+
+/* Record the slots after step 'step' if it falls on the interval */
+void traj_record(TrajectoryLog *t, const AgentParams *params, const AgentState *state,
+                 uint64_t step);
+
+/* Write the last group and close. Returns 0 / -1 (write error) */
+int traj_close(TrajectoryLog *t);
+
+/*
+ * Decode a log into CSV rows step,agent,type,rank,belief,position,cash
+ * (rank 0 for sampled agents, 1.. for the largest holders). Returns 0 / -1.
+ */
+int traj_to_csv(const char *traj_path, const char *csv_path);
+
+#endif /* JUMPSIM_TRAJECTORY_H */
@@ -0,0 +1,143 @@
+#include "writer.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/* ----------------------------------------------------
+   File helpers
+---------------------------------------------------- */
+
+FILE *writer_fopen(const char *path)
+{
+    char dir[OUTPUT_PATH_MAX];
+
+    /* mkdir -p on every parent component */
+    size_t n = strlen(path);
+    if (n < sizeof(dir)) {
+        memcpy(dir, path, n + 1);
+        for (char *s = dir + 1; *s; s++) {
+            if (*s != '/') continue;
+            *s = '\0';
+            if (mkdir(dir, 0755) != 0 && errno != EEXIST) break;
+            *s = '/';
+        }
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) fprintf(stderr, "writer: cannot open %s\n", path);
+    return fp;
+}
+
+static int replica_path(char *out, const char *path, int replica)
+{
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(path, '.');
+    if (!dot || (slash && dot < slash) || dot == path || dot[-1] == '/') dot = path + strlen(path);
+
+    char tag[24];
+    snprintf(tag, sizeof(tag), ".r%d", replica);
+
+    if (strlen(path) + strlen(tag) >= OUTPUT_PATH_MAX) {
+        fprintf(stderr, "writer: path too long for replica outputs: %s\n", path);
+        return -1;
+    }
+    snprintf(out, OUTPUT_PATH_MAX, "%.*s%s%s", (int)(dot - path), path, tag, dot);
+    return 0;
+}
+
+int writer_config_for_replica(OutputConfig *out, const OutputConfig *cfg, int replica)
+{
+    *out = *cfg;
+    if (replica_path(out->path, cfg->path, replica) != 0) return -1;
+    for (int i = 0; i < cfg->n_stages; i++) {
+        if (replica_path(out->stages[i].path, cfg->stages[i].path, replica) != 0) return -1;
+    }
+    if (cfg->tape[0] != '\0' && replica_path(out->tape, cfg->tape, replica) != 0) return -1;
+    if (cfg->trajectories.path[0] != '\0' &&
+        replica_path(out->trajectories.path, cfg->trajectories.path, replica) != 0) {
+        return -1;
+    }
+    if (cfg->dispersion.path[0] != '\0' &&
+        replica_path(out->dispersion.path, cfg->dispersion.path, replica) != 0) {
+        return -1;
+    }
+    if (cfg->changepoint.path[0] != '\0' &&
+        replica_path(out->changepoint.path, cfg->changepoint.path, replica) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Open / Close
+---------------------------------------------------- */
+
+int writer_open(PriceWriter *w, const OutputConfig *cfg)
+{
+    memset(w, 0, sizeof(PriceWriter));
+
+    if (cfg->full_resolution) {
+        w->fp = writer_fopen(cfg->path);
+        if (!w->fp) goto fail;
+        fprintf(w->fp, "time,price,log_return,volatility,shock\n");
+    }
+
+    if (cfg->pyramid) {
+        if (pyramid_open(&w->pyramid, cfg->path) != 0) goto fail;
+        w->with_pyramid = true;
+    }
+
+    for (int i = 0; i < cfg->n_stages; i++) {
+        if (stage_open(&w->stages[i], &cfg->stages[i]) != 0) goto fail;
+        w->n_stages++;
+    }
+
+    return 0;
+
+fail:
+    writer_close(w);
+    return -1;
+}
+
+void writer_close(PriceWriter *w)
+{
+    if (w->with_pyramid) {
+        pyramid_close(&w->pyramid);
+        w->with_pyramid = false;
+    }
+
+    for (int i = 0; i < w->n_stages; i++) {
+        stage_close(&w->stages[i]);
+    }
+    w->n_stages = 0;
+
+    if (w->fp) {
+        fclose(w->fp);
+        w->fp = NULL;
+    }
+}
+
+/* ----------------------------------------------------
+   Per-step output
+---------------------------------------------------- */
+
+void writer_push(PriceWriter *w, const StepRecord *rec)
+{
+    if (w->fp) {
+        fprintf(w->fp, "%llu,%f,%f,%f,%f\n",
+                (unsigned long long)rec->time,
+                rec->price,
+                rec->log_return,
+                rec->volatility,
+                rec->shock);
+    }
+
+    if (w->with_pyramid) {
+        pyramid_push(&w->pyramid, rec->time, rec->price, rec->volume);
+    }
+
+    for (int i = 0; i < w->n_stages; i++) {
+        stage_push(&w->stages[i], rec);
+    }
+}
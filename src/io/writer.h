@@ -0,0 +1,116 @@
+#ifndef JUMPSIM_WRITER_H
+#define JUMPSIM_WRITER_H
+
+/*
+ * writer.h
+ * --------
+ * Output pipeline for per-step market observations.
+ *
+ * The writer owns every persisted view of the price path:
+ *  - the full-resolution CSV (optional)
+ *  - the multi-resolution pyramid (see pyramid.h, optional)
+ *  - any number of aggregation stages (see aggregate.h)
+ *
+ * Simulation code only fills a StepRecord and pushes it; file formats and
+ * reductions stay out of the time loop.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pyramid.h"
+#include "aggregate.h"
+
+/* -------------------- Types -------------------- */
+
+/* One simulation step as seen by the output layer */
+typedef struct StepRecord {
+    uint64_t time;
+    double price;
+    double log_return;
+    double volatility;
+    double shock;
+    double volume;       /* absolute traded volume in the step */
+    bool jump;           /* |log_return| above the configured threshold */
+} StepRecord;
+
+/* Sampled agent trajectories ("output.trajectories", see trajectory.h) */
+typedef struct TrajectoryConfig {
+    char path[OUTPUT_PATH_MAX];   /* "" = none */
+    uint32_t per_type;            /* agents sampled from each type */
+    uint32_t largest;             /* largest holders, chosen anew at each record */
+    uint64_t interval;            /* record every 'interval' steps */
+} TrajectoryConfig;
+
+/* Per-type belief and position dispersion ("output.dispersion", see dispersion.h) */
+typedef struct DispersionConfig {
+    char path[OUTPUT_PATH_MAX];   /* "" = none */
+    double bin_width;             /* histogram bin width in log(belief / price) */
+} DispersionConfig;
+
+/* Regime detection on the return stream ("output.changepoint", see regime.h) */
+typedef struct ChangepointConfig {
+    char path[OUTPUT_PATH_MAX];   /* "" = none */
+    double cusum_drift;           /* allowance per step, in baseline levels */
+    double cusum_threshold;       /* alarm level, in baseline levels */
+    double cusum_decay;           /* EWMA decay of the baseline level */
+    double bocpd_hazard;          /* prior change probability per step */
+    uint32_t bocpd_max_run;       /* run-length hypotheses kept */
+    double bocpd_threshold;       /* alarm when P(run < window) reaches this */
+    uint32_t bocpd_window;
+} ChangepointConfig;
+
+/* Per-experiment output settings ("output" section of the config) */
+typedef struct OutputConfig {
+    char path[OUTPUT_PATH_MAX];   /* full-resolution CSV, pyramid base name */
+    bool full_resolution;         /* write every step to 'path' */
+    bool pyramid;                 /* build <path>.LKK.pyr levels */
+    OutputStageConfig stages[OUTPUT_MAX_STAGES];
+    int n_stages;
+    char tape[OUTPUT_PATH_MAX];   /* execution tape (tape.h), "" = none */
+    TrajectoryConfig trajectories;
+    DispersionConfig dispersion;
+    ChangepointConfig changepoint;
+} OutputConfig;
+
+typedef struct PriceWriter {
+    FILE *fp;             /* full-resolution CSV, NULL if disabled */
+    bool with_pyramid;
+    PricePyramid pyramid;
+    OutputStage stages[OUTPUT_MAX_STAGES];
+    int n_stages;
+} PriceWriter;
+
+/* -------------------- API (implemented in writer.c) -------------------- */
+
+/*
+ * Open every output enabled in 'cfg' and write headers.
+ * Returns 0 on success, -1 on failure (nothing is left open).
+ */
+int writer_open(PriceWriter *w, const OutputConfig *cfg);
+
+/*
+ * Append one step to every enabled output.
+ */
+void writer_push(PriceWriter *w, const StepRecord *rec);
+
+/*
+ * Flush pending bars and close all files.
+ */
+void writer_close(PriceWriter *w);
+
+/*
+ * Copy of 'cfg' for ensemble member 'replica': every output path gets
+ * ".r<replica>" before its extension (prices.csv -> prices.r3.csv).
+ * Returns 0, or -1 if a path gets too long.
+ */
+int writer_config_for_replica(OutputConfig *out, const OutputConfig *cfg, int replica);
+
+/*
+ * fopen(path, "w") that first creates missing parent directories,
+ * so experiment configs can point into results/ out of the box.
+ */
+FILE *writer_fopen(const char *path);
+
+#endif /* JUMPSIM_WRITER_H */
@@ -0,0 +1,349 @@
+#include "community.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNLABELED UINT32_MAX
+
+/* ----------------------------------------------------
+   Config names
+---------------------------------------------------- */
+
+int herding_mode_from_string(const char *s, HerdingMode *out)
+{
+    if (strcmp(s, "neighbors") == 0) *out = HERDING_NEIGHBORS;
+    else if (strcmp(s, "community") == 0) *out = HERDING_COMMUNITY;
+    else return -1;
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Label propagation
+---------------------------------------------------- */
+
+static inline uint64_t community_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/* Visiting order: a seeded Fisher–Yates shuffle of 0..n-1 */
+static void shuffled_order(uint32_t *order, size_t n, uint64_t seed)
+{
+    uint64_t rng = seed ? seed : 1;
+
+    for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)(((community_rand(&rng) >> 32) * (uint64_t)i) >> 32);
+        uint32_t t = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = t;
+    }
+}
+
+/*
+ Label v's neighbors agree on most: own label on a tie with it, otherwise
+ the smallest of the tied ones. 'count' is zero on entry and on return.
+*/
+static uint32_t majority_label(const uint32_t *label, const uint32_t *row, size_t d,
+                               uint32_t own, uint32_t *count, uint32_t *touched)
+{
+    size_t n_touched = 0;
+    for (size_t e = 0; e < d; e++) {
+        uint32_t l = label[row[e]];
+        if (count[l]++ == 0) touched[n_touched++] = l;
+    }
+
+    uint32_t best = own, best_count = count[own];
+    for (size_t t = 0; t < n_touched; t++) {
+        uint32_t l = touched[t];
+        if (count[l] > best_count || (count[l] == best_count && best != own && l < best)) {
+            best = l;
+            best_count = count[l];
+        }
+    }
+
+    for (size_t t = 0; t < n_touched; t++) count[touched[t]] = 0;
+    count[own] = 0;
+    return best;
+}
+
+static int push_block(Communities *c, size_t *cap, const CommunityBlock *blk)
+{
+    if (c->n_blocks == *cap) {
+        CommunityBlock *grown = realloc(c->blocks, 2 * *cap * sizeof(CommunityBlock));
+        if (!grown) return -1;
+        c->blocks = grown;
+        *cap *= 2;
+    }
+    c->blocks[c->n_blocks++] = *blk;
+    return 0;
+}
+
+/* Cut the member list into blocks of about COMMUNITY_BLOCK members */
+static int build_blocks(Communities *c)
+{
+    size_t cap = 64;
+    uint32_t first = 0;
+
+    c->blocks = malloc(cap * sizeof(CommunityBlock));
+    if (!c->blocks) return -1;
+
+    for (uint32_t q = 0; q < c->count; q++) {
+        uint32_t lo = c->start[q], hi = c->start[q + 1];
+
+        if (hi - lo <= COMMUNITY_BLOCK) {
+            if (hi - c->start[first] >= COMMUNITY_BLOCK) {
+                CommunityBlock blk = { first, q + 1, COMMUNITY_WHOLE, c->start[first], hi };
+                if (push_block(c, &cap, &blk) != 0) return -1;
+                first = q + 1;
+            }
+            continue;
+        }
+
+        /* Large community: close the small ones so far, then fragments */
+        if (first < q) {
+            CommunityBlock blk = { first, q, COMMUNITY_WHOLE, c->start[first], lo };
+            if (push_block(c, &cap, &blk) != 0) return -1;
+        }
+        for (uint32_t b = lo; b < hi; b += COMMUNITY_BLOCK) {
+            uint32_t end = hi - b > COMMUNITY_BLOCK ? b + COMMUNITY_BLOCK : hi;
+            CommunityBlock blk = { q, q + 1, (uint32_t)c->n_frags++, b, end };
+            if (push_block(c, &cap, &blk) != 0) return -1;
+        }
+        first = q + 1;
+    }
+
+    if (first < c->count) {
+        CommunityBlock blk = { first, (uint32_t)c->count, COMMUNITY_WHOLE,
+                               c->start[first], c->start[c->count] };
+        if (push_block(c, &cap, &blk) != 0) return -1;
+    }
+    return 0;
+}
+
+/* Renumber labels 0..C-1 by first appearance; fills start/member/blocks */
+static int build_members(Communities *c)
+{
+    size_t n = c->n;
+    uint32_t *renamed = malloc((n ? n : 1) * sizeof(uint32_t));
+    if (!renamed) return -1;
+
+    for (size_t i = 0; i < n; i++) renamed[i] = UNLABELED;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t l = c->label[i];
+        if (renamed[l] == UNLABELED) renamed[l] = (uint32_t)count++;
+        c->label[i] = renamed[l];
+    }
+    free(renamed);
+
+    c->count = count;
+    c->start = calloc(count + 1, sizeof(uint32_t));
+    c->member = malloc((n ? n : 1) * sizeof(uint32_t));
+    if (!c->start || !c->member) return -1;
+
+    /* Counting sort: members of a community stay in id order */
+    for (size_t i = 0; i < n; i++) c->start[c->label[i] + 1]++;
+    for (size_t k = 0; k < count; k++) c->start[k + 1] += c->start[k];
+
+    uint32_t *next = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!next) return -1;
+    memcpy(next, c->start, count * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++) c->member[next[c->label[i]]++] = (uint32_t)i;
+    free(next);
+
+    return build_blocks(c);
+}
+
+int community_detect(Communities *c, const Graph *g, int passes, uint64_t seed)
+{
+    size_t n = g->n, max_deg = 0;
+
+    memset(c, 0, sizeof(Communities));
+    c->n = n;
+
+    for (size_t i = 0; i < n; i++) {
+        if (graph_degree(g, i) > max_deg) max_deg = graph_degree(g, i);
+    }
+
+    c->label = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint32_t *order = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint32_t *count = calloc(n ? n : 1, sizeof(uint32_t));
+    uint32_t *touched = malloc((max_deg ? max_deg : 1) * sizeof(uint32_t));
+    uint32_t *row = malloc((max_deg ? max_deg : 1) * sizeof(uint32_t));
+    if (!c->label || !order || !count || !touched || !row) goto fail;
+
+    for (size_t i = 0; i < n; i++) c->label[i] = (uint32_t)i;
+    shuffled_order(order, n, seed);
+
+    /* Asynchronous: later nodes of a pass already see earlier moves */
+    for (int pass = 0; pass < passes; pass++) {
+        size_t moved = 0;
+        for (size_t t = 0; t < n; t++) {
+            uint32_t v = order[t];
+            size_t d = graph_row(g, v, row);
+            if (d == 0) continue;
+
+            uint32_t l = majority_label(c->label, row, d, c->label[v], count, touched);
+            if (l != c->label[v]) {
+                c->label[v] = l;
+                moved++;
+            }
+        }
+        if (moved == 0) break;
+    }
+
+    free(order); free(count); free(touched); free(row);
+    order = count = touched = row = NULL;
+
+    if (build_members(c) != 0) goto fail;
+    return 0;
+
+fail:
+    free(order); free(count); free(touched); free(row);
+    community_free(c);
+    return -1;
+}
+
+size_t community_largest(const Communities *c)
+{
+    size_t largest = 0;
+    for (size_t k = 0; k < c->count; k++) {
+        size_t size = c->start[k + 1] - c->start[k];
+        if (size > largest) largest = size;
+    }
+    return largest;
+}
+
+void community_free(Communities *c)
+{
+    free(c->label);
+    free(c->start);
+    free(c->member);
+    free(c->blocks);
+    memset(c, 0, sizeof(Communities));
+}
+
+/* ----------------------------------------------------
+   Herding input
+---------------------------------------------------- */
+
+/*
+ Per community sums in 'sum' (fragments from 'part', in order), then the
+ blended means in place. Shared by both entry points so that they round
+ alike; 'total' holds k scratch values.
+*/
+static void blend(const Communities *c, const double *part, size_t k,
+                  double global_weight, double *sum, double *total)
+{
+    for (size_t b = 0; b < c->n_blocks; b++) {
+        const CommunityBlock *blk = &c->blocks[b];
+        if (blk->frag == COMMUNITY_WHOLE) continue;
+
+        double *s = sum + (size_t)blk->first * k;
+        const double *v = part + (size_t)blk->frag * k;
+        for (size_t r = 0; r < k; r++) {
+            s[r] = (blk->begin == c->start[blk->first]) ? v[r] : s[r] + v[r];
+        }
+    }
+
+    for (size_t r = 0; r < k; r++) total[r] = 0.0;
+    for (size_t q = 0; q < c->count; q++) {
+        for (size_t r = 0; r < k; r++) total[r] += sum[q * k + r];
+    }
+
+    for (size_t q = 0; q < c->count; q++) {
+        double size = (double)(c->start[q + 1] - c->start[q]);
+        for (size_t r = 0; r < k; r++) {
+            double *s = sum + q * k + r;
+            *s = (1.0 - global_weight) * (*s / size) +
+                 global_weight * (total[r] / (double)c->n);
+        }
+    }
+}
+
+int community_mean(const Communities *c, const double *x, double global_weight,
+                   double *out)
+{
+    double *sum = malloc((c->count + c->n_frags + 1) * sizeof(double));
+    if (!sum) return -1;
+    double *part = sum + c->count;
+
+    long n_blocks = (long)c->n_blocks;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long b = 0; b < n_blocks; b++) {
+        const CommunityBlock *blk = &c->blocks[b];
+
+        if (blk->frag != COMMUNITY_WHOLE) {
+            double s = 0.0;
+            for (uint32_t m = blk->begin; m < blk->end; m++) s += x[c->member[m]];
+            part[blk->frag] = s;
+            continue;
+        }
+        for (uint32_t q = blk->first; q < blk->last; q++) {
+            double s = 0.0;
+            for (uint32_t m = c->start[q]; m < c->start[q + 1]; m++) s += x[c->member[m]];
+            sum[q] = s;
+        }
+    }
+
+    double total;
+    blend(c, part, 1, global_weight, sum, &total);
+
+    long n = (long)c->n;
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) out[i] = sum[c->label[i]];
+
+    free(sum);
+    return 0;
+}
+
+/* Unscaled sums over members lo .. hi-1 for k interleaved vectors */
+static void member_sum_k(const Communities *c, const double *x, size_t k,
+                         uint32_t lo, uint32_t hi, double *o)
+{
+    for (size_t r = 0; r < k; r++) o[r] = 0.0;
+    for (uint32_t m = lo; m < hi; m++) {
+        const double *xm = x + (size_t)c->member[m] * k;
+        for (size_t r = 0; r < k; r++) o[r] += xm[r];
+    }
+}
+
+int community_mean_k(const Communities *c, const double *x, size_t k,
+                     double global_weight, double *out)
+{
+    double *sum = malloc((c->count + c->n_frags + 1) * k * sizeof(double));
+    if (!sum) return -1;
+    double *part = sum + c->count * k;
+    double *total = part + c->n_frags * k;
+
+    long n_blocks = (long)c->n_blocks;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long b = 0; b < n_blocks; b++) {
+        const CommunityBlock *blk = &c->blocks[b];
+
+        if (blk->frag != COMMUNITY_WHOLE) {
+            member_sum_k(c, x, k, blk->begin, blk->end, part + (size_t)blk->frag * k);
+            continue;
+        }
+        for (uint32_t q = blk->first; q < blk->last; q++) {
+            member_sum_k(c, x, k, c->start[q], c->start[q + 1], sum + (size_t)q * k);
+        }
+    }
+
+    blend(c, part, k, global_weight, sum, total);
+
+    long n = (long)c->n;
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        memcpy(out + (size_t)i * k, sum + (size_t)c->label[i] * k, k * sizeof(double));
+    }
+
+    free(sum);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef JUMPSIM_COMMUNITY_H
+#define JUMPSIM_COMMUNITY_H
+
+/*
+ * community.h
+ * -----------
+ * Community-level herding: agents react to the mood of their community
+ * and of the market as a whole instead of to each neighbor.
+ *
+ * Much herding is mesoscale sentiment (a forum, a follower cluster)
+ * rather than one-to-one imitation. Communities are detected once at
+ * setup by label propagation: every node starts with its own label and,
+ * visiting nodes in a seeded random order, repeatedly takes the label
+ * most common among its neighbors (keeping its own on a tie, else the
+ * smallest), until a pass changes nothing or 'passes' have run. That
+ * costs O(passes * links) once. Labels are then renumbered 0..C-1 in
+ * order of first appearance.
+ *
+ * Each step the herding input of agent i in community c is
+ *
+ *     (1 - global_weight) * mean belief of c + global_weight * mean belief of all
+ *
+ * which takes one pass over the agents (O(N), no adjacency reads)
+ * instead of a gather over every link. Members are listed community by
+ * community, in id order. Small communities are summed whole, several
+ * to a block; large ones in fixed fragments added up in order, so
+ * results do not depend on the thread count.
+ *
+ * The partition is fixed for the run; a rewiring network keeps the
+ * communities it started with.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "graph.h"
+
+/* -------------------- Types & Constants -------------------- */
+
+/* Target members per block (one unit of parallel work) */
+#define COMMUNITY_BLOCK 4096
+
+/* CommunityBlock.frag of a block made of whole communities */
+#define COMMUNITY_WHOLE UINT32_MAX
+
+/*
+ Whole communities first .. last-1, or one fragment of community 'first'
+ (members begin .. end-1) when it is larger than a block; fragments are
+ added up in order afterwards.
+*/
+typedef struct CommunityBlock {
+    uint32_t first, last;
+    uint32_t frag;             /* fragment index, or COMMUNITY_WHOLE */
+    uint32_t begin, end;
+} CommunityBlock;
+
+typedef struct Communities {
+    size_t n;                  /* agents */
+    size_t count;              /* communities */
+    uint32_t *label;           /* n: community of each agent */
+    uint32_t *start;           /* count + 1: members of c are member[start[c] .. start[c+1]) */
+    uint32_t *member;          /* n agent ids, grouped by community */
+    CommunityBlock *blocks;
+    size_t n_blocks;
+    size_t n_frags;
+} Communities;
+
+/* -------------------- API (implemented in community.c) -------------------- */
+
+/* Parse "neighbors" or "community". Returns 0 / -1 */
+int herding_mode_from_string(const char *s, HerdingMode *out);
+
+/*
+ * Detect communities of 'g' by label propagation (at most 'passes'
+ * passes, node order drawn from 'seed'). Rows may be plain or compressed.
+ * Returns 0 / -1.
+ */
+int community_detect(Communities *c, const Graph *g, int passes, uint64_t seed);
+
+/*
+ * Herding input from community and global means of x (see above):
+ * out[i] for every agent. Returns 0 / -1 (no memory; out unchanged).
+ */
+int community_mean(const Communities *c, const double *x, double global_weight,
+                   double *out);
+
+/*
+ * Same for k interleaved vectors (x[i * k + r], lockstep ensembles); per
+ * vector bit-identical to community_mean.
+ */
+int community_mean_k(const Communities *c, const double *x, size_t k,
+                     double global_weight, double *out);
+
+/* Agents in the largest community */
+size_t community_largest(const Communities *c);
+
+void community_free(Communities *c);
+
+#endif /* JUMPSIM_COMMUNITY_H */
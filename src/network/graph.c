@@ -0,0 +1,1497 @@
+#include "graph.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------
+   Config names
+---------------------------------------------------- */
+
+int network_kind_from_string(const char *s, NetworkKind *out)
+{
+    if (strcmp(s, "none") == 0) *out = NETWORK_NONE;
+    else if (strcmp(s, "barabasi_albert") == 0) *out = NETWORK_BARABASI_ALBERT;
+    else if (strcmp(s, "small_world") == 0) *out = NETWORK_SMALL_WORLD;
+    else if (strcmp(s, "file") == 0) *out = NETWORK_FILE;
+    else return -1;
+    return 0;
+}
+
+int graph_order_from_string(const char *s, GraphOrder *out)
+{
+    if (strcmp(s, "none") == 0) *out = GRAPH_ORDER_NONE;
+    else if (strcmp(s, "degree") == 0) *out = GRAPH_ORDER_DEGREE;
+    else if (strcmp(s, "rcm") == 0) *out = GRAPH_ORDER_RCM;
+    else return -1;
+    return 0;
+}
+
+/* ----------------------------------------------------
+   CSR construction
+---------------------------------------------------- */
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Most rows are short: insertion sort them, qsort the hubs */
+static void sort_row(uint32_t *row, size_t len)
+{
+    if (len > 16) {
+        qsort(row, len, sizeof(uint32_t), cmp_u32);
+        return;
+    }
+    for (size_t k = 1; k < len; k++) {
+        uint32_t v = row[k];
+        size_t j = k;
+        while (j > 0 && row[j - 1] > v) {
+            row[j] = row[j - 1];
+            j--;
+        }
+        row[j] = v;
+    }
+}
+
+/*
+ Construction is a two-level counting sort without atomics:
+   1. count entries per (edge chunk, row bucket), prefix sum bucket-major
+   2. partition entries into their bucket (few sequential write streams)
+   3. per bucket, in cache: counting sort by row, sort rows, drop repeats
+ Buckets hold 2^shift rows (shift <= 16, so local row ids fit uint16_t).
+ The edge list is cut into a fixed number of chunks, so every position
+ is independent of the thread count.
+*/
+#define EDGE_CHUNKS    256
+#define BUCKET_TARGET  1024
+
+static unsigned bucket_shift(size_t n)
+{
+    unsigned s = 8;
+    while (s < 16 && n > ((size_t)BUCKET_TARGET << s)) s++;
+    return s;
+}
+
+int graph_from_edges(Graph *g, size_t n, const uint32_t *edges, size_t n_edges,
+                     unsigned flags)
+{
+    bool sym = (flags & GRAPH_SYMMETRIZE) != 0;
+    bool dedup = (flags & GRAPH_DEDUP) != 0;
+
+    unsigned shift = bucket_shift(n);
+    size_t rows_per = (size_t)1 << shift;
+    size_t n_buckets = (n + rows_per - 1) / rows_per;
+    size_t chunk = (n_edges + EDGE_CHUNKS - 1) / EDGE_CHUNKS;
+    long n_chunks = EDGE_CHUNKS;
+    long count = (long)n_buckets;
+
+    memset(g, 0, sizeof(Graph));
+    g->n = n;
+    g->offsets = malloc((n + 1) * sizeof(uint64_t));
+    uint64_t *pos = calloc((size_t)EDGE_CHUNKS * (n_buckets ? n_buckets : 1), sizeof(uint64_t));
+    uint64_t *bucket_start = malloc((n_buckets + 1) * sizeof(uint64_t));
+    uint64_t *row_len = malloc((n ? n : 1) * sizeof(uint64_t));
+    uint16_t *loc = NULL;
+
+    if (!g->offsets || !pos || !bucket_start || !row_len) goto fail;
+    uint64_t *off = g->offsets;
+
+    /* 1. Entries per (chunk, bucket) */
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long c = 0; c < n_chunks; c++) {
+        uint64_t *cnt = pos + (size_t)c * n_buckets;
+        size_t lo = (size_t)c * chunk;
+        size_t hi = lo + chunk < n_edges ? lo + chunk : n_edges;
+
+        for (size_t k = lo; k < hi; k++) {
+            uint32_t s = edges[2 * k], d = edges[2 * k + 1];
+            if (s == d || s >= n || d >= n) continue;
+            cnt[s >> shift]++;
+            if (sym) cnt[d >> shift]++;
+        }
+    }
+
+    /* Bucket-major exclusive prefix: chunk c fills bucket b from pos[c][b] */
+    uint64_t m = 0;
+    for (size_t b = 0; b < n_buckets; b++) {
+        bucket_start[b] = m;
+        for (size_t c = 0; c < EDGE_CHUNKS; c++) {
+            uint64_t t = pos[c * n_buckets + b];
+            pos[c * n_buckets + b] = m;
+            m += t;
+        }
+    }
+    bucket_start[n_buckets] = m;
+
+    g->adj = malloc((m ? m : 1) * sizeof(uint32_t));
+    loc = malloc((m ? m : 1) * sizeof(uint16_t));
+    if (!g->adj || !loc) goto fail;
+    uint32_t *adj = g->adj;
+    uint32_t row_mask = (uint32_t)(rows_per - 1);
+
+    /* 2. Partition: neighbor id into adj, row within the bucket into loc */
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long c = 0; c < n_chunks; c++) {
+        uint64_t *cur = pos + (size_t)c * n_buckets;
+        size_t lo = (size_t)c * chunk;
+        size_t hi = lo + chunk < n_edges ? lo + chunk : n_edges;
+
+        for (size_t k = lo; k < hi; k++) {
+            uint32_t s = edges[2 * k], d = edges[2 * k + 1];
+            if (s == d || s >= n || d >= n) continue;
+
+            uint64_t p = cur[s >> shift]++;
+            adj[p] = d;
+            loc[p] = (uint16_t)(s & row_mask);
+            if (sym) {
+                p = cur[d >> shift]++;
+                adj[p] = s;
+                loc[p] = (uint16_t)(d & row_mask);
+            }
+        }
+    }
+
+    /* 3. Rows of each bucket; the bucket's slice of adj stays in cache */
+    uint64_t removed = 0;
+    int failed = 0;
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:removed) reduction(|:failed)
+    for (long b = 0; b < count; b++) {
+        size_t r0 = (size_t)b * rows_per;
+        size_t rows = n - r0 < rows_per ? n - r0 : rows_per;
+        uint64_t base = bucket_start[b];
+        size_t len = (size_t)(bucket_start[b + 1] - base);
+
+        uint64_t *cur = calloc(rows + 1, sizeof(uint64_t));
+        uint32_t *tmp = malloc((len ? len : 1) * sizeof(uint32_t));
+        if (!cur || !tmp) {
+            free(cur); free(tmp);
+            failed = 1;
+            continue;
+        }
+
+        for (size_t k = 0; k < len; k++) cur[loc[base + k] + 1]++;
+        for (size_t r = 0; r < rows; r++) {
+            cur[r + 1] += cur[r];
+            off[r0 + r] = base + cur[r];
+        }
+
+        memcpy(tmp, adj + base, len * sizeof(uint32_t));
+        for (size_t k = 0; k < len; k++) adj[base + cur[loc[base + k]]++] = tmp[k];
+
+        /* cur[r] is now the end of row r */
+        for (size_t r = 0; r < rows; r++) {
+            uint32_t *row = adj + off[r0 + r];
+            size_t rl = (size_t)(base + cur[r] - off[r0 + r]);
+            size_t out = rl;
+
+            sort_row(row, rl);
+            if (dedup && rl > 1) {
+                out = 1;
+                for (size_t k = 1; k < rl; k++) {
+                    if (row[k] != row[out - 1]) row[out++] = row[k];
+                }
+            }
+            row_len[r0 + r] = out;
+            removed += rl - out;
+        }
+        free(cur);
+        free(tmp);
+    }
+    if (failed) goto fail;
+    off[n] = m;
+
+    /* Close the gaps left by repeats (memory-bound, one pass) */
+    if (removed > 0) {
+        uint64_t out = 0;
+        for (size_t i = 0; i < n; i++) {
+            memmove(adj + out, adj + off[i], (size_t)row_len[i] * sizeof(uint32_t));
+            off[i] = out;
+            out += row_len[i];
+        }
+        off[n] = out;
+        m = out;
+
+        uint32_t *shrunk = realloc(adj, (m ? m : 1) * sizeof(uint32_t));
+        if (shrunk) g->adj = shrunk;
+    }
+    g->m = (size_t)m;
+
+    free(loc);
+    free(pos);
+    free(bucket_start);
+    free(row_len);
+    return 0;
+
+fail:
+    free(loc);
+    free(pos);
+    free(bucket_start);
+    free(row_len);
+    graph_free(g);
+    return -1;
+}
+
+void graph_free(Graph *g)
+{
+    if (graph_owns(g, g->offsets)) free(g->offsets);
+    if (graph_owns(g, g->adj)) free(g->adj);
+    free(g->packed);
+    free(g->packed_offsets);
+    free(g->work);
+    free(g->work_part);
+    free(g->degree);
+    free(g->room);
+    free(g->hubs);
+    free(g->hub_sample);
+    memset(g, 0, sizeof(Graph));
+}
+
+/* ----------------------------------------------------
+   Compressed rows
+---------------------------------------------------- */
+
+/*
+ Row layout (d = degree):
+   ctrl[ceil(d/4)]   2 bits per value: byte length - 1
+   data[...]         values, 1-4 little-endian bytes each
+ Values: zz(first - i) mod 2^32, then (next - prev - 1).
+
+ Lengths come from the control bytes, not from the data bytes, so the
+ decoder never waits on one value to find the next (unlike LEB128).
+*/
+
+static const uint32_t PACKED_MASK[4] = { 0xFFu, 0xFFFFu, 0xFFFFFFu, 0xFFFFFFFFu };
+
+static inline uint32_t zigzag32(uint32_t d)
+{
+    return (d << 1) ^ (uint32_t)-(int32_t)(d >> 31);
+}
+
+static inline uint32_t unzigzag32(uint32_t v)
+{
+    return (v >> 1) ^ (uint32_t)-(int32_t)(v & 1);
+}
+
+static inline unsigned packed_len_code(uint32_t v)
+{
+    return (v > 0xFFu) + (v > 0xFFFFu) + (v > 0xFFFFFFu);
+}
+
+/* Encode row i into 'out' (NULL: only measure); returns bytes */
+static size_t encode_row(const Graph *g, size_t i, unsigned char *out)
+{
+    uint64_t lo = g->offsets[i], hi = graph_row_end(g, i);
+    size_t d = (size_t)(hi - lo);
+    size_t n_ctrl = (d + 3) / 4;
+    size_t bytes = n_ctrl;
+
+    if (out) memset(out, 0, n_ctrl);
+
+    for (size_t k = 0; k < d; k++) {
+        uint32_t cur = g->adj[lo + k];
+        uint32_t v = (k == 0) ? zigzag32(cur - (uint32_t)i)
+                              : cur - g->adj[lo + k - 1] - 1;
+        unsigned code = packed_len_code(v);
+
+        if (out) {
+            out[k / 4] |= (unsigned char)(code << (2 * (k % 4)));
+            for (unsigned b = 0; b <= code; b++) out[bytes + b] = (unsigned char)(v >> (8 * b));
+        }
+        bytes += code + 1;
+    }
+    return bytes;
+}
+
+int graph_compress(Graph *g)
+{
+    if (graph_is_compressed(g)) return 0;
+    if (g->degree) {
+        fprintf(stderr, "graph: rows with slack cannot be compressed\n");
+        return -1;
+    }
+    graph_work_clear(g);
+
+    size_t n = g->n;
+    long count = (long)n;
+    uint64_t *poff = malloc((n + 1) * sizeof(uint64_t));
+    if (!poff) return -1;
+
+    /* Pass 1: encoded size of every row */
+    poff[0] = 0;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < count; i++) poff[i + 1] = encode_row(g, (size_t)i, NULL);
+    for (size_t i = 0; i < n; i++) poff[i + 1] += poff[i];
+
+    /* Zeroed tail: the gather decodes with 4-byte loads */
+    unsigned char *packed = malloc((size_t)poff[n] + GRAPH_PACKED_PAD);
+    if (!packed) {
+        free(poff);
+        return -1;
+    }
+    memset(packed + poff[n], 0, GRAPH_PACKED_PAD);
+
+    /* Pass 2: encode rows in place */
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < count; i++) encode_row(g, (size_t)i, packed + poff[i]);
+
+    if (graph_owns(g, g->adj)) free(g->adj);
+    g->adj = NULL;
+    g->packed = packed;
+    g->packed_offsets = poff;
+    return 0;
+}
+
+size_t graph_bytes(const Graph *g)
+{
+    size_t bytes = (g->n + 1) * sizeof(uint64_t);
+
+    if (graph_is_compressed(g))
+        bytes += (g->n + 1) * sizeof(uint64_t) + (size_t)g->packed_offsets[g->n];
+    else if (g->degree)
+        bytes += (size_t)g->adj_cap * sizeof(uint32_t) + 2 * g->n * sizeof(uint32_t);
+    else
+        bytes += g->m * sizeof(uint32_t);
+    return bytes;
+}
+
+/* ----------------------------------------------------
+   Rows with slack
+---------------------------------------------------- */
+
+/*
+ Edited rows are scattered: prefetch the row this many runs ahead, so
+ the misses of consecutive runs overlap.
+*/
+#define GRAPH_EDIT_AHEAD 8
+
+#if defined(__GNUC__)
+#define GRAPH_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define GRAPH_PREFETCH(p) ((void)0)
+#endif
+
+/* Row capacity for 'd' live entries */
+static uint32_t slack_room(size_t d, double slack)
+{
+    size_t spare = (size_t)((double)d * slack);
+    return (uint32_t)(d + (spare > GRAPH_SLACK_MIN ? spare : GRAPH_SLACK_MIN));
+}
+
+/*
+ Copy every row, in order, into a fresh array with room for 'grow[i]'
+ more entries (grow may be NULL) plus slack, and free space behind the
+ last row. This is also the compaction: room left behind by rows that
+ moved or shrank is not carried over.
+*/
+static int relayout(Graph *g, const uint32_t *grow)
+{
+    size_t n = g->n;
+    uint64_t *offsets = malloc((n + 1) * sizeof(uint64_t));
+    uint32_t *degree = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint32_t *room = malloc((n ? n : 1) * sizeof(uint32_t));
+    if (!offsets || !degree || !room) {
+        free(offsets); free(degree); free(room);
+        return -1;
+    }
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        degree[i] = (uint32_t)graph_degree(g, i);
+        room[i] = slack_room(degree[i] + (grow ? grow[i] : 0), g->slack);
+        offsets[i + 1] = offsets[i] + room[i];
+    }
+
+    uint64_t end = offsets[n];
+    uint64_t cap = end + (uint64_t)((double)end * g->slack) + GRAPH_SLACK_MIN;
+    uint32_t *adj = malloc((size_t)cap * sizeof(uint32_t));
+    if (!adj) {
+        free(offsets); free(degree); free(room);
+        return -1;
+    }
+
+    long count = (long)n;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < count; i++) {
+        memcpy(adj + offsets[i], g->adj + g->offsets[i], degree[i] * sizeof(uint32_t));
+    }
+
+    if (graph_owns(g, g->offsets)) free(g->offsets);
+    if (graph_owns(g, g->adj)) free(g->adj);
+    free(g->degree);
+    free(g->room);
+    g->offsets = offsets;
+    g->adj = adj;
+    g->degree = degree;
+    g->room = room;
+    g->adj_end = end;
+    g->adj_cap = cap;
+    return 0;
+}
+
+int graph_reserve(Graph *g, double slack)
+{
+    if (graph_is_compressed(g)) {
+        fprintf(stderr, "graph: compressed rows cannot take edits\n");
+        return -1;
+    }
+
+    bool scheduled = g->work != NULL;
+    graph_work_clear(g);
+
+    g->slack = slack > 0.0 ? slack : 0.0;
+    if (relayout(g, NULL) != 0) return -1;
+    return scheduled ? graph_build_work(g) : 0;
+}
+
+/*
+ Group edits by row, keeping batch order within a row: LSD radix sort on
+ the row id, 11 bits per pass (3 passes up to 2^33 rows).
+*/
+#define EDIT_RADIX_BITS 11
+
+static int sort_edits(GraphEdit *edits, size_t count, size_t n)
+{
+    GraphEdit *tmp = malloc((count ? count : 1) * sizeof(GraphEdit));
+    size_t *bin = malloc(((size_t)1 << EDIT_RADIX_BITS) * sizeof(size_t));
+    if (!tmp || !bin) {
+        free(tmp); free(bin);
+        return -1;
+    }
+
+    GraphEdit *from = edits, *to = tmp;
+    size_t mask = ((size_t)1 << EDIT_RADIX_BITS) - 1;
+
+    for (unsigned shift = 0; shift < 32 && (n - 1) >> shift; shift += EDIT_RADIX_BITS) {
+        memset(bin, 0, (mask + 1) * sizeof(size_t));
+        for (size_t k = 0; k < count; k++) bin[(from[k].row >> shift) & mask]++;
+
+        size_t at = 0;
+        for (size_t b = 0; b <= mask; b++) {
+            size_t c = bin[b];
+            bin[b] = at;
+            at += c;
+        }
+        for (size_t k = 0; k < count; k++) to[bin[(from[k].row >> shift) & mask]++] = from[k];
+
+        GraphEdit *t = from;
+        from = to;
+        to = t;
+    }
+
+    if (from != edits) memcpy(edits, from, count * sizeof(GraphEdit));
+    free(tmp);
+    free(bin);
+    return 0;
+}
+
+/* Position of 'v' in a sorted row, or where it would go */
+static size_t row_search(const uint32_t *row, size_t d, uint32_t v)
+{
+    size_t lo = 0, hi = d;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (row[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Runs at least this long are merged into their row in one pass */
+#define EDIT_MERGE_MIN 16
+
+/* Order by column, then batch position (GraphEdit.row holds the position here) */
+static int cmp_edit_col(const void *a, const void *b)
+{
+    const GraphEdit *x = a, *y = b;
+    if (x->col != y->col) return (x->col > y->col) - (x->col < y->col);
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+/*
+ Many edits to one (hub) row: shifting the row once per edit would cost
+ O(count * degree). Each edit makes its column present or absent
+ whatever came before, so the last edit per column decides; those are
+ merged with the row in one pass. Returns -1 without scratch memory.
+*/
+static long merge_row(Graph *g, const GraphEdit *e, size_t count, long *delta)
+{
+    size_t i = e[0].row;
+    uint32_t *row = g->adj + g->offsets[i];
+    size_t d = g->degree[i];
+
+    GraphEdit *ops = malloc(count * sizeof(GraphEdit));
+    uint32_t *out = malloc((d + count) * sizeof(uint32_t));
+    if (!ops || !out) {
+        free(ops); free(out);
+        return -1;
+    }
+
+    for (size_t k = 0; k < count; k++) ops[k] = (GraphEdit){ (uint32_t)k, e[k].col, e[k].insert };
+    qsort(ops, count, sizeof(GraphEdit), cmp_edit_col);
+
+    size_t a = 0, b = 0, len = 0;
+    while (a < d || b < count) {
+        /* Last edit of the next column */
+        while (b + 1 < count && ops[b + 1].col == ops[b].col) b++;
+        uint32_t v = b < count ? ops[b].col : UINT32_MAX;
+
+        if (a < d && (b >= count || row[a] < v)) {
+            out[len++] = row[a++];
+            continue;
+        }
+        bool present = a < d && row[a] == v;
+        if (present) a++;
+        if (ops[b].insert && v != i && v < g->n) out[len++] = v;
+        b++;
+    }
+
+    memcpy(row, out, len * sizeof(uint32_t));
+    g->degree[i] = (uint32_t)len;
+    *delta = (long)len - (long)d;
+
+    free(ops);
+    free(out);
+    return 0;
+}
+
+/* Apply one row's edits in order; returns the change in its degree */
+static long edit_row(Graph *g, const GraphEdit *e, size_t count)
+{
+    size_t i = e[0].row;
+    uint32_t *row = g->adj + g->offsets[i];
+    size_t d = g->degree[i];
+    size_t d0 = d;
+
+    long delta;
+    if (count >= EDIT_MERGE_MIN && merge_row(g, e, count, &delta) == 0) return delta;
+
+    for (size_t k = 0; k < count; k++) {
+        uint32_t v = e[k].col;
+        if (v == i || v >= g->n) continue;
+
+        size_t at = row_search(row, d, v);
+        bool present = at < d && row[at] == v;
+
+        if (e[k].insert && !present) {
+            memmove(row + at + 1, row + at, (d - at) * sizeof(uint32_t));
+            row[at] = v;
+            d++;
+        }
+        else if (!e[k].insert && present) {
+            memmove(row + at, row + at + 1, (d - at - 1) * sizeof(uint32_t));
+            d--;
+        }
+    }
+
+    g->degree[i] = (uint32_t)d;
+    return (long)d - (long)d0;
+}
+
+/*
+ Make room for every row's inserts: rows that would overflow move to the
+ free space behind the last row with at least twice their room, so a
+ growing hub moves O(log degree) times. If the free space runs out, all
+ rows are compacted instead ('compacted' is set).
+*/
+static int make_room(Graph *g, const GraphEdit *edits, const size_t *run, size_t n_runs,
+                     bool *compacted)
+{
+    size_t *moving = malloc((n_runs ? n_runs : 1) * sizeof(size_t));
+    uint32_t *want_room = malloc((n_runs ? n_runs : 1) * sizeof(uint32_t));
+    if (!moving || !want_room) {
+        free(moving); free(want_room);
+        return -1;
+    }
+
+    size_t n_moving = 0;
+    uint64_t need = 0;
+
+    for (size_t r = 0; r < n_runs; r++) {
+        if (r + GRAPH_EDIT_AHEAD < n_runs) {
+            size_t ahead = edits[run[r + GRAPH_EDIT_AHEAD]].row;
+            GRAPH_PREFETCH(&g->degree[ahead]);
+            GRAPH_PREFETCH(&g->room[ahead]);
+        }
+
+        size_t i = edits[run[r]].row, inserts = 0;
+        for (size_t k = run[r]; k < run[r + 1]; k++) inserts += edits[k].insert;
+
+        size_t want = g->degree[i] + inserts;
+        if (want <= g->room[i]) continue;
+
+        uint32_t room = slack_room(want, g->slack);
+        if (room < 2 * g->room[i]) room = 2 * g->room[i];
+        moving[n_moving] = i;
+        want_room[n_moving++] = room;
+        need += room;
+    }
+
+    int rc = 0;
+    if (n_moving > 0 && g->adj_end + need > g->adj_cap) {
+        uint32_t *grow = calloc(g->n ? g->n : 1, sizeof(uint32_t));
+        if (grow) {
+            for (size_t k = 0; k < run[n_runs]; k++) grow[edits[k].row] += edits[k].insert;
+            rc = relayout(g, grow);
+            *compacted = (rc == 0);
+        }
+        else {
+            rc = -1;
+        }
+        free(grow);
+    }
+    else {
+        for (size_t t = 0; t < n_moving; t++) {
+            size_t i = moving[t];
+            memcpy(g->adj + g->adj_end, g->adj + g->offsets[i], g->degree[i] * sizeof(uint32_t));
+            g->offsets[i] = g->adj_end;
+            g->room[i] = want_room[t];
+            g->adj_end += want_room[t];
+        }
+    }
+
+    free(moving);
+    free(want_room);
+    return rc;
+}
+
+int graph_apply_edits(Graph *g, GraphEdit *edits, size_t count)
+{
+    if (!g->degree) {
+        fprintf(stderr, "graph: edits need rows with slack (graph_reserve)\n");
+        return -1;
+    }
+    if (count == 0) return 0;
+
+    for (size_t k = 0; k < count; k++) {
+        if (edits[k].row >= g->n) return -1;
+    }
+    if (sort_edits(edits, count, g->n) != 0) return -1;
+
+    /* Runs of one row's edits */
+    size_t n_runs = 0;
+    size_t *run = malloc((count + 1) * sizeof(size_t));
+    if (!run) return -1;
+
+    for (size_t k = 0; k < count; k++) {
+        if (k == 0 || edits[k].row != edits[k - 1].row) run[n_runs++] = k;
+    }
+    run[n_runs] = count;
+
+    bool compacted = false;
+    if (make_room(g, edits, run, n_runs, &compacted) != 0) {
+        free(run);
+        return -1;
+    }
+
+    /* Rows are independent */
+    long delta = 0, runs = (long)n_runs;
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:delta)
+    for (long r = 0; r < runs; r++) {
+        /* Two steps: a row's offset must arrive before the row can be fetched */
+        if (r + 2 * GRAPH_EDIT_AHEAD < runs) {
+            size_t ahead = edits[run[r + 2 * GRAPH_EDIT_AHEAD]].row;
+            GRAPH_PREFETCH(&g->offsets[ahead]);
+            GRAPH_PREFETCH(&g->degree[ahead]);
+        }
+        if (r + GRAPH_EDIT_AHEAD < runs) {
+            size_t ahead = edits[run[r + GRAPH_EDIT_AHEAD]].row;
+            GRAPH_PREFETCH(g->adj + g->offsets[ahead]);
+        }
+        delta += edit_row(g, edits + run[r], run[r + 1] - run[r]);
+    }
+    g->m = (size_t)((long)g->m + delta);
+
+    free(run);
+
+    /* Compaction moved every row; otherwise only the edited rows changed */
+    if (!g->work) return 0;
+    return compacted ? graph_build_work(g) : graph_patch_work(g, edits, count);
+}
+
+/* ----------------------------------------------------
+   Generators
+---------------------------------------------------- */
+
+static inline uint64_t graph_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/* Uniform integer in [0, n) for n < 2^32 */
+static inline uint32_t graph_rand_below(uint64_t *state, size_t n)
+{
+    return (uint32_t)(((graph_rand(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/*
+ Preferential attachment: a clique on m+1 seed nodes, then every new node
+ links to m distinct existing nodes chosen proportionally to degree
+ (uniform picks from the list of all edge endpoints so far).
+*/
+static int generate_barabasi_albert(Graph *g, size_t n, int m, uint64_t seed)
+{
+    if (m < 1) {
+        fprintf(stderr, "graph: barabasi_albert needs degree >= 1\n");
+        return -1;
+    }
+
+    size_t core = (size_t)m + 1 < n ? (size_t)m + 1 : n;
+    size_t max_edges = core * (core - 1) / 2 + (n - core) * (size_t)m;
+
+    size_t cap = max_edges ? max_edges : 1;
+
+    uint32_t *edges = malloc(2 * cap * sizeof(uint32_t));
+    uint32_t *ends = malloc(2 * cap * sizeof(uint32_t));
+    uint32_t *picked = malloc((size_t)m * sizeof(uint32_t));
+    if (!edges || !ends || !picked) {
+        free(edges); free(ends); free(picked);
+        return -1;
+    }
+
+    size_t e = 0, n_ends = 0;
+    for (size_t i = 0; i < core; i++) {
+        for (size_t j = i + 1; j < core; j++) {
+            edges[2 * e] = (uint32_t)i;
+            edges[2 * e + 1] = (uint32_t)j;
+            e++;
+            ends[n_ends++] = (uint32_t)i;
+            ends[n_ends++] = (uint32_t)j;
+        }
+    }
+
+    uint64_t state = seed ? seed : 1;
+    for (size_t t = core; t < n; t++) {
+        int k = 0;
+        while (k < m) {
+            uint32_t target = ends[graph_rand_below(&state, n_ends)];
+            bool dup = false;
+            for (int j = 0; j < k; j++) dup |= (picked[j] == target);
+            if (!dup) picked[k++] = target;
+        }
+        for (int j = 0; j < m; j++) {
+            edges[2 * e] = (uint32_t)t;
+            edges[2 * e + 1] = picked[j];
+            e++;
+            ends[n_ends++] = (uint32_t)t;
+            ends[n_ends++] = picked[j];
+        }
+    }
+
+    int rc = graph_from_edges(g, n, edges, e, GRAPH_SYMMETRIZE | GRAPH_DEDUP);
+    free(edges); free(ends); free(picked);
+    return rc;
+}
+
+/*
+ Watts–Strogatz: ring lattice where each node links to its degree/2
+ successors; each link is rewired to a uniform random node with
+ probability p (duplicates are merged by graph_from_edges).
+*/
+static int generate_small_world(Graph *g, size_t n, int degree, double p, uint64_t seed)
+{
+    if (degree < 2 || degree % 2 != 0 || (size_t)degree >= n) {
+        fprintf(stderr, "graph: small_world needs an even degree in [2, num_agents)\n");
+        return -1;
+    }
+
+    size_t half = (size_t)degree / 2;
+    size_t n_edges = n * half;
+    uint32_t *edges = malloc(2 * n_edges * sizeof(uint32_t));
+    if (!edges) return -1;
+
+    uint64_t state = seed ? seed : 1;
+    size_t e = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 1; j <= half; j++) {
+            uint32_t to = (uint32_t)((i + j) % n);
+            double u = (graph_rand(&state) >> 11) * (1.0 / 9007199254740992.0);
+            if (u < p) {
+                do { to = graph_rand_below(&state, n); } while (to == i);
+            }
+            edges[2 * e] = (uint32_t)i;
+            edges[2 * e + 1] = to;
+            e++;
+        }
+    }
+
+    int rc = graph_from_edges(g, n, edges, e, GRAPH_SYMMETRIZE | GRAPH_DEDUP);
+    free(edges);
+    return rc;
+}
+
+int graph_generate(Graph *g, const NetworkConfig *cfg, size_t n, uint64_t seed)
+{
+    memset(g, 0, sizeof(Graph));
+
+    if (n > UINT32_MAX) {
+        fprintf(stderr, "graph: too many nodes for 32-bit ids\n");
+        return -1;
+    }
+
+    switch (cfg->kind) {
+        case NETWORK_BARABASI_ALBERT:
+            return generate_barabasi_albert(g, n, cfg->degree, seed);
+        case NETWORK_SMALL_WORLD:
+            return generate_small_world(g, n, cfg->degree, cfg->rewire_prob, seed);
+        case NETWORK_FILE:
+            fprintf(stderr, "graph: file networks are loaded by graphfile_load\n");
+            return -1;
+        case NETWORK_NONE:
+        default:
+            return 0;
+    }
+}
+
+/* ----------------------------------------------------
+   Neighbor gather
+---------------------------------------------------- */
+
+/*
+ Sum x over a compressed row. Whole groups of four are decoded
+ unrolled: the control byte alone gives all four value offsets, and ids
+ follow by a running prefix sum. Accumulation order matches the plain
+ row, so results are bit-identical.
+*/
+static double packed_row_sum(const Graph *g, size_t i, const double *x)
+{
+    size_t d = graph_degree(g, i);
+    const unsigned char *ctrl = g->packed + g->packed_offsets[i];
+    const unsigned char *data = ctrl + (d + 3) / 4;
+    uint32_t id = (uint32_t)i;
+    double sum = 0.0;
+    size_t k = 0;
+
+    for (; k + 4 <= d; k += 4) {
+        unsigned c = ctrl[k / 4];
+        unsigned l0 = (c & 3) + 1, l1 = ((c >> 2) & 3) + 1;
+        unsigned l2 = ((c >> 4) & 3) + 1, l3 = (c >> 6) + 1;
+
+        uint32_t w0, w1, w2, w3;
+        memcpy(&w0, data, 4);
+        memcpy(&w1, data + l0, 4);
+        memcpy(&w2, data + l0 + l1, 4);
+        memcpy(&w3, data + l0 + l1 + l2, 4);
+        data += l0 + l1 + l2 + l3;
+
+        w0 &= PACKED_MASK[c & 3];
+        uint32_t i0 = (k == 0) ? id + unzigzag32(w0) : id + w0 + 1;
+        uint32_t i1 = i0 + (w1 & PACKED_MASK[(c >> 2) & 3]) + 1;
+        uint32_t i2 = i1 + (w2 & PACKED_MASK[(c >> 4) & 3]) + 1;
+        uint32_t i3 = i2 + (w3 & PACKED_MASK[c >> 6]) + 1;
+        id = i3;
+
+        sum += x[i0];
+        sum += x[i1];
+        sum += x[i2];
+        sum += x[i3];
+    }
+
+    for (; k < d; k++) {
+        unsigned code = (ctrl[k / 4] >> (2 * (k % 4))) & 3;
+        uint32_t w;
+        memcpy(&w, data, 4);
+        w &= PACKED_MASK[code];
+        data += code + 1;
+
+        id = (k == 0) ? id + unzigzag32(w) : id + w + 1;
+        sum += x[id];
+    }
+    return sum;
+}
+
+/* One-at-a-time decoder for compressed rows (paths that do more work per
+   neighbor than a single add, where decode speed matters less) */
+typedef struct PackedCursor {
+    const unsigned char *ctrl;
+    const unsigned char *data;
+    uint32_t id;
+    size_t k;
+} PackedCursor;
+
+static inline void packed_cursor_init(PackedCursor *c, const Graph *g, size_t i)
+{
+    c->ctrl = g->packed + g->packed_offsets[i];
+    c->data = c->ctrl + (graph_degree(g, i) + 3) / 4;
+    c->id = (uint32_t)i;
+    c->k = 0;
+}
+
+static inline uint32_t packed_next(PackedCursor *c)
+{
+    unsigned code = (c->ctrl[c->k / 4] >> (2 * (c->k % 4))) & 3;
+    uint32_t w;
+    memcpy(&w, c->data, 4);
+    w &= PACKED_MASK[code];
+    c->data += code + 1;
+
+    c->id = (c->k == 0) ? c->id + unzigzag32(w) : c->id + w + 1;
+    c->k++;
+    return c->id;
+}
+
+/* Row i's sample (graph_sample_hubs), or NULL if the row is averaged exactly */
+static inline const uint32_t *row_sample(const Graph *g, size_t i)
+{
+    if (!g->hub_sample || graph_degree(g, i) <= g->sample_above) return NULL;
+
+    size_t lo = 0, hi = g->n_hubs;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g->hubs[mid] < i) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == g->n_hubs || g->hubs[lo] != i) return NULL;   /* grown since the draw */
+    return g->hub_sample + lo * g->sample_size;
+}
+
+static inline double sample_mean(const Graph *g, const double *x, const uint32_t *sample)
+{
+    double sum = 0.0;
+    for (size_t k = 0; k < g->sample_size; k++) sum += x[sample[k]];
+    return sum / (double)g->sample_size;
+}
+
+static inline double row_mean(const Graph *g, const double *x, size_t i)
+{
+    uint64_t lo = g->offsets[i], hi = graph_row_end(g, i);
+    if (lo == hi) return x[i];
+
+    const uint32_t *sample = row_sample(g, i);
+    if (sample) return sample_mean(g, x, sample);
+
+    double sum = 0.0;
+    if (graph_is_compressed(g)) {
+        sum = packed_row_sum(g, i, x);
+    }
+    else {
+        for (uint64_t k = lo; k < hi; k++) sum += x[g->adj[k]];
+    }
+    return sum / (double)(hi - lo);
+}
+
+void graph_neighbor_mean_range(const Graph *g, const double *x,
+                               size_t first, size_t last, double *out)
+{
+    long from = (long)first, to = (long)last;
+
+    /* Degrees are skewed (hubs), so hand out rows in small chunks */
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = from; i < to; i++) out[i] = row_mean(g, x, (size_t)i);
+}
+
+void graph_neighbor_mean_rows(const Graph *g, const double *x,
+                              const uint32_t *rows, size_t count, double *out)
+{
+    long n = (long)count;
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long t = 0; t < n; t++) out[t] = row_mean(g, x, rows[t]);
+}
+
+/* ----------------------------------------------------
+   Edge-balanced gather
+---------------------------------------------------- */
+
+void graph_work_clear(Graph *g)
+{
+    free(g->work);
+    free(g->work_part);
+    g->work = NULL;
+    g->work_part = NULL;
+    g->n_work = g->n_frags = 0;
+}
+
+static int push_work(Graph *g, size_t *cap, const GraphWork *w)
+{
+    if (g->n_work == *cap) {
+        GraphWork *grown = realloc(g->work, 2 * *cap * sizeof(GraphWork));
+        if (!grown) return -1;
+        g->work = grown;
+        *cap *= 2;
+    }
+    g->work[g->n_work++] = *w;
+    return 0;
+}
+
+int graph_build_work(Graph *g)
+{
+    graph_work_clear(g);
+
+    size_t n = g->n, cap = 64, cost = 0;
+    uint32_t begin = 0;
+    bool packed = graph_is_compressed(g);
+
+    g->work = malloc(cap * sizeof(GraphWork));
+    if (!g->work) return -1;
+
+    for (size_t i = 0; i < n; i++) {
+        size_t d = row_sample(g, i) ? g->sample_size : graph_degree(g, i);
+
+        if (d <= GRAPH_WORK_CHUNK) {
+            cost += 1 + d;
+            if (cost >= GRAPH_WORK_CHUNK) {
+                GraphWork w = { .row_begin = begin, .row_end = (uint32_t)i + 1,
+                                .frag = GRAPH_WORK_ROWS };
+                if (push_work(g, &cap, &w) != 0) goto fail;
+                begin = (uint32_t)i + 1;
+                cost = 0;
+            }
+            continue;
+        }
+
+        /* Hub: close the rows so far, then equal fragments of this row */
+        if (begin < i) {
+            GraphWork w = { .row_begin = begin, .row_end = (uint32_t)i,
+                            .frag = GRAPH_WORK_ROWS };
+            if (push_work(g, &cap, &w) != 0) goto fail;
+        }
+
+        size_t pieces = (d + GRAPH_WORK_CHUNK - 1) / GRAPH_WORK_CHUNK;
+        uint64_t lo = g->offsets[i];
+        PackedCursor c = { 0 };
+        if (packed) packed_cursor_init(&c, g, i);
+
+        for (size_t p = 0; p < pieces; p++) {
+            GraphWork w = {
+                .row_begin = (uint32_t)i, .row_end = (uint32_t)i + 1,
+                .frag = (uint32_t)g->n_frags++,
+                .edge_begin = lo + d * p / pieces,
+                .edge_end = lo + d * (p + 1) / pieces
+            };
+            if (packed) {
+                w.packed_at = (uint64_t)(c.data - g->packed);
+                w.id_at = c.id;
+                for (uint64_t e = w.edge_begin; e < w.edge_end; e++) packed_next(&c);
+            }
+            if (push_work(g, &cap, &w) != 0) goto fail;
+        }
+
+        begin = (uint32_t)i + 1;
+        cost = 0;
+    }
+
+    if (begin < n) {
+        GraphWork w = { .row_begin = begin, .row_end = (uint32_t)n,
+                        .frag = GRAPH_WORK_ROWS };
+        if (push_work(g, &cap, &w) != 0) goto fail;
+    }
+
+    /* Fragment partials; without them the combine pass sums the fragments */
+    if (g->n_frags) g->work_part = malloc(g->n_frags * sizeof(double));
+    return 0;
+
+fail:
+    graph_work_clear(g);
+    return -1;
+}
+
+int graph_patch_work(Graph *g, const GraphEdit *edits, size_t count)
+{
+    if (!g->work) return 0;
+
+    /* Edits and items are both in row order: one merged walk */
+    size_t t = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (k > 0 && edits[k].row == edits[k - 1].row) continue;
+
+        size_t i = edits[k].row;
+        while (t < g->n_work && g->work[t].row_end <= i) t++;
+
+        size_t d = row_sample(g, i) ? g->sample_size : graph_degree(g, i);
+        size_t pieces = d > GRAPH_WORK_CHUNK ? (d + GRAPH_WORK_CHUNK - 1) / GRAPH_WORK_CHUNK : 0;
+
+        size_t have = 0;
+        while (t + have < g->n_work && g->work[t + have].row_begin == i &&
+               g->work[t + have].frag != GRAPH_WORK_ROWS) have++;
+
+        /* A row became or stopped being a hub, or changed its piece count */
+        if (have != pieces) return graph_build_work(g);
+
+        /* Same split points as graph_build_work, at the row's current place */
+        uint64_t lo = g->offsets[i];
+        for (size_t p = 0; p < pieces; p++) {
+            g->work[t + p].edge_begin = lo + d * p / pieces;
+            g->work[t + p].edge_end = lo + d * (p + 1) / pieces;
+        }
+    }
+    return 0;
+}
+
+/* Decoder positioned at the first entry of a fragment */
+static inline void fragment_cursor(PackedCursor *c, const Graph *g, const GraphWork *w)
+{
+    size_t i = w->row_begin;
+    c->ctrl = g->packed + g->packed_offsets[i];
+    c->data = g->packed + w->packed_at;
+    c->id = w->id_at;
+    c->k = (size_t)(w->edge_begin - g->offsets[i]);
+}
+
+static double fragment_sum(const Graph *g, const GraphWork *w, const double *x)
+{
+    double sum = 0.0;
+
+    if (graph_is_compressed(g)) {
+        PackedCursor c;
+        fragment_cursor(&c, g, w);
+        for (uint64_t e = w->edge_begin; e < w->edge_end; e++) sum += x[packed_next(&c)];
+    }
+    else {
+        for (uint64_t e = w->edge_begin; e < w->edge_end; e++) sum += x[g->adj[e]];
+    }
+    return sum;
+}
+
+static void neighbor_mean_work(const Graph *g, const double *x, double *out)
+{
+    const GraphWork *work = g->work;
+    const uint64_t *off = g->offsets;
+    long n_work = (long)g->n_work;
+
+    /* Fragment partials (graph_build_work); NULL => summed in the combine pass */
+    double *part = g->work_part;
+
+    /* Items cost about the same: hand them out one at a time */
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long t = 0; t < n_work; t++) {
+        const GraphWork *w = &work[t];
+        if (w->frag != GRAPH_WORK_ROWS) {
+            if (part) part[w->frag] = fragment_sum(g, w, x);
+            continue;
+        }
+        for (size_t i = w->row_begin; i < w->row_end; i++) out[i] = row_mean(g, x, i);
+    }
+
+    /* Hub rows: fragments in order, whatever thread computed them */
+    double sum = 0.0;
+    for (size_t t = 0; t < g->n_work; t++) {
+        const GraphWork *w = &work[t];
+        if (w->frag == GRAPH_WORK_ROWS) continue;
+
+        size_t i = w->row_begin;
+        double v = part ? part[w->frag] : fragment_sum(g, w, x);
+        sum = (w->edge_begin == off[i]) ? v : sum + v;
+        if (w->edge_end == graph_row_end(g, i)) out[i] = sum / (double)graph_degree(g, i);
+    }
+}
+
+void graph_neighbor_mean(const Graph *g, const double *x, double *out)
+{
+    if (g->work)
+        neighbor_mean_work(g, x, out);
+    else
+        graph_neighbor_mean_range(g, x, 0, g->n, out);
+}
+
+size_t graph_row(const Graph *g, size_t i, uint32_t *out)
+{
+    size_t d = graph_degree(g, i);
+
+    if (!graph_is_compressed(g)) {
+        memcpy(out, g->adj + g->offsets[i], d * sizeof(uint32_t));
+        return d;
+    }
+
+    PackedCursor c;
+    packed_cursor_init(&c, g, i);
+    for (size_t k = 0; k < d; k++) out[k] = packed_next(&c);
+    return d;
+}
+
+/* Unscaled sums of edges [lo, hi) for k vectors, interleaved 'stride' apart */
+static void sum_k(const Graph *g, const double *x, size_t stride, size_t k,
+                  uint64_t lo, uint64_t hi, PackedCursor *c, double *o)
+{
+    for (size_t r = 0; r < k; r++) o[r] = 0.0;
+
+    if (c) {
+        for (uint64_t e = lo; e < hi; e++) {
+            const double *xj = x + (size_t)packed_next(c) * stride;
+            for (size_t r = 0; r < k; r++) o[r] += xj[r];
+        }
+    }
+    else {
+        for (uint64_t e = lo; e < hi; e++) {
+            const double *xj = x + (size_t)g->adj[e] * stride;
+            for (size_t r = 0; r < k; r++) o[r] += xj[r];
+        }
+    }
+}
+
+static void row_mean_k(const Graph *g, const double *x, size_t k, size_t i, double *o)
+{
+    uint64_t lo = g->offsets[i], hi = graph_row_end(g, i);
+
+    if (lo == hi) {
+        memcpy(o, x + i * k, k * sizeof(double));
+        return;
+    }
+
+    const uint32_t *sample = row_sample(g, i);
+    if (sample) {
+        for (size_t r = 0; r < k; r++) o[r] = 0.0;
+        for (size_t e = 0; e < g->sample_size; e++) {
+            const double *xj = x + (size_t)sample[e] * k;
+            for (size_t r = 0; r < k; r++) o[r] += xj[r];
+        }
+        for (size_t r = 0; r < k; r++) o[r] /= (double)g->sample_size;
+        return;
+    }
+
+    PackedCursor c;
+    if (graph_is_compressed(g)) packed_cursor_init(&c, g, i);
+    sum_k(g, x, k, k, lo, hi, graph_is_compressed(g) ? &c : NULL, o);
+
+    double deg = (double)(hi - lo);
+    for (size_t r = 0; r < k; r++) o[r] /= deg;
+}
+
+/* Sums of one fragment for vectors r0 .. r0+kb-1 of the k */
+static void fragment_sum_k(const Graph *g, const GraphWork *w, const double *x,
+                           size_t k, size_t r0, size_t kb, double *o)
+{
+    PackedCursor c;
+    if (graph_is_compressed(g)) fragment_cursor(&c, g, w);
+    sum_k(g, x + r0, k, kb, w->edge_begin, w->edge_end,
+          graph_is_compressed(g) ? &c : NULL, o);
+}
+
+static inline void combine_k(double *o, const double *v, size_t k, bool first)
+{
+    if (first)
+        memcpy(o, v, k * sizeof(double));
+    else
+        for (size_t r = 0; r < k; r++) o[r] += v[r];
+}
+
+/* Vectors per fragment pass when there is no memory for the partials */
+#define FRAGMENT_COLUMNS 32
+
+/* neighbor_mean_work() for k vectors; same items, same combine order */
+static void neighbor_mean_work_k(const Graph *g, const double *x, size_t k, double *out)
+{
+    const GraphWork *work = g->work;
+    const uint64_t *off = g->offsets;
+    long n_work = (long)g->n_work;
+
+    /* Without scratch, fragments are summed in the combine pass below */
+    double *part = g->n_frags ? malloc(g->n_frags * k * sizeof(double)) : NULL;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long t = 0; t < n_work; t++) {
+        const GraphWork *w = &work[t];
+        if (w->frag != GRAPH_WORK_ROWS) {
+            if (part) fragment_sum_k(g, w, x, k, 0, k, part + (size_t)w->frag * k);
+            continue;
+        }
+        for (size_t i = w->row_begin; i < w->row_end; i++) row_mean_k(g, x, k, i, out + i * k);
+    }
+
+    for (size_t t = 0; t < g->n_work; t++) {
+        const GraphWork *w = &work[t];
+        if (w->frag == GRAPH_WORK_ROWS) continue;
+
+        size_t i = w->row_begin;
+        double *o = out + i * k;
+        bool first = (w->edge_begin == off[i]);
+
+        if (part) {
+            combine_k(o, part + (size_t)w->frag * k, k, first);
+        }
+        else {
+            double v[FRAGMENT_COLUMNS];
+            for (size_t r0 = 0; r0 < k; r0 += FRAGMENT_COLUMNS) {
+                size_t kb = k - r0 < FRAGMENT_COLUMNS ? k - r0 : FRAGMENT_COLUMNS;
+                fragment_sum_k(g, w, x, k, r0, kb, v);
+                combine_k(o + r0, v, kb, first);
+            }
+        }
+
+        if (w->edge_end == graph_row_end(g, i)) {
+            double deg = (double)graph_degree(g, i);
+            for (size_t r = 0; r < k; r++) o[r] /= deg;
+        }
+    }
+
+    free(part);
+}
+
+void graph_neighbor_mean_k(const Graph *g, const double *x, size_t k, double *out)
+{
+    if (g->work) {
+        neighbor_mean_work_k(g, x, k, out);
+        return;
+    }
+
+    long n = (long)g->n;
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < n; i++) row_mean_k(g, x, k, (size_t)i, out + (size_t)i * k);
+}
+
+/* ----------------------------------------------------
+   Sampled hub rows
+---------------------------------------------------- */
+
+/* Set of drawn row positions: 2 * GRAPH_WORK_CHUNK open-addressing slots */
+#define SAMPLE_SET_BITS  12
+#define SAMPLE_SET_EMPTY UINT32_MAX
+
+static bool sample_set_add(uint32_t *set, uint32_t v)
+{
+    uint32_t mask = (1u << SAMPLE_SET_BITS) - 1;
+    uint32_t h = (v * 0x9E3779B1u) >> (32 - SAMPLE_SET_BITS);
+
+    while (set[h] != SAMPLE_SET_EMPTY) {
+        if (set[h] == v) return false;
+        h = (h + 1) & mask;
+    }
+    set[h] = v;
+    return true;
+}
+
+/*
+ 'size' distinct entries of row i, in row order. Floyd's algorithm draws
+ the positions in O(size) whatever the degree; only compressed rows are
+ walked up to the last one.
+*/
+static void draw_sample(const Graph *g, size_t i, size_t size, uint64_t seed, uint32_t *out)
+{
+    uint32_t set[1u << SAMPLE_SET_BITS];
+    size_t d = graph_degree(g, i), k = 0;
+    uint64_t rng = hash_derive_seed(seed, i);
+    if (rng == 0) rng = 1;
+
+    memset(set, 0xFF, sizeof(set));
+    for (size_t j = d - size; j < d; j++) {
+        uint32_t t = graph_rand_below(&rng, j + 1);
+        if (!sample_set_add(set, t)) {
+            t = (uint32_t)j;
+            sample_set_add(set, t);
+        }
+        out[k++] = t;
+    }
+    sort_row(out, size);
+
+    if (graph_is_compressed(g)) {
+        PackedCursor c;
+        packed_cursor_init(&c, g, i);
+        uint32_t id = 0;
+        size_t at = 0;
+        for (k = 0; k < size; k++) {
+            while (at <= out[k]) {
+                id = packed_next(&c);
+                at++;
+            }
+            out[k] = id;
+        }
+    }
+    else {
+        const uint32_t *row = g->adj + g->offsets[i];
+        for (k = 0; k < size; k++) out[k] = row[out[k]];
+    }
+}
+
+void graph_sample_clear(Graph *g)
+{
+    bool had = g->hub_sample != NULL;
+
+    free(g->hubs);
+    free(g->hub_sample);
+    g->hubs = g->hub_sample = NULL;
+    g->n_hubs = 0;
+    g->sample_above = g->sample_size = 0;
+
+    if (had && g->work) graph_build_work(g);
+}
+
+int graph_sample_hubs(Graph *g, size_t above, size_t size, uint64_t seed)
+{
+    if (size == 0 || size > GRAPH_WORK_CHUNK || size >= above) {
+        fprintf(stderr, "graph: hub samples need 1 <= size <= %d and size < threshold\n",
+                GRAPH_WORK_CHUNK);
+        return -1;
+    }
+
+    size_t n = g->n, n_hubs = 0;
+    for (size_t i = 0; i < n; i++) n_hubs += graph_degree(g, i) > above;
+
+    uint32_t *hubs = malloc((n_hubs ? n_hubs : 1) * sizeof(uint32_t));
+    uint32_t *sample = malloc((n_hubs ? n_hubs : 1) * size * sizeof(uint32_t));
+    if (!hubs || !sample) {
+        free(hubs); free(sample);
+        return -1;
+    }
+
+    n_hubs = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (graph_degree(g, i) > above) hubs[n_hubs++] = (uint32_t)i;
+    }
+
+    long count = (long)n_hubs;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long h = 0; h < count; h++) {
+        draw_sample(g, hubs[h], size, seed, sample + (size_t)h * size);
+    }
+
+    /* The schedule counts sampled rows at their sample size */
+    bool same = g->hub_sample && g->n_hubs == n_hubs && g->sample_size == size &&
+                memcmp(g->hubs, hubs, n_hubs * sizeof(uint32_t)) == 0;
+
+    free(g->hubs);
+    free(g->hub_sample);
+    g->hubs = hubs;
+    g->hub_sample = sample;
+    g->n_hubs = n_hubs;
+    g->sample_above = above;
+    g->sample_size = size;
+
+    if (!same && g->work) return graph_build_work(g);
+    return 0;
+}
+
+size_t graph_sample_error(const Graph *g, const double *x,
+                          double *sum_abs, double *max_abs)
+{
+    size_t n_hubs = g->hub_sample ? g->n_hubs : 0;
+    double *err = malloc((n_hubs ? n_hubs : 1) * sizeof(double));
+
+    *sum_abs = *max_abs = 0.0;
+    if (!err) return 0;
+
+    long count = (long)n_hubs;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long h = 0; h < count; h++) {
+        size_t i = g->hubs[h];
+        size_t d = graph_degree(g, i);
+        double sum = 0.0;
+
+        if (graph_is_compressed(g)) {
+            sum = packed_row_sum(g, i, x);
+        }
+        else {
+            for (uint64_t e = g->offsets[i]; e < graph_row_end(g, i); e++) sum += x[g->adj[e]];
+        }
+
+        const uint32_t *sample = g->hub_sample + (size_t)h * g->sample_size;
+        err[h] = d ? fabs(sample_mean(g, x, sample) - sum / (double)d) : 0.0;
+    }
+
+    /* In row order, whatever thread computed them */
+    for (size_t h = 0; h < n_hubs; h++) {
+        *sum_abs += err[h];
+        if (err[h] > *max_abs) *max_abs = err[h];
+    }
+    free(err);
+    return n_hubs;
+}
@@ -0,0 +1,345 @@
+#ifndef JUMPSIM_GRAPH_H
+#define JUMPSIM_GRAPH_H
+
+/*
+ * graph.h
+ * -------
+ * Social network between agents, stored in compressed sparse row (CSR)
+ * form: the neighbors of node i are adj[offsets[i] .. offsets[i+1]).
+ *
+ * Design goals:
+ *  - One contiguous adjacency array, no per-agent neighbor allocations
+ *  - Undirected graphs stored symmetrically (each edge in both rows);
+ *    row i of a directed graph lists the nodes i listens to
+ *  - Rows sorted, no self loops (duplicates merged unless asked not to)
+ *  - Generators are deterministic functions of (n, parameters, seed)
+ *
+ * Node ids are agent indices into the population columns. Empirical
+ * graphs are loaded from binary edge lists by graphfile.h; their arrays
+ * may then live in a read-only file mapping shared between processes.
+ *
+ * Compressed rows (graph_compress): for billion-edge graphs the 4-byte
+ * adjacency dominates memory traffic. Each sorted row is re-encoded as
+ *   zigzag(first - i), then (next - prev - 1) for the rest
+ * in 1-4 byte values whose lengths sit in a separate 2-bit control array
+ * (stream-vbyte style), so decoding has no data-dependent branches or
+ * pointer chains. With local ids (natural ring order, or reorder.h) most
+ * gaps fit in one byte. 'offsets' is kept for degrees.
+ *
+ * Rows with slack (graph_reserve): a network that rewires while the
+ * simulation runs (rewire.h) cannot afford a rebuild per change. Row i
+ * then starts at offsets[i] with room[i] entries of space, degree[i] of
+ * them in use, so edits shift entries within one row only. A row that
+ * outgrows its room moves to free space at the end of 'adj' with twice
+ * the room; when that runs out, all rows are laid out afresh in order
+ * (compaction). Offsets are then no longer ascending.
+ *
+ * Sampled hub rows (graph_sample_hubs): the exact mean over a hub's 1e5+
+ * followers costs as much as thousands of ordinary rows and barely moves
+ * when one follower does. Rows longer than a threshold can instead be
+ * averaged over a fixed random sample of their entries, redrawn by the
+ * caller every few steps. The sample mean is unbiased; its standard error
+ * is the spread of the neighbors' values over sqrt(sample size).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* -------------------- Types & Constants -------------------- */
+
+typedef enum {
+    NETWORK_NONE = 0,          /* no social network: herding term is zero */
+    NETWORK_BARABASI_ALBERT,   /* preferential attachment, 'degree' edges per new node */
+    NETWORK_SMALL_WORLD,       /* Watts–Strogatz ring, 'degree' neighbors, rewired */
+    NETWORK_FILE               /* empirical edge list, see graphfile.h */
+} NetworkKind;
+
+/* Node order applied at setup (see reorder.h) */
+typedef enum {
+    GRAPH_ORDER_NONE = 0,
+    GRAPH_ORDER_DEGREE,        /* descending degree: hubs packed together */
+    GRAPH_ORDER_RCM            /* reverse Cuthill–McKee: small bandwidth */
+} GraphOrder;
+
+#define GRAPH_PATH_MAX 512
+
+/* How rewiring agents rank peers (see rewire.h) */
+typedef enum {
+    REWIRE_NONE = 0,
+    REWIRE_PNL,                /* follow the wealthiest (mark-to-market) */
+    REWIRE_BELIEF              /* follow those who think alike */
+} RewireRule;
+
+/* "network.rewire" section: rewiring while the simulation runs */
+typedef struct RewireConfig {
+    RewireRule rule;
+    int every;                 /* steps between rewiring rounds */
+    double rate;               /* fraction of links rewired per round */
+    int candidates;            /* peers sampled per choice (tournament size) */
+    double slack;              /* spare row capacity, fraction of the degree */
+} RewireConfig;
+
+/* "network.hub_sample" section: approximate gather for hubs */
+typedef struct HubSampleConfig {
+    int above;                 /* rows with more neighbors are sampled; 0 = exact */
+    int size;                  /* sampled neighbors per hub */
+    int every;                 /* steps between redraws */
+} HubSampleConfig;
+
+/* What the herding term averages */
+typedef enum {
+    HERDING_NEIGHBORS = 0,     /* mean belief of the agent's neighbors */
+    HERDING_COMMUNITY          /* community and global means (see community.h) */
+} HerdingMode;
+
+/* "network.community" section: community detection and blending */
+typedef struct CommunityConfig {
+    int passes;                /* label propagation passes, at most */
+    double global_weight;      /* weight of the global mean against the community's */
+} CommunityConfig;
+
+/* "network" section of the experiment config */
+typedef struct NetworkConfig {
+    NetworkKind kind;
+    int degree;                /* BA: edges per new node; small world: ring degree (even) */
+    double rewire_prob;        /* small world only */
+    GraphOrder order;
+    bool compress;             /* store rows delta + varint encoded */
+
+    /* NETWORK_FILE only */
+    char edges[GRAPH_PATH_MAX];   /* binary edge list */
+    char cache[GRAPH_PATH_MAX];   /* built CSR, reused while the edge list is unchanged */
+    bool symmetrize;              /* store every edge in both rows */
+    bool dedup;                   /* merge repeated edges */
+
+    RewireConfig rewire;
+    HubSampleConfig hub_sample;
+    HerdingMode herding;
+    CommunityConfig community;
+} NetworkConfig;
+
+/* graph_from_edges() flags */
+#define GRAPH_SYMMETRIZE 0x1u
+#define GRAPH_DEDUP      0x2u
+
+/* Readable zero bytes after the compressed rows (4-byte decode loads) */
+#define GRAPH_PACKED_PAD 4
+
+/* Target cost (rows + adjacency entries) of one gather work item */
+#define GRAPH_WORK_CHUNK 2048
+
+/* Spare entries every row with slack gets at least */
+#define GRAPH_SLACK_MIN 4
+
+/* GraphWork.frag of an item made of whole rows */
+#define GRAPH_WORK_ROWS UINT32_MAX
+
+/*
+ * One unit of gather work: whole rows row_begin .. row_end-1, or one
+ * fragment of a hub row (row_begin) covering adjacency entries
+ * edge_begin .. edge_end-1. A fragment of a compressed row also keeps
+ * where decoding resumes (byte offset into 'packed', previous id).
+ */
+typedef struct GraphWork {
+    uint32_t row_begin, row_end;
+    uint32_t frag;             /* fragment index, or GRAPH_WORK_ROWS */
+    uint32_t id_at;
+    uint64_t edge_begin, edge_end;
+    uint64_t packed_at;
+} GraphWork;
+
+typedef struct Graph {
+    size_t n;                  /* nodes */
+    size_t m;                  /* adjacency entries (2x undirected edges) */
+    uint64_t *offsets;         /* n + 1 entries */
+    uint32_t *adj;             /* m entries; NULL once compressed */
+    unsigned char *packed;     /* compressed rows, NULL unless compressed */
+    uint64_t *packed_offsets;  /* n + 1 byte offsets into 'packed' */
+
+    /* Edge-balanced gather schedule (graph_build_work), NULL if not built */
+    GraphWork *work;
+    size_t n_work;
+    size_t n_frags;
+    double *work_part;         /* n_frags partial sums (scratch of one gather at a time) */
+
+    /* Rows with slack (graph_reserve), NULL / 0 otherwise */
+    uint32_t *degree;          /* live entries per row */
+    uint32_t *room;            /* capacity per row */
+    uint64_t adj_end;          /* adj entries handed out to rows */
+    uint64_t adj_cap;          /* adj entries allocated */
+    double slack;
+
+    /* Sampled hub rows (graph_sample_hubs), NULL / 0 otherwise */
+    size_t sample_above;       /* rows with more entries are sampled */
+    size_t sample_size;        /* entries averaged per sampled row */
+    uint32_t *hubs;            /* sampled rows, ascending */
+    size_t n_hubs;
+    uint32_t *hub_sample;      /* n_hubs * sample_size neighbor ids, each run sorted */
+
+    /* Borrowed file mapping (not owned): arrays inside it are never freed */
+    const unsigned char *mapping;
+    size_t mapping_size;
+} Graph;
+
+/*
+ * One change of a batch (graph_apply_edits): add or remove 'col' in row
+ * 'row'. Edits of a row are applied in batch order; adding an entry that
+ * is present or removing one that is not does nothing.
+ */
+typedef struct GraphEdit {
+    uint32_t row, col;
+    uint32_t insert;           /* 1: add, 0: remove */
+} GraphEdit;
+
+/* -------------------- API (implemented in graph.c) -------------------- */
+
+/* Parse config names ("barabasi_albert", "rcm", ...). Return 0 / -1 */
+int network_kind_from_string(const char *s, NetworkKind *out);
+int graph_order_from_string(const char *s, GraphOrder *out);
+
+/*
+ * Build a CSR graph from 'n_edges' edges stored as (src, dst) pairs in
+ * 'edges' (2 * n_edges ids). An edge goes into row src; with
+ * GRAPH_SYMMETRIZE also into row dst, with GRAPH_DEDUP repeats are
+ * merged. Self loops and ids >= n are dropped and rows come out sorted.
+ * Parallel counting sort; the result does not depend on the thread
+ * count. Returns 0 / -1.
+ */
+int graph_from_edges(Graph *g, size_t n, const uint32_t *edges, size_t n_edges,
+                     unsigned flags);
+
+/* Generate the network described by 'cfg' over 'n' nodes */
+int graph_generate(Graph *g, const NetworkConfig *cfg, size_t n, uint64_t seed);
+
+void graph_free(Graph *g);
+
+/* True if 'p' was allocated by the graph (not inside a borrowed mapping) */
+static inline bool graph_owns(const Graph *g, const void *p) {
+    const unsigned char *c = (const unsigned char *)p;
+    return !(g->mapping && c >= g->mapping && c < g->mapping + g->mapping_size);
+}
+
+/*
+ * Replace the plain adjacency by compressed rows (see above).
+ * Operations that edit or relabel rows (graph_permute) must run before;
+ * rows with slack cannot be compressed.
+ * Returns 0 / -1.
+ */
+int graph_compress(Graph *g);
+
+static inline bool graph_is_compressed(const Graph *g) {
+    return g->packed != NULL;
+}
+
+/*
+ * Edge-balanced gather (merge-path style). Splitting rows evenly across
+ * threads leaves whoever holds the hubs of a scale-free graph with most
+ * of the work. This cuts the row/edge sequence into items of about
+ * GRAPH_WORK_CHUNK rows plus edges each, handed out dynamically, so no
+ * thread is left with more than one item of extra work. Rows longer than
+ * an item are split into fragments whose partial sums are combined in
+ * order afterwards: the split points depend on the graph only, so results
+ * do not depend on the thread count, and rows that are not split are
+ * summed exactly as before. Build after reordering and compression (both
+ * drop the schedule). Returns 0 / -1.
+ */
+int graph_build_work(Graph *g);
+
+/*
+ * Bring the schedule up to date after edits to the rows in 'edits'
+ * (grouped by row in ascending order, as graph_apply_edits leaves them):
+ * one walk over the edited rows and the items recuts the fragments of
+ * edited hub rows in place, with the same split points a rebuild would
+ * choose. Row items keep their bounds,
+ * so only their balance drifts until the next rebuild. A row that
+ * becomes or stops being a hub rebuilds the schedule. Returns 0 / -1
+ * (schedule dropped).
+ */
+int graph_patch_work(Graph *g, const GraphEdit *edits, size_t count);
+
+void graph_work_clear(Graph *g);
+
+/*
+ * Give every row spare capacity for edits: GRAPH_SLACK_MIN entries or
+ * 'slack' times its degree, whichever is more, plus 'slack' of the total
+ * as free space for rows that outgrow theirs. Calling it again compacts
+ * the rows. Rows must be plain. Returns 0 / -1.
+ */
+int graph_reserve(Graph *g, double slack);
+
+/*
+ * Apply a batch of edits to a graph with slack rows. 'edits' is grouped
+ * by row in place (stable radix sort, O(count)) and rows are edited in
+ * parallel, after moving those that would overflow. The gather schedule,
+ * if built, is patched for the edited rows (graph_patch_work), or rebuilt
+ * when the rows were compacted. Returns 0 / -1: the graph is unchanged,
+ * except when only the schedule could not be rebuilt (edits applied,
+ * schedule dropped), which callers must treat as fatal since the gather
+ * would then round hub rows differently.
+ */
+int graph_apply_edits(Graph *g, GraphEdit *edits, size_t count);
+
+/*
+ * (Re)draw the sampled hub rows: every row with more than 'above'
+ * entries is averaged over 'size' (<= GRAPH_WORK_CHUNK, < above) of
+ * them, distinct and drawn by a stream derived from (seed, row), so the
+ * draw does not depend on the thread count. Rows are selected anew on
+ * every call, so call again after edits or relabeling. The gather
+ * schedule, if built, is rebuilt when the set of sampled rows changes.
+ * Returns 0 / -1 (previous samples kept).
+ */
+int graph_sample_hubs(Graph *g, size_t above, size_t size, uint64_t seed);
+
+/* Back to exact averaging for every row */
+void graph_sample_clear(Graph *g);
+
+/*
+ * Error of the sampled rows against exact averaging of x: sum and
+ * maximum over those rows of |sample mean - exact mean|. Costs one exact
+ * gather of the sampled rows. Returns the number of rows compared.
+ */
+size_t graph_sample_error(const Graph *g, const double *x,
+                          double *sum_abs, double *max_abs);
+
+/* Bytes held by the adjacency structure (offsets + rows) */
+size_t graph_bytes(const Graph *g);
+
+static inline size_t graph_degree(const Graph *g, size_t i) {
+    if (g->degree) return g->degree[i];
+    return (size_t)(g->offsets[i + 1] - g->offsets[i]);
+}
+
+/* One past the last entry of row i (offsets[i+1] unless rows have slack) */
+static inline uint64_t graph_row_end(const Graph *g, size_t i) {
+    return g->offsets[i] + graph_degree(g, i);
+}
+
+/*
+ * Neighbor gather: out[i] = mean of x over i's neighbors, or x[i] for
+ * isolated nodes (so "neighbor mean - own value" is zero for them).
+ * Sampled hub rows average their sample instead. Uses the edge-balanced
+ * schedule when one has been built.
+ */
+void graph_neighbor_mean(const Graph *g, const double *x, double *out);
+
+/* The gather for rows first .. last-1 only (writes out[first .. last-1]),
+   row by row without the schedule */
+void graph_neighbor_mean_range(const Graph *g, const double *x,
+                               size_t first, size_t last, double *out);
+
+/* The gather for the listed rows only: out[t] is row rows[t]'s mean */
+void graph_neighbor_mean_rows(const Graph *g, const double *x,
+                              const uint32_t *rows, size_t count, double *out);
+
+/* Copy row i's neighbor ids (plain or compressed) into 'out'; returns the degree */
+size_t graph_row(const Graph *g, size_t i, uint32_t *out);
+
+/*
+ * Same gather for k interleaved vectors (x[i * k + r], as in a lockstep
+ * ensemble): each row is read once for all k. Per vector, results are
+ * bit-identical to graph_neighbor_mean.
+ */
+void graph_neighbor_mean_k(const Graph *g, const double *x, size_t k, double *out);
+
+#endif /* JUMPSIM_GRAPH_H */
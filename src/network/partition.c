@@ -0,0 +1,130 @@
+#include "partition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNASSIGNED UINT32_MAX
+
+/*
+ Streaming passes: later ones re-place every node knowing all of its
+ neighbors' shards (restreaming LDG). They need some room to move, hence
+ a small imbalance allowance over ceil(n / k).
+*/
+#define LDG_PASSES 4
+#define LDG_SLACK  0.02
+
+/* ----------------------------------------------------
+   Linear Deterministic Greedy
+---------------------------------------------------- */
+
+static int least_loaded(const size_t *size, int k)
+{
+    int best = 0;
+    for (int s = 1; s < k; s++) {
+        if (size[s] < size[best]) best = s;
+    }
+    return best;
+}
+
+int graph_partition_ldg(const Graph *g, int k, uint32_t *part)
+{
+    if (graph_is_compressed(g)) {
+        fprintf(stderr, "partition: partition the graph before compressing it\n");
+        return -1;
+    }
+    if (k < 1) return -1;
+
+    size_t n = g->n;
+    size_t even = (n + (size_t)k - 1) / (size_t)k;
+    size_t capacity = even + (size_t)((double)even * LDG_SLACK);
+    size_t *size = calloc((size_t)k, sizeof(size_t));
+    size_t *placed = calloc((size_t)k, sizeof(size_t));   /* neighbors of v per shard */
+    int *touched = malloc((size_t)k * sizeof(int));
+    if (!size || !placed || !touched) {
+        free(size); free(placed); free(touched);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) part[i] = UNASSIGNED;
+
+    for (int pass = 0; pass < LDG_PASSES; pass++) {
+        for (size_t v = 0; v < n; v++) {
+            /* Restreaming: v leaves its shard and is placed again */
+            if (part[v] != UNASSIGNED) {
+                size[part[v]]--;
+                part[v] = UNASSIGNED;
+            }
+
+            int n_touched = 0;
+            for (uint64_t e = g->offsets[v]; e < graph_row_end(g, v); e++) {
+                uint32_t p = part[g->adj[e]];
+                if (p == UNASSIGNED) continue;
+                if (placed[p]++ == 0) touched[n_touched++] = (int)p;
+            }
+
+            int best = -1;
+            double best_score = 0.0;
+
+            for (int t = 0; t < n_touched; t++) {
+                int s = touched[t];
+                if (size[s] < capacity) {
+                    double score = (double)placed[s] * (1.0 - (double)size[s] / (double)capacity);
+                    if (score > best_score ||
+                        (score == best_score && best >= 0 &&
+                         (size[s] < size[best] || (size[s] == size[best] && s < best)))) {
+                        best = s;
+                        best_score = score;
+                    }
+                }
+                placed[s] = 0;
+            }
+
+            /* No placed neighbors (or all their shards full): balance */
+            if (best < 0) best = least_loaded(size, k);
+
+            part[v] = (uint32_t)best;
+            size[best]++;
+        }
+    }
+
+    free(size);
+    free(placed);
+    free(touched);
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Relabeling & quality
+---------------------------------------------------- */
+
+int graph_partition_order(const uint32_t *part, size_t n, int k,
+                          uint32_t *perm, size_t *start)
+{
+    size_t *next = malloc((size_t)k * sizeof(size_t));
+    if (!next) return -1;
+
+    memset(start, 0, ((size_t)k + 1) * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) start[part[i] + 1]++;
+    for (int s = 0; s < k; s++) start[s + 1] += start[s];
+
+    /* Counting sort; within a shard the previous order is kept */
+    memcpy(next, start, (size_t)k * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) perm[next[part[i]]++] = (uint32_t)i;
+
+    free(next);
+    return 0;
+}
+
+size_t graph_partition_cut(const Graph *g, const uint32_t *part)
+{
+    size_t cut = 0;
+    long n = (long)g->n;
+
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:cut)
+    for (long v = 0; v < n; v++) {
+        for (uint64_t e = g->offsets[v]; e < graph_row_end(g, v); e++) {
+            cut += (part[g->adj[e]] != part[v]);
+        }
+    }
+    return cut;
+}
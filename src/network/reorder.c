@@ -0,0 +1,187 @@
+#include "reorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------
+   Degree order
+---------------------------------------------------- */
+
+/* Counting sort by descending degree; ties keep id order */
+static int order_by_degree(const Graph *g, uint32_t *perm)
+{
+    size_t n = g->n;
+    size_t max_deg = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t d = graph_degree(g, i);
+        if (d > max_deg) max_deg = d;
+    }
+
+    size_t *start = calloc(max_deg + 2, sizeof(size_t));
+    if (!start) return -1;
+
+    for (size_t i = 0; i < n; i++) start[max_deg - graph_degree(g, i) + 1]++;
+    for (size_t d = 0; d <= max_deg; d++) start[d + 1] += start[d];
+    for (size_t i = 0; i < n; i++) perm[start[max_deg - graph_degree(g, i)]++] = (uint32_t)i;
+
+    free(start);
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Reverse Cuthill–McKee
+---------------------------------------------------- */
+
+typedef struct {
+    uint64_t degree;
+    uint32_t id;
+} DegreeKey;
+
+static int cmp_degree_key(const void *a, const void *b)
+{
+    const DegreeKey *x = a, *y = b;
+    if (x->degree != y->degree) return (x->degree > y->degree) - (x->degree < y->degree);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static int order_rcm(const Graph *g, uint32_t *perm)
+{
+    size_t n = g->n;
+    size_t max_deg = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t d = graph_degree(g, i);
+        if (d > max_deg) max_deg = d;
+    }
+
+    bool *visited = calloc(n ? n : 1, sizeof(bool));
+    uint32_t *by_degree = malloc((n ? n : 1) * sizeof(uint32_t));
+    DegreeKey *keys = malloc((max_deg ? max_deg : 1) * sizeof(DegreeKey));
+    if (!visited || !by_degree || !keys || order_by_degree(g, by_degree) != 0) {
+        free(visited); free(by_degree); free(keys);
+        return -1;
+    }
+
+    /* perm doubles as the BFS queue; component roots are min-degree nodes */
+    size_t head = 0, tail = 0;
+    for (size_t r = n; r-- > 0; ) {
+        uint32_t root = by_degree[r];      /* by_degree is descending */
+        if (visited[root]) continue;
+
+        visited[root] = true;
+        perm[tail++] = root;
+
+        while (head < tail) {
+            uint32_t v = perm[head++];
+            size_t k = 0;
+
+            for (uint64_t e = g->offsets[v]; e < graph_row_end(g, v); e++) {
+                uint32_t u = g->adj[e];
+                if (visited[u]) continue;
+                visited[u] = true;
+                keys[k].degree = graph_degree(g, u);
+                keys[k].id = u;
+                k++;
+            }
+
+            qsort(keys, k, sizeof(DegreeKey), cmp_degree_key);
+            for (size_t j = 0; j < k; j++) perm[tail++] = keys[j].id;
+        }
+    }
+
+    /* Reverse */
+    for (size_t i = 0, j = n ? n - 1 : 0; i < j; i++, j--) {
+        uint32_t t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+
+    free(visited); free(by_degree); free(keys);
+    return 0;
+}
+
+/* ----------------------------------------------------
+   Public API
+---------------------------------------------------- */
+
+int graph_order_compute(const Graph *g, GraphOrder order, uint32_t *perm)
+{
+    if (order != GRAPH_ORDER_NONE && graph_is_compressed(g)) {
+        fprintf(stderr, "reorder: order the graph before compressing it\n");
+        return -1;
+    }
+
+    switch (order) {
+        case GRAPH_ORDER_DEGREE:
+            return order_by_degree(g, perm);
+        case GRAPH_ORDER_RCM:
+            return order_rcm(g, perm);
+        case GRAPH_ORDER_NONE:
+        default:
+            for (size_t i = 0; i < g->n; i++) perm[i] = (uint32_t)i;
+            return 0;
+    }
+}
+
+void graph_order_invert(const uint32_t *perm, size_t n, uint32_t *inverse)
+{
+    for (size_t i = 0; i < n; i++) inverse[perm[i]] = (uint32_t)i;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int graph_permute(Graph *g, const uint32_t *perm)
+{
+    if (graph_is_compressed(g)) {
+        fprintf(stderr, "reorder: cannot permute a compressed graph\n");
+        return -1;
+    }
+
+    size_t n = g->n;
+    uint32_t *inverse = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint64_t *offsets = malloc((n + 1) * sizeof(uint64_t));
+    uint32_t *adj = malloc((g->m ? g->m : 1) * sizeof(uint32_t));
+    if (!inverse || !offsets || !adj) {
+        free(inverse); free(offsets); free(adj);
+        return -1;
+    }
+
+    graph_order_invert(perm, n, inverse);
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < n; i++) offsets[i + 1] = offsets[i] + graph_degree(g, perm[i]);
+
+    /* Rows are independent: relabel and re-sort in parallel */
+    long count = (long)n;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < count; i++) {
+        uint32_t old = perm[i];
+        uint64_t lo = g->offsets[old], hi = graph_row_end(g, old);
+        uint32_t *row = adj + offsets[i];
+
+        for (uint64_t k = lo; k < hi; k++) row[k - lo] = inverse[g->adj[k]];
+        qsort(row, (size_t)(hi - lo), sizeof(uint32_t), cmp_u32);
+    }
+
+    if (graph_owns(g, g->offsets)) free(g->offsets);
+    if (graph_owns(g, g->adj)) free(g->adj);
+    g->offsets = offsets;
+    g->adj = adj;
+    graph_work_clear(g);
+
+    /* Rows come out packed; slack, if any, is given up */
+    free(g->degree);
+    free(g->room);
+    g->degree = g->room = NULL;
+    g->adj_end = g->adj_cap = 0;
+
+    /* Samples hold old ids */
+    graph_sample_clear(g);
+
+    free(inverse);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef JUMPSIM_REORDER_H
+#define JUMPSIM_REORDER_H
+
+/*
+ * reorder.h
+ * ---------
+ * Node reordering for cache locality in neighbor gathers.
+ *
+ * With arbitrary ids, every x[adj[k]] in a neighbor gather is a likely
+ * cache miss on large graphs. Renumbering nodes so that neighbors get
+ * nearby ids turns most of those loads into hits:
+ *  - GRAPH_ORDER_RCM:    reverse Cuthill–McKee (BFS by increasing degree,
+ *                        reversed); minimizes bandwidth on mesh-like and
+ *                        small-world graphs
+ *  - GRAPH_ORDER_DEGREE: descending degree; packs the hubs that appear in
+ *                        most rows of scale-free (Barabási–Albert) graphs
+ *
+ * A permutation is given as perm[new_id] = old_id. The caller applies the
+ * same permutation to the graph (graph_permute) and to every per-agent
+ * column (population_permute), and keeps it to map ids back for output.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "graph.h"
+
+/* -------------------- API (implemented in reorder.c) -------------------- */
+
+/*
+ * Compute the permutation for 'order' into perm[g->n].
+ * GRAPH_ORDER_NONE yields the identity. Returns 0 / -1.
+ */
+int graph_order_compute(const Graph *g, GraphOrder order, uint32_t *perm);
+
+/* inverse[perm[i]] = i */
+void graph_order_invert(const uint32_t *perm, size_t n, uint32_t *inverse);
+
+/* Relabel 'g' so that new node i is old node perm[i]. Returns 0 / -1 */
+int graph_permute(Graph *g, const uint32_t *perm);
+
+#endif /* JUMPSIM_REORDER_H */
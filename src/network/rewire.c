@@ -0,0 +1,242 @@
+#include "rewire.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Marks a proposal that moved nothing */
+#define NO_EDIT UINT32_MAX
+
+/* Proposals advanced together (propose_group) */
+#define REWIRE_GROUP 32
+
+#if defined(__GNUC__)
+#define REWIRE_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define REWIRE_PREFETCH(p) ((void)0)
+#endif
+
+/* ----------------------------------------------------
+   Config names & setup
+---------------------------------------------------- */
+
+int rewire_rule_from_string(const char *s, RewireRule *out)
+{
+    if (strcmp(s, "none") == 0) *out = REWIRE_NONE;
+    else if (strcmp(s, "pnl") == 0) *out = REWIRE_PNL;
+    else if (strcmp(s, "belief") == 0) *out = REWIRE_BELIEF;
+    else return -1;
+    return 0;
+}
+
+void rewire_init(Rewirer *rw, const RewireConfig *cfg, bool symmetric, uint64_t seed)
+{
+    memset(rw, 0, sizeof(Rewirer));
+    rw->cfg = *cfg;
+    rw->symmetric = symmetric;
+    rw->seed = seed;
+}
+
+void rewire_free(Rewirer *rw)
+{
+    free(rw->edits);
+    rw->edits = NULL;
+    rw->cap = 0;
+}
+
+/* ----------------------------------------------------
+   Proposals
+---------------------------------------------------- */
+
+static inline uint64_t rewire_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static inline uint32_t rewire_below(uint64_t *state, size_t n)
+{
+    return (uint32_t)(((rewire_rand(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/* How agent i rates peer j: higher is more worth following */
+static inline double rating(const Rewirer *rw, const AgentState *s, double price,
+                            size_t i, size_t j)
+{
+    if (rw->cfg.rule == REWIRE_PNL) return s->cash[j] + (double)s->position[j] * price;
+    return -fabs(s->belief[j] - s->belief[i]);
+}
+
+static inline void prefetch_rating(const Rewirer *rw, const AgentState *s, size_t j)
+{
+    if (rw->cfg.rule == REWIRE_PNL) {
+        REWIRE_PREFETCH(&s->cash[j]);
+        REWIRE_PREFETCH(&s->position[j]);
+    }
+    else {
+        REWIRE_PREFETCH(&s->belief[j]);
+    }
+}
+
+/* One proposal in flight */
+typedef struct Pending {
+    uint32_t i;
+    uint32_t d;
+    const uint32_t *row;
+    uint32_t drop[REWIRE_MAX_CANDIDATES];    /* row positions, then ids */
+    uint32_t add[REWIRE_MAX_CANDIDATES];
+} Pending;
+
+/*
+ Proposals first .. first+count-1 (count <= REWIRE_GROUP). Each one is
+ a short chain of dependent random loads (agent -> row -> neighbor ->
+ rating), so they are advanced in stages over the whole group, with the
+ next stage's loads prefetched: the misses of a group overlap instead of
+ following one another. Proposal p writes out[p * per ..] as in
+ rewire_round(), or sets that slot's row to NO_EDIT.
+*/
+static void propose_group(const Rewirer *rw, const Graph *g, const AgentState *s,
+                          double price, uint64_t round, size_t first, size_t count,
+                          GraphEdit *out, size_t per)
+{
+    Pending q[REWIRE_GROUP];
+    int tries = rw->cfg.candidates;
+    uint64_t round_seed = hash_derive_seed(rw->seed, round);
+
+    /* Agent and candidate followees: drawn from the proposal's own stream */
+    for (size_t p = 0; p < count; p++) {
+        uint64_t rng = hash_derive_seed(round_seed, first + p);
+        if (rng == 0) rng = 1;
+
+        q[p].i = rewire_below(&rng, g->n);
+        REWIRE_PREFETCH(&g->offsets[q[p].i]);
+        if (g->degree) REWIRE_PREFETCH(&g->degree[q[p].i]);
+        if (rw->cfg.rule == REWIRE_BELIEF) REWIRE_PREFETCH(&s->belief[q[p].i]);
+
+        for (int t = 0; t < tries; t++) {
+            q[p].add[t] = rewire_below(&rng, g->n);
+            prefetch_rating(rw, s, q[p].add[t]);
+        }
+        /* Positions in the row, scaled to the degree in the next stage */
+        for (int t = 0; t < tries; t++) q[p].drop[t] = (uint32_t)(rewire_rand(&rng) >> 32);
+    }
+
+    /* Rows */
+    for (size_t p = 0; p < count; p++) {
+        q[p].d = (uint32_t)graph_degree(g, q[p].i);
+        q[p].row = g->adj + g->offsets[q[p].i];
+        for (int t = 0; t < tries; t++) {
+            q[p].drop[t] = (uint32_t)(((uint64_t)q[p].drop[t] * q[p].d) >> 32);
+            REWIRE_PREFETCH(q[p].row + q[p].drop[t]);
+        }
+    }
+
+    /* Current neighbors */
+    for (size_t p = 0; p < count; p++) {
+        if (q[p].d == 0) continue;
+        for (int t = 0; t < tries; t++) {
+            q[p].drop[t] = q[p].row[q[p].drop[t]];
+            prefetch_rating(rw, s, q[p].drop[t]);
+        }
+    }
+
+    /* Weakest neighbor against strongest newcomer */
+    for (size_t p = 0; p < count; p++) {
+        GraphEdit *e = out + (first + p) * per;
+        size_t i = q[p].i, d = q[p].d;
+        const uint32_t *row = q[p].row;
+
+        e[0].row = NO_EDIT;
+        if (d == 0 || d + 1 >= g->n) continue;
+
+        uint32_t drop = q[p].drop[0];
+        double drop_rating = rating(rw, s, price, i, drop);
+        for (int t = 1; t < tries; t++) {
+            double r = rating(rw, s, price, i, q[p].drop[t]);
+            if (r < drop_rating) {
+                drop = q[p].drop[t];
+                drop_rating = r;
+            }
+        }
+
+        uint32_t add = NO_EDIT;
+        double add_rating = 0.0;
+        for (int t = 0; t < tries; t++) {
+            uint32_t k = q[p].add[t];
+            if (k == i) continue;
+
+            size_t lo = 0, hi = d;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (row[mid] < k) lo = mid + 1;
+                else hi = mid;
+            }
+            if (lo < d && row[lo] == k) continue;
+
+            double r = rating(rw, s, price, i, k);
+            if (add == NO_EDIT || r > add_rating) {
+                add = k;
+                add_rating = r;
+            }
+        }
+
+        if (add == NO_EDIT || !(add_rating > drop_rating)) continue;
+
+        /* Both rows of a link get its edits in proposal order, so they agree */
+        e[0] = (GraphEdit){ (uint32_t)i, drop, 0 };
+        e[1] = (GraphEdit){ (uint32_t)i, add, 1 };
+        if (rw->symmetric) {
+            e[2] = (GraphEdit){ drop, (uint32_t)i, 0 };
+            e[3] = (GraphEdit){ add, (uint32_t)i, 1 };
+        }
+    }
+}
+
+/* ----------------------------------------------------
+   Rounds
+---------------------------------------------------- */
+
+long rewire_round(Rewirer *rw, Graph *g, const AgentState *state, double price,
+                  uint64_t round)
+{
+    size_t links = rw->symmetric ? g->m / 2 : g->m;
+    size_t proposals = (size_t)llround(rw->cfg.rate * (double)links);
+    size_t per = rw->symmetric ? 4 : 2;
+
+    if (proposals == 0 || g->n < 2) return 0;
+    if (proposals > (size_t)INT32_MAX) proposals = (size_t)INT32_MAX;
+
+    if (rw->cap < proposals * per) {
+        GraphEdit *grown = realloc(rw->edits, proposals * per * sizeof(GraphEdit));
+        if (!grown) return -1;
+        rw->edits = grown;
+        rw->cap = proposals * per;
+    }
+
+    long groups = (long)((proposals + REWIRE_GROUP - 1) / REWIRE_GROUP);
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < groups; b++) {
+        size_t first = (size_t)b * REWIRE_GROUP;
+        size_t count = proposals - first < REWIRE_GROUP ? proposals - first : REWIRE_GROUP;
+        propose_group(rw, g, state, price, round, first, count, rw->edits, per);
+    }
+
+    /* Drop empty proposals, keeping proposal order */
+    size_t n_edits = 0;
+    long moved = 0;
+    for (size_t p = 0; p < proposals; p++) {
+        const GraphEdit *e = rw->edits + p * per;
+        if (e[0].row == NO_EDIT) continue;
+        memmove(rw->edits + n_edits, e, per * sizeof(GraphEdit));
+        n_edits += per;
+        moved++;
+    }
+
+    if (graph_apply_edits(g, rw->edits, n_edits) != 0) return -1;
+    return moved;
+}
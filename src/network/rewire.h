@@ -0,0 +1,69 @@
+#ifndef JUMPSIM_REWIRE_H
+#define JUMPSIM_REWIRE_H
+
+/*
+ * rewire.h
+ * --------
+ * Rewiring of the agent network while the market runs.
+ *
+ * In a crisis, followers drift towards whoever is winning and herding
+ * networks concentrate. Every 'every' steps a round of rewiring runs;
+ * each of rate * links proposals picks a random agent i and
+ *  - among 'candidates' of i's neighbors, the one i rates lowest (j)
+ *  - among 'candidates' random agents that are not yet neighbors, the one
+ *    i rates highest (k)
+ * and moves the link i - j to i - k if k rates higher than j
+ * (tournament selection: preferential attachment without any global
+ * ranking). Ratings:
+ *  - REWIRE_PNL:    mark-to-market wealth, cash + position * price
+ *                   (P&L, for equal starting capital)
+ *  - REWIRE_BELIEF: closeness of the peer's belief to i's own
+ *
+ * Undirected networks rewire both rows of a link; directed ones (row i =
+ * the accounts i listens to) only row i. Proposals are drawn in parallel
+ * against the network as it was at the start of the round and applied as
+ * one batch of edits (graph_apply_edits) to rows with slack, so a round
+ * costs O(proposals) rather than a rebuild. Every proposal has its own
+ * random stream derived from (seed, round, proposal), so the result does
+ * not depend on the thread count.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "graph.h"
+#include "population.h"
+
+/* -------------------- Types & Constants -------------------- */
+
+/* Upper bound of RewireConfig.candidates */
+#define REWIRE_MAX_CANDIDATES 8
+
+typedef struct Rewirer {
+    RewireConfig cfg;
+    bool symmetric;            /* a link lives in both of its rows */
+    uint64_t seed;
+
+    GraphEdit *edits;          /* batch scratch */
+    size_t cap;
+} Rewirer;
+
+/* -------------------- API (implemented in rewire.c) -------------------- */
+
+/* Parse "none", "pnl" or "belief". Returns 0 / -1 */
+int rewire_rule_from_string(const char *s, RewireRule *out);
+
+void rewire_init(Rewirer *rw, const RewireConfig *cfg, bool symmetric, uint64_t seed);
+
+/*
+ * Run rewiring round 'round' on 'g' (rows with slack, graph_reserve),
+ * rating agents by 'state' at 'price'. Returns the number of accepted
+ * moves, or -1 if the batch could not be applied (graph unchanged).
+ */
+long rewire_round(Rewirer *rw, Graph *g, const AgentState *state, double price,
+                  uint64_t round);
+
+void rewire_free(Rewirer *rw);
+
+#endif /* JUMPSIM_REWIRE_H */
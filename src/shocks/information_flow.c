@@ -1,5 +1,6 @@
-#include "agent.h"
+#include "information_flow.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 /*
@@ -16,10 +17,15 @@
  * This module transforms a global shock into heterogeneous local signals.
  */
 
-/* ---------------- Configuration ---------------- */
+/* ---------------- Config Names ---------------- */
 
-#define MAX_PROPAGATION_STEPS 3
-#define BASE_ATTENTION 0.6
+int news_spread_from_string(const char *s, NewsSpread *out)
+{
+    if (strcmp(s, "broadcast") == 0) *out = NEWS_SPREAD_BROADCAST;
+    else if (strcmp(s, "network") == 0) *out = NEWS_SPREAD_NETWORK;
+    else return -1;
+    return 0;
+}
 
 /* ---------------- Internal Helpers ---------------- */
 
@@ -27,30 +33,76 @@
  * Attention weight models limited attention / media filtering.
  * Retail agents overweight salient news.
  * Institutions dampen noisy signals.
+ * Indexed by AgentType.
  */
-static double attention_weight(AgentType type) {
-    if (type == AGENT_RETAIL)        return 1.2;
-    if (type == AGENT_INSTITUTION)  return 0.6;
-    return 0.9;  /* noise traders */
-}
+static const double ATTENTION_WEIGHT[AGENT_TYPE_COUNT] = {
+    1.2,   /* retail */
+    0.6,   /* institution */
+    0.9    /* noise traders */
+};
 
 /*
  * Delay filter simulates reaction latency.
  * Not all information is acted upon immediately.
  */
-static double temporal_decay(int step) {
+static double temporal_decay(double rate, int step) {
     /* exponential decay */
-    return exp(-0.8 * step);
+    return exp(-rate * step);
 }
 
 /* ---------------- Core Diffusion Logic ---------------- */
 
+/*
+ * Filtered signal each agent receives from 'global_shock', into
+ * local_signal (next_signal is scratch; both n_agents long).
+ */
+static void diffuse(const AgentParams *params,
+                    const Graph *g,
+                    const InformationFlowConfig *cfg,
+                    double global_shock,
+                    double *local_signal,
+                    double *next_signal)
+{
+    size_t n_agents = params->n;
+    long count = (long)n_agents;
+
+    /* ---------------- Step 0: Direct exposure ---------------- */
+
+    for (size_t i = 0; i < n_agents; i++) {
+        double w = ATTENTION_WEIGHT[params->type[i]];
+        local_signal[i] = cfg->base_attention * w * global_shock;
+    }
+
+    /* ---------------- Network propagation ---------------- */
+
+    for (int step = 1; step <= cfg->max_propagation_steps; step++) {
+
+        double decay = temporal_decay(cfg->temporal_decay, step);
+
+        /* Neighbor gather (plain or compressed rows, see graph.h) */
+        graph_neighbor_mean(g, local_signal, next_signal);
+
+        /* Secondary signal from social transmission */
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < count; i++) {
+            if (graph_degree(g, (size_t)i) == 0) continue;
+            next_signal[i] *= decay * params->network_influence[i];
+        }
+
+        /* Accumulate (isolated agents receive nothing) */
+        for (size_t i = 0; i < n_agents; i++) {
+            if (graph_degree(g, i) > 0) local_signal[i] += next_signal[i];
+        }
+    }
+}
+
 /*
  * Propagate a global news shock through the agent network.
  *
  * Parameters:
- *  - agents: array of agents
- *  - n_agents: number of agents
+ *  - params/state: agent columns (beliefs are updated)
+ *  - g: agent network (CSR); node ids are agent indices
+ *  - cfg: attention, propagation depth and decay
  *  - global_shock: macro news signal
  *
  * Effect:
@@ -58,65 +110,325 @@ static double temporal_decay(int step) {
  *  - Neighbor beliefs influence secondary propagation.
  *  - No direct price manipulation.
  */
-void information_propagate(Agent *agents,
-                           size_t n_agents,
+void information_propagate(const AgentParams *params,
+                           AgentState *state,
+                           const Graph *g,
+                           const InformationFlowConfig *cfg,
                            double global_shock)
 {
     if (fabs(global_shock) < 1e-9) return;
 
+    size_t n_agents = state->n;
+
     /* Temporary buffers */
     double *local_signal = calloc(n_agents, sizeof(double));
     double *next_signal  = calloc(n_agents, sizeof(double));
+    if (!local_signal || !next_signal) {
+        free(local_signal);
+        free(next_signal);
+        return;
+    }
 
-    /* ---------------- Step 0: Direct exposure ---------------- */
+    diffuse(params, g, cfg, global_shock, local_signal, next_signal);
+
+    /* ---------------- Apply to agent beliefs ---------------- */
 
     for (size_t i = 0; i < n_agents; i++) {
-        double w = attention_weight(agents[i].type);
-        local_signal[i] = BASE_ATTENTION * w * global_shock;
+
+        /*
+         Belief update from information signal:
+           belief += signal
+         */
+
+        state->belief[i] += local_signal[i];
     }
 
-    /* ---------------- Network propagation ---------------- */
+    free(local_signal);
+    free(next_signal);
+}
 
-    for (int step = 1; step <= MAX_PROPAGATION_STEPS; step++) {
+int information_response(const AgentParams *params,
+                         const Graph *g,
+                         const InformationFlowConfig *cfg,
+                         double *response)
+{
+    double *scratch = calloc(params->n ? params->n : 1, sizeof(double));
+    if (!scratch) return -1;
 
-        double decay = temporal_decay(step);
+    /* Every stage is linear in the shock */
+    diffuse(params, g, cfg, 1.0, response, scratch);
 
-        for (size_t i = 0; i < n_agents; i++) {
+    free(scratch);
+    return 0;
+}
 
-            if (agents[i].neighbor_count == 0) continue;
+/* ---------------- Timed Diffusion ---------------- */
 
-            double neighbor_avg = 0.0;
+void diffusion_init(Diffusion *d, const InformationFlowConfig *cfg, size_t n, bool symmetric)
+{
+    memset(d, 0, sizeof(Diffusion));
+    d->cfg = *cfg;
+    d->n = n;
+    d->symmetric = symmetric;
+}
 
-            for (size_t k = 0; k < agents[i].neighbor_count; k++) {
-                int nid = agents[i].neighbors[k];
-                neighbor_avg += local_signal[nid];
-            }
+static void cascade_free(Cascade *c)
+{
+    free(c->signal);
+    free(c->reached);
+    memset(c, 0, sizeof(Cascade));
+}
 
-            neighbor_avg /= agents[i].neighbor_count;
+void diffusion_free(Diffusion *d)
+{
+    for (size_t k = 0; k < d->n_cascades; k++) cascade_free(&d->cascades[k]);
+    free(d->cascades);
+    free(d->stamp);
+    free(d->candidates);
+    free(d->next);
+    free(d->row);
+    memset(d, 0, sizeof(Diffusion));
+}
 
-            /* Secondary signal from social transmission */
-            next_signal[i] += decay * agents[i].network_influence * neighbor_avg;
+/* Hop scratch (first cascade) and a free cascade slot */
+static int diffusion_reserve(Diffusion *d)
+{
+    if (!d->next) {
+        size_t n = d->n ? d->n : 1;
+        d->stamp = calloc(n, sizeof(uint32_t));
+        d->candidates = malloc(n * sizeof(uint32_t));
+        d->next = malloc(n * sizeof(double));
+        if (!d->stamp || !d->candidates || !d->next) {
+            free(d->stamp); free(d->candidates); free(d->next);
+            d->stamp = d->candidates = NULL;
+            d->next = NULL;
+            return -1;
         }
+    }
 
-        /* Accumulate and reset */
-        for (size_t i = 0; i < n_agents; i++) {
-            local_signal[i] += next_signal[i];
-            next_signal[i] = 0.0;
+    if (d->n_cascades == d->cap) {
+        size_t cap = d->cap ? 2 * d->cap : 4;
+        Cascade *grown = realloc(d->cascades, cap * sizeof(Cascade));
+        if (!grown) return -1;
+        d->cascades = grown;
+        d->cap = cap;
+    }
+    return 0;
+}
+
+/* Direct exposure of agent i, added to its belief now */
+static inline void expose(const Diffusion *d, const AgentParams *params, AgentState *state,
+                          double *signal, size_t i, double shock)
+{
+    double w = ATTENTION_WEIGHT[params->type[i]];
+    signal[i] = d->cfg.base_attention * w * shock;
+    state->belief[i] += signal[i];
+}
+
+int diffusion_start(Diffusion *d, const AgentParams *params, AgentState *state,
+                    double global_shock, uint64_t step)
+{
+    if (fabs(global_shock) < 1e-9) return 0;   /* as information_propagate */
+
+    size_t n = d->n;
+    bool spreads = d->cfg.max_propagation_steps > 0;
+    double *signal = malloc((n ? n : 1) * sizeof(double));
+    if (!signal) return -1;
+
+    if (spreads && diffusion_reserve(d) != 0) {
+        free(signal);
+        return -1;
+    }
+
+    /* Step 0: direct exposure, now */
+    for (size_t i = 0; i < n; i++) expose(d, params, state, signal, i, global_shock);
+
+    if (!spreads) {
+        free(signal);
+        return 0;
+    }
+
+    /* Everyone heard it directly: dense from the first hop */
+    d->cascades[d->n_cascades++] = (Cascade){
+        .hop = 0,
+        .due = step + (uint64_t)d->cfg.hop_latency,
+        .signal = signal,
+        .dense = true
+    };
+    return 0;
+}
+
+int diffusion_start_at(Diffusion *d, const AgentParams *params, AgentState *state,
+                       const AgentRange *ranges, size_t n_ranges, double shock,
+                       uint64_t step)
+{
+    if (fabs(shock) < 1e-9) return 0;
+
+    size_t n = d->n, hit = 0;
+    for (size_t k = 0; k < n_ranges; k++) hit += ranges[k].end - ranges[k].first;
+
+    bool spreads = d->cfg.max_propagation_steps > 0;
+    bool dense = hit > n / DIFFUSION_DENSE;
+
+    /* Zeroed pages: a sparse cascade only faults in those it writes */
+    double *signal = calloc(n ? n : 1, sizeof(double));
+    uint32_t *reached = spreads && !dense ? malloc((hit ? hit : 1) * sizeof(uint32_t)) : NULL;
+    if (!signal || (spreads && !dense && !reached) ||
+        (spreads && diffusion_reserve(d) != 0)) {
+        free(signal);
+        free(reached);
+        return -1;
+    }
+
+    size_t m = 0;
+    for (size_t k = 0; k < n_ranges; k++) {
+        for (uint32_t i = ranges[k].first; i < ranges[k].end; i++) {
+            expose(d, params, state, signal, i, shock);
+            if (reached) reached[m++] = i;
         }
     }
 
-    /* ---------------- Apply to agent beliefs ---------------- */
+    if (!spreads) {
+        free(signal);
+        return 0;
+    }
 
-    for (size_t i = 0; i < n_agents; i++) {
+    d->cascades[d->n_cascades++] = (Cascade){
+        .hop = 0,
+        .due = step + (uint64_t)d->cfg.hop_latency,
+        .signal = signal,
+        .dense = dense,
+        .reached = reached,
+        .n_reached = m
+    };
+    return 0;
+}
 
-        /*
-         Belief update from information signal:
-           belief += signal
-         */
+/* Neighbors of row r (plain or compressed) */
+static const uint32_t *row_ids(Diffusion *d, const Graph *g, size_t r, size_t *len)
+{
+    *len = graph_degree(g, r);
+    if (!graph_is_compressed(g)) return g->adj + g->offsets[r];
 
-        agents[i].belief += local_signal[i];
+    if (*len > d->row_cap) {
+        uint32_t *grown = realloc(d->row, *len * sizeof(uint32_t));
+        if (!grown) return NULL;
+        d->row = grown;
+        d->row_cap = *len;
     }
+    graph_row(g, r, d->row);
+    return d->row;
+}
 
-    free(local_signal);
-    free(next_signal);
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Every agent hears its neighbors (the hop of information_propagate) */
+static void hop_dense(Diffusion *d, Cascade *c, const AgentParams *params,
+                      AgentState *state, const Graph *g, double decay)
+{
+    long count = (long)d->n;
+
+    graph_neighbor_mean(g, c->signal, d->next);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < count; i++) {
+        if (graph_degree(g, (size_t)i) == 0) continue;
+        double v = d->next[i] * decay * params->network_influence[i];
+        c->signal[i] += v;
+        state->belief[i] += v;
+    }
+}
+
+/*
+ Only agents next to someone reached can hear anything: gather for them,
+ then add them to the reached list (sorted merge). Returns -1 if the
+ hop has to be dense instead (nothing changed).
+*/
+static int hop_sparse(Diffusion *d, Cascade *c, const AgentParams *params,
+                      AgentState *state, const Graph *g, double decay)
+{
+    if (++d->epoch == 0) {
+        memset(d->stamp, 0, d->n * sizeof(uint32_t));
+        d->epoch = 1;
+    }
+
+    size_t k = 0;
+    for (size_t t = 0; t < c->n_reached; t++) {
+        size_t len;
+        const uint32_t *row = row_ids(d, g, c->reached[t], &len);
+        if (!row) return -1;
+
+        for (size_t e = 0; e < len; e++) {
+            uint32_t j = row[e];
+            if (d->stamp[j] == d->epoch) continue;
+            d->stamp[j] = d->epoch;
+            d->candidates[k++] = j;
+        }
+    }
+    qsort(d->candidates, k, sizeof(uint32_t), cmp_u32);
+
+    uint32_t *merged = malloc((c->n_reached + k ? c->n_reached + k : 1) * sizeof(uint32_t));
+    if (!merged) return -1;
+
+    /* All of this hop's means first: the hop reads the previous signal */
+    graph_neighbor_mean_rows(g, c->signal, d->candidates, k, d->next);
+
+    for (size_t t = 0; t < k; t++) {
+        uint32_t i = d->candidates[t];
+        double v = d->next[t] * decay * params->network_influence[i];
+        c->signal[i] += v;
+        state->belief[i] += v;
+    }
+
+    size_t a = 0, b = 0, m = 0;
+    while (a < c->n_reached || b < k) {
+        uint32_t x = a < c->n_reached ? c->reached[a] : UINT32_MAX;
+        uint32_t y = b < k ? d->candidates[b] : UINT32_MAX;
+        merged[m++] = x < y ? x : y;
+        a += (x <= y);
+        b += (y <= x);
+    }
+    free(c->reached);
+    c->reached = merged;
+    c->n_reached = m;
+
+    if (m > d->n / DIFFUSION_DENSE) {
+        free(c->reached);
+        c->reached = NULL;
+        c->n_reached = 0;
+        c->dense = true;
+    }
+    return 0;
+}
+
+void diffusion_advance(Diffusion *d, const AgentParams *params, AgentState *state,
+                       const Graph *g, uint64_t step)
+{
+    size_t kept = 0;
+
+    for (size_t k = 0; k < d->n_cascades; k++) {
+        Cascade *c = &d->cascades[k];
+
+        if (c->due == step) {
+            c->hop++;
+            double decay = temporal_decay(d->cfg.temporal_decay, c->hop);
+
+            if (c->dense || !d->symmetric ||
+                hop_sparse(d, c, params, state, g, decay) != 0) {
+                hop_dense(d, c, params, state, g, decay);
+            }
+            c->due += (uint64_t)d->cfg.hop_latency;
+        }
+
+        if (c->hop >= d->cfg.max_propagation_steps) {
+            cascade_free(c);
+            continue;
+        }
+        d->cascades[kept++] = *c;
+    }
+    d->n_cascades = kept;
 }
@@ -0,0 +1,123 @@
+#ifndef JUMPSIM_INFORMATION_FLOW_H
+#define JUMPSIM_INFORMATION_FLOW_H
+
+/*
+ * information_flow.h
+ * ------------------
+ * Diffusion of exogenous news through the agent network
+ * (see information_flow.c for the economics).
+ *
+ * Timed diffusion (information_flow.hop_latency > 0): by default every
+ * hop of a story happens within the step it breaks. A Diffusion instead
+ * keeps each story in flight as a cascade that advances one hop every
+ * hop_latency steps, so cascades unfold while prices move. Summed over
+ * its hops, a cascade adds the same signal as information_propagate.
+ *
+ * A cascade tracks the agents it has reached (sorted list). A hop only
+ * gathers for those agents and their neighbors, so its cost follows the
+ * agents the news has reached, not the population. Once more than
+ * 1/DIFFUSION_DENSE of the agents are reached, the hop becomes a plain
+ * gather over every row. Global news reaches everyone directly, so its
+ * cascades are dense from the start; targeted news (news.h) starts
+ * sparse at its targets. Neighbors of reached agents are
+ * only all of the listeners when links are stored in both rows;
+ * directed networks always take dense hops.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "population.h"
+#include "graph.h"
+#include "config.h"
+
+/* Parse "broadcast" or "network". Returns 0 / -1 */
+int news_spread_from_string(const char *s, NewsSpread *out);
+
+/*
+ * Propagate a global news shock through 'g' and add each agent's
+ * filtered signal to its belief.
+ *
+ *  - direct exposure:  base_attention * attention(type) * shock
+ *  - step s = 1..max_propagation_steps:
+ *        signal += exp(-temporal_decay * s) * network_influence
+ *                  * mean(neighbor signal)
+ */
+void information_propagate(const AgentParams *params,
+                           AgentState *state,
+                           const Graph *g,
+                           const InformationFlowConfig *cfg,
+                           double global_shock);
+
+/*
+ * Signal each agent receives per unit of global shock: diffusion is
+ * linear, so belief += shock * response[i] reproduces
+ * information_propagate up to rounding without touching the network
+ * (used by sharded runs, where neighbors may live in another process).
+ * 'response' holds params->n values. Returns 0 / -1.
+ */
+int information_response(const AgentParams *params,
+                         const Graph *g,
+                         const InformationFlowConfig *cfg,
+                         double *response);
+
+/* -------------------- Timed diffusion -------------------- */
+
+/* A cascade stays sparse while at most n / DIFFUSION_DENSE agents are reached */
+#define DIFFUSION_DENSE 8
+
+/* One story in flight */
+typedef struct Cascade {
+    int hop;                  /* hops done */
+    uint64_t due;             /* step of the next hop */
+    double *signal;           /* n: signal received so far */
+    bool dense;               /* hops gather every row */
+    uint32_t *reached;        /* agents reached, ascending (sparse cascades) */
+    size_t n_reached;
+} Cascade;
+
+typedef struct Diffusion {
+    InformationFlowConfig cfg;
+    size_t n;
+    bool symmetric;           /* every link is stored in both of its rows */
+
+    Cascade *cascades;        /* in order of arrival */
+    size_t n_cascades;
+    size_t cap;
+
+    /* Scratch for hops, allocated with the first cascade */
+    uint32_t *stamp;          /* n: candidate marks of the current hop */
+    uint32_t epoch;
+    uint32_t *candidates;     /* n */
+    double *next;             /* n */
+    uint32_t *row;            /* one row's ids (compressed rows) */
+    size_t row_cap;
+} Diffusion;
+
+void diffusion_init(Diffusion *d, const InformationFlowConfig *cfg, size_t n, bool symmetric);
+
+/*
+ * News of size 'global_shock' breaks at 'step': direct exposure is added
+ * to beliefs now and the cascade's first hop is due at step + hop_latency.
+ * Returns 0 / -1 (no memory: the shock reaches agents directly only).
+ */
+int diffusion_start(Diffusion *d, const AgentParams *params, AgentState *state,
+                    double global_shock, uint64_t step);
+
+/*
+ * The same for a story that reaches only the agents in 'ranges'
+ * (targeted news): the cascade starts sparse unless the ranges hold
+ * more than n / DIFFUSION_DENSE agents.
+ */
+int diffusion_start_at(Diffusion *d, const AgentParams *params, AgentState *state,
+                       const AgentRange *ranges, size_t n_ranges, double shock,
+                       uint64_t step);
+
+/* Run the hops due at 'step', oldest cascade first; finished cascades are dropped */
+void diffusion_advance(Diffusion *d, const AgentParams *params, AgentState *state,
+                       const Graph *g, uint64_t step);
+
+void diffusion_free(Diffusion *d);
+
+#endif /* JUMPSIM_INFORMATION_FLOW_H */
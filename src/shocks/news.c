@@ -1,4 +1,7 @@
+#include "news.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <stdint.h>
 
@@ -21,43 +24,19 @@
 /* ---------------- Internal RNG ---------------- */
 
 /* Simple xorshift RNG for reproducibility */
-static uint64_t rng_state = 88172645463325252ULL;
-
-static inline uint64_t xorshift64() {
-    uint64_t x = rng_state;
+static inline uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
     x ^= x << 13;
     x ^= x >> 7;
     x ^= x << 17;
-    rng_state = x;
+    *state = x;
     return x;
 }
 
-static inline double uniform_random() {
-    return (xorshift64() >> 11) * (1.0 / 9007199254740992.0);
+static inline double uniform_random(uint64_t *state) {
+    return (xorshift64(state) >> 11) * (1.0 / 9007199254740992.0);
 }
 
-/* ---------------- Regime Model ---------------- */
-
-/*
-   Two regimes:
-     0 = calm
-     1 = stressed / crisis
-
-   Transition probabilities create clustering of volatility.
-*/
-
-typedef struct {
-    int regime;
-    double p_switch_to_stress;
-    double p_switch_to_calm;
-} NewsRegime;
-
-static NewsRegime regime = {
-    .regime = 0,
-    .p_switch_to_stress = 0.002,
-    .p_switch_to_calm   = 0.01
-};
-
 /* ---------------- Heavy-Tail Shock Generator ---------------- */
 
 /*
@@ -65,68 +44,170 @@ static NewsRegime regime = {
    shock = scale * (normal / sqrt(uniform))
 */
 
-static double heavy_tail_shock(double scale) {
-    double u = uniform_random();
+static double heavy_tail_shock(uint64_t *state, double scale) {
+    double u = uniform_random(state);
     if (u < 1e-12) u = 1e-12;
 
-    double z = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform_random());
-    return scale * z / sqrt(uniform_random());
+    double z = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform_random(state));
+    return scale * z / sqrt(uniform_random(state));
 }
 
-/* ---------------- Public API ---------------- */
+/* ---------------- Arrival Process ---------------- */
 
-/*
- * Initialize news generator seed.
- */
-void news_seed(uint64_t seed) {
-    rng_state = seed;
+void news_init(NewsProcess *np, const NewsConfig *cfg, uint64_t seed) {
+    np->cfg = *cfg;
+    np->regime = 0;
+    np->rng_state = seed ? seed : 88172645463325252ULL;
 }
 
 /*
- * Generate one global news shock.
+ * Two regimes:
+ *   0 = calm
+ *   1 = stressed / crisis
  *
- * Return:
- *   double shock_strength (positive or negative)
+ * Transition probabilities create clustering of volatility.
  *
- * Interpretation:
+ * Interpretation of the result:
  *   - 0.0 => no meaningful news this step
  *   - large magnitude => major macro / sentiment shock
  */
+double news_next(NewsProcess *np) {
 
-double news_generate_shock() {
+    const NewsConfig *c = &np->cfg;
 
     /* -------- Regime switching -------- */
 
-    if (regime.regime == 0) {
-        if (uniform_random() < regime.p_switch_to_stress)
-            regime.regime = 1;
+    if (np->regime == 0) {
+        if (uniform_random(&np->rng_state) < c->regime_switch_to_stress)
+            np->regime = 1;
     } else {
-        if (uniform_random() < regime.p_switch_to_calm)
-            regime.regime = 0;
+        if (uniform_random(&np->rng_state) < c->regime_switch_to_calm)
+            np->regime = 0;
     }
 
     /* -------- Arrival intensity -------- */
 
     double arrival_prob =
-        (regime.regime == 0) ? 0.01 : 0.05;
+        (np->regime == 0) ? c->calm_arrival_prob : c->stress_arrival_prob;
 
-    if (uniform_random() > arrival_prob) {
+    if (uniform_random(&np->rng_state) > arrival_prob) {
         return 0.0;
     }
 
     /* -------- Shock magnitude -------- */
 
     double scale =
-        (regime.regime == 0) ? 2.0 : 8.0;
+        (np->regime == 0) ? c->calm_scale : c->stress_scale;
 
-    double shock = heavy_tail_shock(scale);
+    return heavy_tail_shock(&np->rng_state, scale);
+}
 
-    return shock;
+int news_current_regime(const NewsProcess *np) {
+    return np->regime;
 }
 
-/*
- * Return current regime (0 = calm, 1 = stress)
- */
-int news_current_regime() {
-    return regime.regime;
+/* ---------------- Targets ---------------- */
+
+int news_target_from_string(const char *s, NewsTargetConfig *out) {
+    if (strcmp(s, "retail") == 0) { out->kind = NEWS_TARGET_TYPE; out->type = AGENT_RETAIL; }
+    else if (strcmp(s, "institution") == 0) { out->kind = NEWS_TARGET_TYPE; out->type = AGENT_INSTITUTION; }
+    else if (strcmp(s, "noise") == 0) { out->kind = NEWS_TARGET_TYPE; out->type = AGENT_NOISE; }
+    else if (strcmp(s, "range") == 0) out->kind = NEWS_TARGET_RANGE;
+    else if (strcmp(s, "community") == 0) out->kind = NEWS_TARGET_COMMUNITY;
+    else return -1;
+    return 0;
+}
+
+/* Ascending ids -> ranges of consecutive ids; 'out' holds up to 'count' */
+static size_t coalesce(const uint32_t *ids, size_t count, AgentRange *out) {
+    size_t m = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (m > 0 && out[m - 1].end == ids[k]) out[m - 1].end++;
+        else out[m++] = (AgentRange){ ids[k], ids[k] + 1 };
+    }
+    return m;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Runs of agents of one type (two passes: count, then fill) */
+static int type_ranges(NewsTarget *t, const AgentParams *params, int type) {
+    size_t runs = 0;
+    for (size_t i = 0; i < params->n; i++) {
+        if (params->type[i] == type && (i == 0 || params->type[i - 1] != type)) runs++;
+    }
+
+    t->ranges = malloc((runs ? runs : 1) * sizeof(AgentRange));
+    if (!t->ranges) return -1;
+
+    for (size_t i = 0; i < params->n; i++) {
+        if (params->type[i] != type) continue;
+        if (t->n_ranges > 0 && t->ranges[t->n_ranges - 1].end == i) t->ranges[t->n_ranges - 1].end++;
+        else t->ranges[t->n_ranges++] = (AgentRange){ (uint32_t)i, (uint32_t)i + 1 };
+    }
+    return 0;
+}
+
+/* Original ids first .. first+count-1, wherever reordering put them */
+static int id_ranges(NewsTarget *t, const AgentParams *params, const uint32_t *order_inverse,
+                     uint32_t first, uint32_t count) {
+    if ((uint64_t)first + count > params->n) {
+        fprintf(stderr, "news: target range %u + %u exceeds %zu agents\n",
+                first, count, params->n);
+        return -1;
+    }
+
+    uint32_t *ids = malloc((count ? count : 1) * sizeof(uint32_t));
+    t->ranges = malloc((count ? count : 1) * sizeof(AgentRange));
+    if (!ids || !t->ranges) {
+        free(ids);
+        return -1;
+    }
+
+    for (uint32_t k = 0; k < count; k++) {
+        ids[k] = order_inverse ? order_inverse[first + k] : first + k;
+    }
+    if (order_inverse) qsort(ids, count, sizeof(uint32_t), cmp_u32);
+
+    t->n_ranges = coalesce(ids, count, t->ranges);
+    free(ids);
+    return 0;
+}
+
+int news_target_build(NewsTarget *t, const NewsTargetConfig *cfg,
+                      const AgentParams *params, const uint32_t *order_inverse) {
+    memset(t, 0, sizeof(NewsTarget));
+    t->kind = cfg->kind;
+
+    int rc = 0;
+    if (cfg->kind == NEWS_TARGET_TYPE) rc = type_ranges(t, params, cfg->type);
+    else if (cfg->kind == NEWS_TARGET_RANGE) {
+        rc = id_ranges(t, params, order_inverse, cfg->first, cfg->count);
+    }
+
+    if (rc != 0) news_target_free(t);
+    return rc;
+}
+
+size_t news_target_hit(const NewsTarget *t, NewsProcess *np, const Communities *c,
+                       AgentRange *scratch, const AgentRange **ranges) {
+    if (t->kind != NEWS_TARGET_COMMUNITY) {
+        *ranges = t->ranges;
+        return t->n_ranges;
+    }
+
+    /* A random agent's community: sectors are hit in proportion to size */
+    uint32_t agent = (uint32_t)(((xorshift64(&np->rng_state) >> 32) * (uint64_t)c->n) >> 32);
+    uint32_t q = c->label[agent];
+
+    *ranges = scratch;
+    return coalesce(c->member + c->start[q], c->start[q + 1] - c->start[q], scratch);
+}
+
+void news_target_free(NewsTarget *t) {
+    free(t->ranges);
+    memset(t, 0, sizeof(NewsTarget));
 }
@@ -0,0 +1,80 @@
+#ifndef JUMPSIM_NEWS_H
+#define JUMPSIM_NEWS_H
+
+/*
+ * news.h
+ * ------
+ * Regime-switching news arrivals (see news.c for the economics) and the
+ * agents a targeted story reaches.
+ *
+ * A NewsProcess holds all of its state (regime, RNG), so any number of
+ * independent arrival processes can run side by side: one per target of
+ * news_process.targets, each seeded on its own.
+ *
+ * A target is a set of agent index ranges (AgentRange, population.h),
+ * built once at setup: agents of one type, a block of original ids, or
+ * the community ("sector") of a size-weighted random agent, found when
+ * the story breaks. Applying a story then only touches the agents in
+ * its ranges rather than the whole population.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "config.h"
+#include "population.h"
+#include "community.h"
+
+/* -------------------- Types -------------------- */
+
+typedef struct NewsProcess {
+    NewsConfig cfg;
+    int regime;               /* 0 = calm, 1 = stress */
+    uint64_t rng_state;
+} NewsProcess;
+
+/* Agents a target's stories reach (fixed kinds); sectors are drawn per story */
+typedef struct NewsTarget {
+    NewsTargetKind kind;
+    AgentRange *ranges;
+    size_t n_ranges;
+} NewsTarget;
+
+/* -------------------- API (implemented in news.c) -------------------- */
+
+void news_init(NewsProcess *np, const NewsConfig *cfg, uint64_t seed);
+
+/*
+ * Advance the regime one step and draw this step's story: 0.0 for no
+ * news, else a heavy-tailed shock (positive or negative).
+ */
+double news_next(NewsProcess *np);
+
+/* Current regime (0 = calm, 1 = stress) */
+int news_current_regime(const NewsProcess *np);
+
+/*
+ * Parse the "agents" field of a target: "retail", "institution", "noise",
+ * "range" or "community". Returns 0 / -1.
+ */
+int news_target_from_string(const char *s, NewsTargetConfig *out);
+
+/*
+ * Ranges of a type or range target over 'params->n' agents;
+ * 'order_inverse' maps original ids to indices (NULL if not reordered).
+ * Sector targets need none. Returns 0 / -1 (ids out of range, no memory).
+ */
+int news_target_build(NewsTarget *t, const NewsTargetConfig *cfg,
+                      const AgentParams *params, const uint32_t *order_inverse);
+
+/*
+ * Agents a story of 't' reaches: its fixed ranges, or for a sector the
+ * community of an agent drawn from 'np', written to 'scratch'
+ * (community_largest(c) entries). Returns the number of ranges.
+ */
+size_t news_target_hit(const NewsTarget *t, NewsProcess *np, const Communities *c,
+                       AgentRange *scratch, const AgentRange **ranges);
+
+void news_target_free(NewsTarget *t);
+
+#endif /* JUMPSIM_NEWS_H */
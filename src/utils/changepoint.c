@@ -0,0 +1,214 @@
+#include "changepoint.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ----------------------------------------------------
+   CUSUM
+---------------------------------------------------- */
+
+/* Observations that only set the baseline */
+#define CUSUM_WARMUP 20
+
+/* EWMA decay of the recent level (re-anchors the baseline after an alarm) */
+#define CUSUM_RECENT_DECAY 0.9
+
+void cusum_init(Cusum *c, double drift, double threshold, double decay)
+{
+    memset(c, 0, sizeof(Cusum));
+    c->drift = drift;
+    c->threshold = threshold;
+    c->decay = decay;
+}
+
+int cusum_update(Cusum *c, double x)
+{
+    double a = fabs(x);
+    c->n++;
+
+    if (c->n <= CUSUM_WARMUP || c->baseline <= 0.0) {
+        c->baseline += (a - c->baseline) / (double)(c->n < CUSUM_WARMUP ? c->n : CUSUM_WARMUP);
+        c->recent = c->baseline;
+        return 0;
+    }
+
+    /*
+     Deviation in baselines, capped at half the threshold: a single jump
+     is news, not a new regime, and must be confirmed by the next steps.
+    */
+    double z = fmin(a / c->baseline - 1.0, 0.5 * c->threshold);
+    c->up = fmax(0.0, c->up + z - c->drift);
+    c->down = fmax(0.0, c->down - z - c->drift);
+    c->recent = CUSUM_RECENT_DECAY * c->recent + (1.0 - CUSUM_RECENT_DECAY) * a;
+
+    int alarm = c->up > c->threshold ? 1 : (c->down > c->threshold ? -1 : 0);
+    if (alarm) {
+        c->up = c->down = 0.0;
+        c->baseline = c->recent;
+    }
+    else {
+        c->baseline = c->decay * c->baseline + (1.0 - c->decay) * a;
+    }
+    return alarm;
+}
+
+/* ----------------------------------------------------
+   BOCPD
+---------------------------------------------------- */
+
+/* Normal-Gamma prior of a fresh run; beta0 follows the observed scale */
+#define BOCPD_MU0    0.0
+#define BOCPD_KAPPA0 1.0
+#define BOCPD_ALPHA0 2.0
+
+/* EWMA decay of the observed scale */
+#define BOCPD_SCALE_DECAY 0.999
+
+/* Longest runs below this probability are dropped */
+#define BOCPD_EPS 1e-9
+
+#define BOCPD_LOG_2PI 1.8378770664093453
+
+static void fresh_run(Bocpd *b, size_t r)
+{
+    b->mu[r] = BOCPD_MU0;
+    b->kappa[r] = BOCPD_KAPPA0;
+    b->alpha[r] = BOCPD_ALPHA0;
+    b->beta[r] = b->scale * (BOCPD_ALPHA0 - 1.0);
+}
+
+int bocpd_init(Bocpd *b, double hazard, size_t max_run, double threshold, size_t window)
+{
+    memset(b, 0, sizeof(Bocpd));
+    if (max_run < 2 || window == 0 || window >= max_run) return -1;
+
+    b->hazard = hazard;
+    b->threshold = threshold;
+    b->window = window;
+    b->max_run = max_run;
+
+    /* One spare slot: runs grow by one before the longest is folded */
+    size_t slots = max_run + 1;
+    b->prob = malloc(slots * sizeof(double));
+    b->mu = malloc(slots * sizeof(double));
+    b->kappa = malloc(slots * sizeof(double));
+    b->alpha = malloc(slots * sizeof(double));
+    b->beta = malloc(slots * sizeof(double));
+    b->lgamma_ratio = malloc(slots * sizeof(double));
+    b->work = malloc(slots * sizeof(double));
+    if (!b->prob || !b->mu || !b->kappa || !b->alpha || !b->beta || !b->lgamma_ratio || !b->work) {
+        bocpd_free(b);
+        return -1;
+    }
+
+    /* A run of length r has seen r observations: alpha = alpha0 + r/2 */
+    for (size_t r = 0; r < slots; r++) {
+        double a = BOCPD_ALPHA0 + 0.5 * (double)r;
+        b->lgamma_ratio[r] = lgamma(a + 0.5) - lgamma(a);
+    }
+
+    b->scale = 1e-12;
+    b->n_runs = 1;
+    b->prob[0] = 1.0;
+    fresh_run(b, 0);
+    return 0;
+}
+
+int bocpd_update(Bocpd *b, double x)
+{
+    size_t n = b->n_runs;
+    double *lp = b->work;
+    double best = -INFINITY;
+    b->n++;
+
+    /* Student-t predictive log-density of x under each run */
+    for (size_t r = 0; r < n; r++) {
+        double a = b->alpha[r], k = b->kappa[r];
+        double s2 = b->beta[r] * (k + 1.0) / (a * k);
+        double d = x - b->mu[r];
+        double lg = a == BOCPD_ALPHA0 + 0.5 * (double)r
+                  ? b->lgamma_ratio[r] : lgamma(a + 0.5) - lgamma(a);
+        lp[r] = lg - 0.5 * (BOCPD_LOG_2PI + log(a * s2))
+              - (a + 0.5) * log1p(d * d / (2.0 * a * s2));
+        if (lp[r] > best) best = lp[r];
+    }
+
+    /*
+     Growth (r -> r + 1) and change (-> 0), longest run first so the
+     slots shift in place. Densities are taken relative to the best run:
+     a surprising x cannot underflow every hypothesis at once.
+    */
+    double mass = 0.0;
+    for (size_t r = n; r-- > 0;) {
+        double p = b->prob[r] * exp(lp[r] - best);
+        double k = b->kappa[r], m = b->mu[r], d = x - m;
+        mass += p;
+        b->prob[r + 1] = p * (1.0 - b->hazard);
+        b->mu[r + 1] = (k * m + x) / (k + 1.0);
+        b->kappa[r + 1] = k + 1.0;
+        b->alpha[r + 1] = b->alpha[r] + 0.5;
+        b->beta[r + 1] = b->beta[r] + k * d * d / (2.0 * (k + 1.0));
+    }
+    b->prob[0] = mass * b->hazard;
+    fresh_run(b, 0);
+    n++;
+
+    double x2 = fmax(x * x, 1e-12);
+    b->scale = b->n == 1 ? x2 : BOCPD_SCALE_DECAY * b->scale + (1.0 - BOCPD_SCALE_DECAY) * x2;
+
+    /* Bounded posterior: the longest run absorbs the one past max_run */
+    if (n > b->max_run) {
+        size_t last = b->max_run - 1, over = b->max_run;
+        if (b->prob[over] > b->prob[last]) {
+            b->mu[last] = b->mu[over];
+            b->kappa[last] = b->kappa[over];
+            b->alpha[last] = b->alpha[over];
+            b->beta[last] = b->beta[over];
+        }
+        b->prob[last] += b->prob[over];
+        n = b->max_run;
+    }
+
+    double total = 0.0;
+    for (size_t r = 0; r < n; r++) total += b->prob[r];
+    if (!(total > 0.0) || !isfinite(total)) {
+        n = 1;
+        b->prob[0] = 1.0;
+        fresh_run(b, 0);
+        total = 1.0;
+    }
+    for (size_t r = 0; r < n; r++) b->prob[r] /= total;
+
+    /* Negligible long runs cost time but no information */
+    while (n > b->window + 1 && b->prob[n - 1] < BOCPD_EPS) n--;
+    b->n_runs = n;
+
+    /* Alarm on the rising edge of P(run < window), once warmed up */
+    double recent = 0.0;
+    for (size_t r = 0; r < n && r < b->window; r++) recent += b->prob[r];
+    bool above = b->n > b->window && recent >= b->threshold;
+    int alarm = above && !b->alarmed;
+    b->alarmed = above;
+    return alarm;
+}
+
+size_t bocpd_map_run(const Bocpd *b)
+{
+    size_t best = 0;
+    for (size_t r = 1; r < b->n_runs; r++) {
+        if (b->prob[r] > b->prob[best]) best = r;
+    }
+    return best;
+}
+
+void bocpd_free(Bocpd *b)
+{
+    free(b->prob);
+    free(b->mu);
+    free(b->kappa);
+    free(b->alpha);
+    free(b->beta);
+    free(b->lgamma_ratio);
+    free(b->work);
+    memset(b, 0, sizeof(Bocpd));
+}
@@ -0,0 +1,75 @@
+#ifndef JUMPSIM_CHANGEPOINT_H
+#define JUMPSIM_CHANGEPOINT_H
+
+/*
+ * changepoint.h
+ * -------------
+ * Online change-point detectors for a scalar stream (log returns).
+ *
+ *  - Cusum: two-sided Page CUSUM on |x| against a slowly tracked
+ *    baseline level, in units of that baseline, so it needs no
+ *    knowledge of the return scale. Catches volatility shifts both ways.
+ *  - Bocpd: Bayesian online change-point detection (Adams & MacKay,
+ *    2007) with a constant hazard and a Normal model of unknown mean and
+ *    variance (Normal-Gamma prior, Student-t predictive). The run-length
+ *    posterior is bounded to 'max_run' hypotheses and trimmed of
+ *    negligible tails, so an update costs O(max_run) at worst: constant
+ *    per step, whatever the length of the run.
+ *
+ * Both are plain state machines: update() consumes one observation and
+ * says whether it raises an alarm. Nothing here allocates after init.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* -------------------- CUSUM -------------------- */
+
+typedef struct Cusum {
+    double drift;             /* allowance per step, in baselines */
+    double threshold;         /* alarm level, in baselines */
+    double decay;             /* EWMA decay of the baseline level */
+    double baseline;          /* typical |x| */
+    double recent;            /* fast EWMA of |x|: the new baseline after an alarm */
+    double up, down;          /* one-sided statistics */
+    uint64_t n;
+} Cusum;
+
+void cusum_init(Cusum *c, double drift, double threshold, double decay);
+
+/* Consume x; returns +1 (level rose), -1 (level fell) or 0 */
+int cusum_update(Cusum *c, double x);
+
+/* -------------------- BOCPD -------------------- */
+
+typedef struct Bocpd {
+    double hazard;            /* prior probability of a change per step */
+    double threshold;         /* alarm when P(run < window) reaches this */
+    size_t window;
+    size_t max_run;           /* hypotheses kept */
+
+    /* Run-length posterior and per-run Normal-Gamma parameters, run r at index r */
+    size_t n_runs;
+    double *prob;
+    double *mu, *kappa, *alpha, *beta;
+    double *lgamma_ratio;     /* lgamma(alpha + 1/2) - lgamma(alpha) by run length */
+    double *work;             /* predictive log-densities */
+
+    double scale;             /* EWMA of x^2: prior variance of a fresh run */
+    bool alarmed;             /* above threshold since the last alarm */
+    uint64_t n;
+} Bocpd;
+
+/* Returns 0 / -1 (max_run or window out of range, no memory) */
+int bocpd_init(Bocpd *b, double hazard, size_t max_run, double threshold, size_t window);
+
+/* Consume x; returns 1 when the recent-change probability crosses the threshold */
+int bocpd_update(Bocpd *b, double x);
+
+/* Most probable current run length */
+size_t bocpd_map_run(const Bocpd *b);
+
+void bocpd_free(Bocpd *b);
+
+#endif /* JUMPSIM_CHANGEPOINT_H */
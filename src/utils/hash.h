@@ -0,0 +1,59 @@
+#ifndef JUMPSIM_HASH_H
+#define JUMPSIM_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * hash.h
+ * ------
+ * Small, platform-independent mixing and hashing helpers.
+ *
+ * Used for:
+ *  - deriving independent seeds from one master seed (splitmix64)
+ *  - fingerprinting configs and simulation state (FNV-1a, 64-bit)
+ *
+ * Header-only so hot paths can inline them.
+ */
+
+/* splitmix64 finalizer: bijective, well-mixed 64-bit hash */
+static inline uint64_t hash_mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* Derive a non-zero xorshift seed for sub-stream 'tag' of 'master' */
+static inline uint64_t hash_derive_seed(uint64_t master, uint64_t tag) {
+    uint64_t s = hash_mix64(master ^ hash_mix64(tag));
+    return s ? s : 0x9E3779B97F4A7C15ULL;
+}
+
+#define HASH_FNV_OFFSET 0xCBF29CE484222325ULL
+#define HASH_FNV_PRIME  0x100000001B3ULL
+
+/* FNV-1a over a byte buffer, continuing from 'h' */
+static inline uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= HASH_FNV_PRIME;
+    }
+    return h;
+}
+
+/* Fold one 64-bit word into 'h' (cheaper than hash_bytes for state) */
+static inline uint64_t hash_u64(uint64_t h, uint64_t v) {
+    return hash_mix64(h ^ v);
+}
+
+/* Fold the exact bit pattern of a double into 'h' */
+static inline uint64_t hash_f64(uint64_t h, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return hash_u64(h, bits);
+}
+
+#endif /* JUMPSIM_HASH_H */
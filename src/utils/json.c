@@ -0,0 +1,299 @@
+#include "json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------- Parser State ---------------- */
+
+/* Containers nest at most this deep: the parser recurses per level */
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+    const char *s;
+    size_t len;
+    size_t pos;
+    int depth;
+    char *err;
+    size_t err_len;
+    bool failed;
+} Parser;
+
+static void fail(Parser *p, const char *what)
+{
+    if (!p->failed && p->err && p->err_len > 0) {
+        snprintf(p->err, p->err_len, "json: %s at byte %zu", what, p->pos);
+    }
+    p->failed = true;
+}
+
+static void skip_ws(Parser *p)
+{
+    while (p->pos < p->len) {
+        char c = p->s[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        p->pos++;
+    }
+}
+
+static bool match(Parser *p, const char *lit)
+{
+    size_t n = strlen(lit);
+    if (p->pos + n > p->len || strncmp(p->s + p->pos, lit, n) != 0) return false;
+    p->pos += n;
+    return true;
+}
+
+static void parse_value(Parser *p, JsonValue *out);
+
+/* ---------------- Scalars ---------------- */
+
+static char *parse_string(Parser *p)
+{
+    /* Caller has checked the opening quote */
+    p->pos++;
+
+    char *buf = malloc(p->len - p->pos + 1);
+    if (!buf) {
+        fail(p, "out of memory");
+        return NULL;
+    }
+    size_t n = 0;
+
+    while (p->pos < p->len && p->s[p->pos] != '"') {
+        char c = p->s[p->pos++];
+
+        if (c == '\\' && p->pos < p->len) {
+            char e = p->s[p->pos++];
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u':
+                    /* keep ASCII code points, replace the rest */
+                    if (p->pos + 4 <= p->len) {
+                        char hex[5] = { 0 };
+                        memcpy(hex, p->s + p->pos, 4);
+                        long cp = strtol(hex, NULL, 16);
+                        c = (cp > 0 && cp < 128) ? (char)cp : '?';
+                        p->pos += 4;
+                    }
+                    break;
+                default: c = e; break;
+            }
+        }
+        buf[n++] = c;
+    }
+
+    if (p->pos >= p->len) {
+        fail(p, "unterminated string");
+        free(buf);
+        return NULL;
+    }
+
+    p->pos++; /* closing quote */
+    buf[n] = '\0';
+    return buf;
+}
+
+static void parse_number(Parser *p, JsonValue *out)
+{
+    char tmp[64];
+    size_t n = 0;
+
+    while (p->pos < p->len && n < sizeof(tmp) - 1) {
+        char c = p->s[p->pos];
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' ||
+            c == '.' || c == 'e' || c == 'E') {
+            tmp[n++] = c;
+            p->pos++;
+        } else {
+            break;
+        }
+    }
+    tmp[n] = '\0';
+
+    char *end = NULL;
+    out->type = JSON_NUMBER;
+    out->number = strtod(tmp, &end);
+    if (n == 0 || *end != '\0') fail(p, "malformed number");
+}
+
+/* ---------------- Containers ---------------- */
+
+static void free_members(JsonValue *v)
+{
+    if (v->type == JSON_STRING) free(v->string);
+
+    for (size_t i = 0; i < v->count; i++) {
+        free_members(&v->items[i]);
+        if (v->keys) free(v->keys[i]);
+    }
+    free(v->items);
+    free(v->keys);
+}
+
+/* On failure the item and key are freed and the parse fails */
+static void push_item(Parser *p, JsonValue *c, size_t *cap, char *key, JsonValue *item)
+{
+    if (c->count == *cap) {
+        size_t grown = *cap ? *cap * 2 : 8;
+        JsonValue *items = realloc(c->items, grown * sizeof(JsonValue));
+        if (items) c->items = items;
+
+        char **keys = NULL;
+        if (items && c->type == JSON_OBJECT) {
+            keys = realloc(c->keys, grown * sizeof(char *));
+            if (keys) c->keys = keys;
+        }
+        if (!items || (c->type == JSON_OBJECT && !keys)) {
+            free_members(item);
+            free(key);
+            fail(p, "out of memory");
+            return;
+        }
+        *cap = grown;
+    }
+    c->items[c->count] = *item;
+    if (c->type == JSON_OBJECT) c->keys[c->count] = key;
+    c->count++;
+}
+
+static void parse_container(Parser *p, JsonValue *out, bool is_object)
+{
+    char close = is_object ? '}' : ']';
+    size_t cap = 0;
+
+    out->type = is_object ? JSON_OBJECT : JSON_ARRAY;
+    p->pos++;
+
+    skip_ws(p);
+    if (p->pos < p->len && p->s[p->pos] == close) {
+        p->pos++;
+        return;
+    }
+
+    while (!p->failed) {
+        char *key = NULL;
+
+        skip_ws(p);
+        if (is_object) {
+            if (p->pos >= p->len || p->s[p->pos] != '"') {
+                fail(p, "expected object key");
+                return;
+            }
+            key = parse_string(p);
+            if (!key) return;
+
+            skip_ws(p);
+            if (!match(p, ":")) {
+                free(key);
+                fail(p, "expected ':'");
+                return;
+            }
+        }
+
+        JsonValue item;
+        memset(&item, 0, sizeof(item));
+        parse_value(p, &item);
+        push_item(p, out, &cap, key, &item);
+        if (p->failed) return;
+
+        skip_ws(p);
+        if (match(p, ",")) continue;
+        if (p->pos < p->len && p->s[p->pos] == close) {
+            p->pos++;
+            return;
+        }
+        fail(p, is_object ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
+}
+
+static void parse_value(Parser *p, JsonValue *out)
+{
+    skip_ws(p);
+    if (p->pos >= p->len) {
+        fail(p, "unexpected end of input");
+        return;
+    }
+
+    char c = p->s[p->pos];
+
+    if (c == '{' || c == '[') {
+        if (p->depth == JSON_MAX_DEPTH) {
+            fail(p, "nesting too deep");
+            return;
+        }
+        p->depth++;
+        parse_container(p, out, c == '{');
+        p->depth--;
+    }
+    else if (c == '"') {
+        out->type = JSON_STRING;
+        out->string = parse_string(p);
+    }
+    else if (match(p, "true"))  { out->type = JSON_BOOL; out->boolean = true; }
+    else if (match(p, "false")) { out->type = JSON_BOOL; out->boolean = false; }
+    else if (match(p, "null"))  { out->type = JSON_NULL; }
+    else parse_number(p, out);
+}
+
+/* ---------------- Public API ---------------- */
+
+JsonValue *json_parse(const char *text, size_t len, char *err, size_t err_len)
+{
+    Parser p = { .s = text, .len = len, .pos = 0, .depth = 0,
+                 .err = err, .err_len = err_len, .failed = false };
+
+    JsonValue *root = calloc(1, sizeof(JsonValue));
+    if (!root) {
+        fail(&p, "out of memory");
+        return NULL;
+    }
+    parse_value(&p, root);
+
+    skip_ws(&p);
+    if (!p.failed && p.pos != p.len) fail(&p, "trailing characters");
+
+    if (p.failed) {
+        json_free(root);
+        return NULL;
+    }
+    return root;
+}
+
+void json_free(JsonValue *v)
+{
+    if (!v) return;
+    free_members(v);
+    free(v);
+}
+
+const JsonValue *json_get(const JsonValue *obj, const char *key)
+{
+    if (!obj || obj->type != JSON_OBJECT) return NULL;
+
+    for (size_t i = 0; i < obj->count; i++) {
+        if (strcmp(obj->keys[i], key) == 0) return &obj->items[i];
+    }
+    return NULL;
+}
+
+const JsonValue *json_path(const JsonValue *root, const char *path)
+{
+    char key[128];
+    const JsonValue *cur = root;
+
+    while (cur && *path) {
+        const char *dot = strchr(path, '.');
+        size_t n = dot ? (size_t)(dot - path) : strlen(path);
+        if (n >= sizeof(key)) return NULL;
+
+        memcpy(key, path, n);
+        key[n] = '\0';
+        cur = json_get(cur, key);
+        path += n + (dot ? 1 : 0);
+    }
+    return cur;
+}
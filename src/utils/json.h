@@ -0,0 +1,56 @@
+#ifndef JUMPSIM_JSON_H
+#define JUMPSIM_JSON_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * json.h
+ * ------
+ * Minimal JSON reader for experiment configuration files.
+ *
+ * Design goals:
+ *  - No external dependencies
+ *  - Whole document parsed into a small tree (configs are tiny)
+ *  - Read-only lookups by key or dotted path ("market.liquidity")
+ *
+ * Not supported: \u escapes beyond ASCII, duplicate-key semantics
+ * (first match wins), nesting deeper than 64 levels (a parse error).
+ */
+
+typedef enum {
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+typedef struct JsonValue {
+    JsonType type;
+    bool boolean;
+    double number;
+    char *string;             /* JSON_STRING */
+    struct JsonValue *items;  /* JSON_ARRAY / JSON_OBJECT members */
+    char **keys;              /* JSON_OBJECT keys, parallel to items */
+    size_t count;
+} JsonValue;
+
+/*
+ * Parse 'len' bytes of JSON text.
+ * Returns a heap-allocated tree (free with json_free) or NULL on error;
+ * on error a message with the byte offset is written to 'err'.
+ */
+JsonValue *json_parse(const char *text, size_t len, char *err, size_t err_len);
+
+/* Release a tree returned by json_parse */
+void json_free(JsonValue *v);
+
+/* Member lookup in an object; NULL if absent or not an object */
+const JsonValue *json_get(const JsonValue *obj, const char *key);
+
+/* Dotted-path lookup from the root, e.g. "agents.retail.noise_std" */
+const JsonValue *json_path(const JsonValue *root, const char *path);
+
+#endif /* JUMPSIM_JSON_H */
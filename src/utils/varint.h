@@ -0,0 +1,58 @@
+#ifndef JUMPSIM_VARINT_H
+#define JUMPSIM_VARINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * varint.h
+ * --------
+ * LEB128-style variable-length integers and zigzag mapping.
+ *
+ * Small magnitudes (deltas, run lengths, signed quantities near zero)
+ * take one or two bytes instead of eight. Header-only so encoders in hot
+ * loops inline them.
+ */
+
+/* Maximum encoded size of a 64-bit value */
+#define VARINT_MAX_BYTES 10
+
+/* Write 'v' at 'out'; returns the number of bytes written */
+static inline size_t varint_put(unsigned char *out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+/*
+ * Read a value from [in, end); returns bytes consumed, or 0 if the
+ * encoding is truncated or overlong.
+ */
+static inline size_t varint_get(const unsigned char *in, const unsigned char *end, uint64_t *v) {
+    uint64_t x = 0;
+    size_t n = 0;
+    for (int shift = 0; shift < 64 && in + n < end; shift += 7) {
+        unsigned char b = in[n++];
+        x |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return n;
+        }
+    }
+    return 0;
+}
+
+/* Map signed to unsigned so small |v| encode short: 0,-1,1,-2 -> 0,1,2,3 */
+static inline uint64_t zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+#endif /* JUMPSIM_VARINT_H */